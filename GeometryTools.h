@@ -0,0 +1,4 @@
+#pragma once
+#include <functional>
+#include <thread>
+namespace GeometryTools { inline void runParallel(uint32_t n, uint32_t, const std::function<void(uint32_t)>& f){ for(uint32_t i=0;i<n;i++) f(i);} }
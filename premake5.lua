@@ -109,5 +109,32 @@ project "Pyrrhasterized"
    	"{COPYDIR} ../shaders %{cfg.targetdir}/shaders"
     }
 
+--Offline meshlet baker, runs without a window or a Vulkan device
+project "pyrrha-bake"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++20"
+    location "generated"
+    architecture "x86_64"
+    targetdir ("build/bin/%{prj.name}/%{cfg.longname}")
+    objdir ("build/obj/%{prj.name}/%{cfg.longname}")
+    debugdir ""
 
+    includedirs { LIB_PATH .. "Vulkan-Headers/include", "src" }
+    useVMA()
+    useGLM()
+    userHeaderOnlyLibs()
 
+    files {
+        "tools/pyrrha-bake/**.cpp",
+        "src/GltfTools.h", "src/GltfTools.cpp",
+        "src/GeometryTools.h", "src/GeometryTools.cpp",
+        "src/SerializationTools.h", "src/SerializationTools.cpp",
+        "src/CompressionTools.h", "src/CompressionTools.cpp",
+        "src/TextureTools.h", "src/TextureTools.cpp",
+        "src/Defs.h"
+    }
+
+    filter "system:linux"
+        links { "pthread" }
+    filter {}
@@ -6,6 +6,7 @@ glslc vertexPBR.vert -o vertexPBR.spv -g
 glslc fragmentPBR.frag -o fragmentPBR.spv -g
 glslc fragmentDepthPrePass.frag -o fragmentDepthPrePass.spv -g
 glslc --target-spv=spv1.5 meshPBR.mesh -o meshPBR.spv -g
+glslc --target-spv=spv1.5 meshDepth.mesh -o meshDepth.spv -g
 glslc --target-spv=spv1.5 taskShell.task -o taskShell.spv -g
 glslc --target-spv=spv1.5 CSM.mesh -o meshCSM.spv -g
 glslc --target-spv=spv1.5 taskShadow.task -o taskShadow.spv -g
\ No newline at end of file
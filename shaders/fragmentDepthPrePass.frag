@@ -1,14 +1,7 @@
 #version 450
 #extension GL_EXT_nonuniform_qualifier : enable
 
-layout(location = 0) in vec2 fragTexCoord;
-layout(location = 1) in vec3 fragNormal;
-layout(location = 2) in vec3 fragPosWorld;
-layout(location = 3) in vec3 fragPosView;
-layout(location = 4) in vec4 fragTangent;
-layout(location = 5) flat in uint meshletId;
-layout(location = 6) flat in uint shellId;
-layout(location = 7) flat in uint shellCount;
+layout(location = 0) in vec2 fragTexCoord; //Only output of meshDepth.mesh, used for the alpha test
 
 #define SHADOW_CASCADE_COUNT 4
 #define TRUE 1
@@ -13,6 +13,8 @@
 #define ALPHA_MODE_MASK 1
 #define ALPHA_MODE_TRANSPARENT 2
 
+#define MAX_TEXTURE_COUNT 4096
+
 layout(location = 0) in vec2 fragTexCoord;
 layout(location = 1) in vec3 fragNormal;
 layout(location = 2) in vec3 fragPosWorld;
@@ -28,8 +30,16 @@ layout( push_constant ) uniform constants
 	int materialId;
 	uint cascadeId;
 	uint meshletId;
+	uint meshletCount;
+	uint shellCount;
+	uint frameId;
 } PushConstants;
 
+//Finest mip sampled per texture, relative to the bound image, one slot per frame in flight
+layout(set = 0, binding = 7) buffer TextureFeedbackBuffer {
+	int desiredMips[];
+}textureFeedbackBuffer;
+
 layout(set = 1, binding = 0) uniform CameraGeneralUbo {
 	mat4 view;
 	mat4 proj;
@@ -399,14 +409,32 @@ float hash(uint x) {
      return 1.0f - (t / 1073741824.0f);
 }
 
+//Reports the mip the texture is sampled at to the texture streamer, on one pixel out of 16 to limit the atomics
+void writeTextureFeedback(uint textureId, vec2 uvDx, vec2 uvDy)
+{
+	if(((uint(gl_FragCoord.x) | uint(gl_FragCoord.y)) & 3u) != 0u)
+	{
+		return;
+	}
+	vec2 extent = vec2(textureSize(texSampler[textureId], 0));
+	vec2 texelDx = uvDx * extent;
+	vec2 texelDy = uvDy * extent;
+	float lod = 0.5 * log2(max(max(dot(texelDx, texelDx), dot(texelDy, texelDy)), 1e-8));
+	atomicMin(textureFeedbackBuffer.desiredMips[PushConstants.frameId * MAX_TEXTURE_COUNT + textureId], int(floor(lod)));
+}
+
 void main(){
 	Material material = materialUbo[PushConstants.materialId].material;	
+	//Derivatives are taken in uniform control flow, before any discard
+	vec2 uvDx = dFdx(fragTexCoord);
+	vec2 uvDy = dFdy(fragTexCoord);
 
 	/*ALBEDO*/
 	vec4 albedo = material.baseColor;
 	if(material.hasAlbedoTexture == TRUE)
 	{
 		albedo *= texture(texSampler[material.albedoTextureId], fragTexCoord);
+		writeTextureFeedback(material.albedoTextureId, uvDx, uvDy);
 	}
 
 	/*ALPHA MODE*/
@@ -452,8 +480,11 @@ void main(){
 
 		mat3 TBN = mat3(tangent, bitangent, normal);
 		vec3 localNormal = texture(texSampler[material.normalTextureId], fragTexCoord).rgb;
+		writeTextureFeedback(material.normalTextureId, uvDx, uvDy);
 		localNormal.y = 1 - localNormal.y;
-		localNormal = 2* localNormal - 1;
+		//z is rebuilt from xy, baked normal maps only store two channels
+		localNormal.xy = 2* localNormal.xy - 1;
+		localNormal.z = sqrt(max(1 - dot(localNormal.xy, localNormal.xy), 0));
 		normal = normalize(TBN * localNormal);
 	}
 	
@@ -463,6 +494,7 @@ void main(){
 	if(material.hasMetallicRoughnessTexture == TRUE)
 	{
 		vec4 metallicRoughnessTexture = texture(texSampler[material.metallicRoughnessTextureId], fragTexCoord);
+		writeTextureFeedback(material.metallicRoughnessTextureId, uvDx, uvDy);
 		metallic *= metallicRoughnessTexture.b;
 		roughness *= metallicRoughnessTexture.g;
 		roughness = max(roughness, 0.001);
@@ -472,6 +504,7 @@ void main(){
 	vec3 emissiveColor = material.emissiveColor.rgb;
 	if(material.hasEmissiveTexture == TRUE){
 		emissiveColor *= texture(texSampler[material.emissiveTextureId], fragTexCoord).rgb;
+		writeTextureFeedback(material.emissiveTextureId, uvDx, uvDy);
 	}
 
 	uint cascadeIndex[2] = uint[2](0, 0);
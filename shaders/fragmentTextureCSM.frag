@@ -261,7 +261,9 @@ void main(){
 	mat3 TBN = mat3(tangent, bitangent, normal);
 	vec3 localNormal = texture(texSampler[PushConstants.normalMapId], fragTexCoord).rgb;
 	localNormal.y = 1 - localNormal.y;
-	localNormal = 2* localNormal - 1;
+	//z is rebuilt from xy, baked normal maps only store two channels
+	localNormal.xy = 2* localNormal.xy - 1;
+	localNormal.z = sqrt(max(1 - dot(localNormal.xy, localNormal.xy), 0));
 	normal = normalize(TBN * localNormal);
 
 
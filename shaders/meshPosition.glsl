@@ -0,0 +1,36 @@
+//Position only stream and the base shell position, shared by meshDepth.mesh and meshPBR.mesh
+//The main pass tests its depth against the pre-pass one without writing it: both compute the base shell here, and gl_Position is invariant in both
+//MeshInfo and QUANTIZED_VERTICES are declared by the including shader
+
+out gl_MeshPerVertexEXT {
+  invariant vec4 gl_Position;
+} gl_MeshVerticesEXT[];
+
+layout(set = 0, binding = 6) buffer QuantizedPositionBuffer {
+  uvec2 quantizedPositions[]; //unorm16 x3 over the mesh bounds, 16 bits padding
+}quantizedPositionBuffer;
+
+layout(set = 0, binding = 6) buffer PositionBuffer {
+  vec4 positions[];
+}positionBuffer;
+
+vec3 loadPosition(uint vertexIndex, MeshInfo meshInfo)
+{
+  if(!QUANTIZED_VERTICES)
+    return positionBuffer.positions[vertexIndex].xyz;
+
+  uvec2 quantized = quantizedPositionBuffer.quantizedPositions[vertexIndex];
+  vec3 pos = vec3(unpackUnorm2x16(quantized.x), unpackUnorm2x16(quantized.y).x);
+  return meshInfo.positionBounds.xyz + pos * meshInfo.positionBounds.w;
+}
+
+//World position of the surface itself, without any offset along the normal
+vec4 loadBasePositionWorld(mat4 model, uint vertexIndex, MeshInfo meshInfo)
+{
+  return model * vec4(loadPosition(vertexIndex, meshInfo), 1.0);
+}
+
+vec4 projectPosition(mat4 view, mat4 proj, vec4 positionWorld)
+{
+  return proj * view * positionWorld;
+}
@@ -0,0 +1,107 @@
+#include "BindlessTextureTable.h"
+
+uint32_t BindlessTextureTable::acquire(const VulkanImage* image, vk::Sampler sampler)
+{
+	auto textureId = m_textureIds.find({ image, static_cast<VkSampler>(sampler) });
+	if (textureId != m_textureIds.end())
+	{
+		m_slots[textureId->second].referenceCount++;
+		return textureId->second;
+	}
+
+	uint32_t id;
+	if (!m_freeSlots.empty())
+	{
+		id = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else
+	{
+		if (m_slots.size() >= MAX_TEXTURE_COUNT)
+			throw std::runtime_error("Bindless texture array is full (MAX_TEXTURE_COUNT)");
+		id = static_cast<uint32_t>(m_slots.size());
+		m_slots.emplace_back();
+		for (auto& writtenInfos : m_writtenInfos)
+		{
+			writtenInfos.emplace_back();
+		}
+	}
+
+	m_slots[id] = TextureSlot{
+		.image = image,
+		.imageInfo = vk::DescriptorImageInfo{
+			.sampler = sampler,
+			.imageView = image->m_imageView,
+			.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+		},
+		.referenceCount = 1,
+	};
+	m_textureIds.emplace(std::make_pair(image, static_cast<VkSampler>(sampler)), id);
+
+	if (!m_hasWarned && getTextureCount() >= TEXTURE_COUNT_WARNING)
+	{
+		std::cerr << "Bindless texture array almost full: " << getTextureCount() << " / " << MAX_TEXTURE_COUNT << " textures" << std::endl;
+		m_hasWarned = true;
+	}
+	return id;
+}
+
+//The image of a free slot may be destroyed: the frames in flight get a null descriptor (nullDescriptor feature), the sampler is kept as it is not optional
+bool BindlessTextureTable::release(uint32_t textureId)
+{
+	TextureSlot& slot = m_slots[textureId];
+	assert(slot.referenceCount > 0);
+	if (--slot.referenceCount > 0)
+		return false;
+
+	m_textureIds.erase({ slot.image, static_cast<VkSampler>(slot.imageInfo.sampler) });
+	slot.image = nullptr;
+	slot.imageInfo.imageView = VK_NULL_HANDLE;
+	m_freeSlots.push_back(textureId);
+	return true;
+}
+
+void BindlessTextureTable::setImageView(uint32_t textureId, vk::ImageView imageView)
+{
+	m_slots[textureId].imageInfo.imageView = imageView;
+}
+
+std::vector<vk::DescriptorImageInfo> BindlessTextureTable::getImageInfos()
+{
+	std::vector<vk::DescriptorImageInfo> imageInfos;
+	imageInfos.reserve(m_slots.size());
+	for (const TextureSlot& slot : m_slots)
+	{
+		imageInfos.push_back(slot.imageInfo);
+	}
+	for (auto& writtenInfos : m_writtenInfos)
+	{
+		writtenInfos = imageInfos;
+	}
+	return imageInfos;
+}
+
+//Free slots are written too, with their null descriptor
+std::vector<TextureDescriptorUpdate> BindlessTextureTable::takeUpdates(uint32_t currentFrame)
+{
+	std::vector<TextureDescriptorUpdate> updates;
+	for (uint32_t id = 0; id < m_slots.size(); id++)
+	{
+		if (m_writtenInfos[currentFrame][id] == m_slots[id].imageInfo)
+			continue;
+		updates.push_back(TextureDescriptorUpdate{ id, m_slots[id].imageInfo });
+		m_writtenInfos[currentFrame][id] = m_slots[id].imageInfo;
+	}
+	return updates;
+}
+
+vk::ImageView BindlessTextureTable::getWrittenView(uint32_t currentFrame, uint32_t textureId) const
+{
+	return m_writtenInfos[currentFrame][textureId].imageView;
+}
+
+//Indices in use
+uint32_t BindlessTextureTable::getTextureCount() const
+{
+	return static_cast<uint32_t>(m_slots.size() - m_freeSlots.size());
+}
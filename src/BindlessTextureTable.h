@@ -0,0 +1,48 @@
+/*
+author: Pyrrha Tocquet
+date: 17/10/26
+desc: Texture array of a scene, indexed by the materials: each image and sampler pair gets one stable bindless index, shared by every material using it
+Indices are reference counted and reused once released. The descriptor sets of the frames in flight are only written where their content changed
+*/
+
+#pragma once
+#include "Defs.h"
+#include "VulkanImage.h"
+#include <array>
+#include <map>
+
+//New image of a texture array element, written in the descriptor sets of a frame in flight
+struct TextureDescriptorUpdate {
+	uint32_t textureId;
+	vk::DescriptorImageInfo imageInfo;
+};
+
+class BindlessTextureTable
+{
+private:
+	struct TextureSlot {
+		const VulkanImage* image = nullptr;
+		vk::DescriptorImageInfo imageInfo;
+		uint32_t referenceCount = 0;
+	};
+
+	std::vector<TextureSlot> m_slots;
+	std::vector<uint32_t> m_freeSlots;
+	std::map<std::pair<const VulkanImage*, VkSampler>, uint32_t> m_textureIds;
+	std::array<std::vector<vk::DescriptorImageInfo>, MAX_FRAMES_IN_FLIGHT> m_writtenInfos; //Content of the descriptor sets of each frame in flight
+	bool m_hasWarned = false;
+public:
+	//Returns the index of the pair, the image content is deduplicated by the TextureRegistry
+	[[nodiscard]] uint32_t acquire(const VulkanImage* image, vk::Sampler sampler);
+	//Returns true when the index is free, its descriptors are then written as null descriptors
+	bool release(uint32_t textureId);
+	//Samples another image (streamed mips) at the same index
+	void setImageView(uint32_t textureId, vk::ImageView imageView);
+
+	//Content of the whole array, the descriptor sets created with it are up to date
+	[[nodiscard]] std::vector<vk::DescriptorImageInfo> getImageInfos();
+	//Elements of the frame in flight descriptor sets that changed since they were last written
+	[[nodiscard]] std::vector<TextureDescriptorUpdate> takeUpdates(uint32_t currentFrame);
+	[[nodiscard]] vk::ImageView getWrittenView(uint32_t currentFrame, uint32_t textureId) const;
+	[[nodiscard]] uint32_t getTextureCount() const;
+};
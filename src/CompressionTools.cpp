@@ -0,0 +1,481 @@
+#include "CompressionTools.h"
+#include "GeometryTools.h"
+#include <cstring>
+#include <algorithm>
+#include <bit>
+#include <atomic>
+#if defined(__SSE2__) || defined(_M_X64)
+#define CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace CompressionTools {
+
+    constexpr uint32_t LZ_MIN_MATCH = 4;
+    constexpr uint32_t LZ_MAX_OFFSET = 65535;
+    constexpr uint32_t LZ_HASH_BITS = 14;
+    constexpr size_t LZ_DECODE_SLACK = 16; //Literals and matches are copied 16 bytes at a time and may write past their end
+
+    uint32_t read32(const uint8_t* p)
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    uint64_t read64(const uint8_t* p)
+    {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    // Lengths above 15 spill in extra bytes: 255 means another byte follows
+    void writeLength(std::vector<uint8_t>& out, size_t length)
+    {
+        for (; length >= 255; length -= 255)
+            out.push_back(255);
+        out.push_back(static_cast<uint8_t>(length));
+    }
+
+    // Sequence: token (literal length << 4 | match length - LZ_MIN_MATCH), literals, 16 bit offset. The last sequence has no match
+    void writeSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalLength, uint32_t offset, size_t matchLength)
+    {
+        size_t matchCode = matchLength - LZ_MIN_MATCH;
+        out.push_back(static_cast<uint8_t>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15)));
+        if (literalLength >= 15)
+            writeLength(out, literalLength - 15);
+        out.insert(out.end(), literals, literals + literalLength);
+
+        out.push_back(static_cast<uint8_t>(offset));
+        out.push_back(static_cast<uint8_t>(offset >> 8));
+        if (matchCode >= 15)
+            writeLength(out, matchCode - 15);
+    }
+
+    void writeLastLiterals(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalLength)
+    {
+        out.push_back(static_cast<uint8_t>(std::min<size_t>(literalLength, 15) << 4));
+        if (literalLength >= 15)
+            writeLength(out, literalLength - 15);
+        out.insert(out.end(), literals, literals + literalLength);
+    }
+
+    size_t matchLength(const uint8_t* a, const uint8_t* b, const uint8_t* end)
+    {
+        const uint8_t* start = b;
+        while (b + 8 <= end)
+        {
+            uint64_t diff = read64(a) ^ read64(b);
+            if (diff != 0)
+                return b - start + (std::countr_zero(diff) >> 3);
+            a += 8;
+            b += 8;
+        }
+        while (b < end && *a == *b)
+        {
+            a++;
+            b++;
+        }
+        return b - start;
+    }
+
+    // Greedy hash chain free LZ77, the encoder only runs at bake time
+    void lzCompress(const uint8_t* src, size_t size, std::vector<uint8_t>& out)
+    {
+        std::vector<int32_t> table(size_t(1) << LZ_HASH_BITS, -1);
+        const uint8_t* end = src + size;
+        size_t anchor = 0;
+        size_t ip = 0;
+
+        auto hash = [](uint32_t sequence){ return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS); };
+
+        while (ip + LZ_MIN_MATCH <= size)
+        {
+            uint32_t sequence = read32(src + ip);
+            uint32_t h = hash(sequence);
+            int32_t candidate = table[h];
+            table[h] = static_cast<int32_t>(ip);
+
+            if (candidate < 0 || ip - candidate > LZ_MAX_OFFSET || read32(src + candidate) != sequence)
+            {
+                ip++;
+                continue;
+            }
+
+            size_t length = LZ_MIN_MATCH + matchLength(src + candidate + LZ_MIN_MATCH, src + ip + LZ_MIN_MATCH, end);
+            writeSequence(out, src + anchor, ip - anchor, static_cast<uint32_t>(ip - candidate), length);
+            ip += length;
+            anchor = ip;
+
+            //Keeps the table warm right before the next position
+            if (ip >= 2 && ip - 2 + LZ_MIN_MATCH <= size)
+                table[hash(read32(src + ip - 2))] = static_cast<int32_t>(ip - 2);
+        }
+        writeLastLiterals(out, src + anchor, size - anchor);
+    }
+
+    size_t readLength(const uint8_t*& ip, const uint8_t* end)
+    {
+        size_t length = 0;
+        uint8_t b;
+        do {
+            if (ip >= end)
+                throw std::runtime_error("Truncated LZ stream");
+            b = *ip++;
+            length += b;
+        } while (b == 255);
+        return length;
+    }
+
+    // dst must have LZ_DECODE_SLACK writable bytes past dstSize
+    void lzDecompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+    {
+        const uint8_t* ip = src;
+        const uint8_t* const iend = src + srcSize;
+        uint8_t* op = dst;
+        uint8_t* const oend = dst + dstSize;
+
+        while (true)
+        {
+            if (ip >= iend)
+                throw std::runtime_error("Truncated LZ stream");
+            const uint8_t token = *ip++;
+
+            size_t literalLength = token >> 4;
+            if (literalLength == 15)
+                literalLength += readLength(ip, iend);
+            if (literalLength > size_t(iend - ip) || literalLength > size_t(oend - op))
+                throw std::runtime_error("Corrupted LZ stream");
+
+            if (literalLength + LZ_DECODE_SLACK <= size_t(iend - ip))
+            {
+                //Wild copy, the bytes written past the literals are within the slack and overwritten by what follows
+                for (size_t i = 0; i < literalLength; i += 16)
+                    memcpy(op + i, ip + i, 16);
+            }
+            else
+            {
+                memcpy(op, ip, literalLength);
+            }
+            op += literalLength;
+            ip += literalLength;
+
+            if (ip == iend)
+                break;
+
+            if (iend - ip < 2)
+                throw std::runtime_error("Truncated LZ stream");
+            const size_t offset = ip[0] | (size_t(ip[1]) << 8);
+            ip += 2;
+
+            size_t length = (token & 15) + LZ_MIN_MATCH;
+            if ((token & 15) == 15)
+                length += readLength(ip, iend);
+            if (offset == 0 || offset > size_t(op - dst) || length > size_t(oend - op))
+                throw std::runtime_error("Corrupted LZ stream");
+
+            const uint8_t* match = op - offset;
+            uint8_t* matchEnd = op + length;
+            if (offset >= 16)
+            {
+                for (; op < matchEnd; op += 16, match += 16)
+                    memcpy(op, match, 16);
+            }
+            else if (offset >= 8)
+            {
+                for (; op < matchEnd; op += 8, match += 8)
+                    memcpy(op, match, 8);
+            }
+            else if (offset == 1)
+            {
+                memset(op, *match, length);
+            }
+            else
+            {
+                for (; op < matchEnd; op++, match++)
+                    *op = *match;
+            }
+            op = matchEnd;
+        }
+
+        if (op != oend)
+            throw std::runtime_error("LZ stream size mismatch");
+    }
+
+    template <typename T>
+    T zigzag(T delta)
+    {
+        using Signed = std::make_signed_t<T>;
+        Signed s = static_cast<Signed>(delta);
+        return static_cast<T>((static_cast<T>(s) << 1) ^ static_cast<T>(s >> (sizeof(T) * 8 - 1)));
+    }
+
+    template <typename T>
+    T unzigzag(T value)
+    {
+        return static_cast<T>((value >> 1) ^ static_cast<T>(0 - (value & 1)));
+    }
+
+    // Delta codes each lane against the previous element, then splits the bytes in planes (all the byte 0, then all the byte 1...)
+    template <typename T>
+    void filterChunk(const uint8_t* src, uint32_t count, uint32_t elementSize, uint8_t* planes)
+    {
+        const uint32_t laneCount = elementSize / sizeof(T);
+        for (uint32_t e = 0; e < count; e++)
+        {
+            for (uint32_t l = 0; l < laneCount; l++)
+            {
+                T current, previous = 0;
+                memcpy(&current, src + e * elementSize + l * sizeof(T), sizeof(T));
+                if (e > 0)
+                    memcpy(&previous, src + (e - 1) * elementSize + l * sizeof(T), sizeof(T));
+
+                T value = sizeof(T) == 1 ? current : zigzag(static_cast<T>(current - previous));
+                for (uint32_t b = 0; b < sizeof(T); b++)
+                    planes[(l * sizeof(T) + b) * count + e] = static_cast<uint8_t>(value >> (8 * b));
+            }
+        }
+    }
+
+    // Rebuilds one lane: byte planes to integers, zigzag, prefix sum
+    template <typename T>
+    void decodeLane(const uint8_t* lanePlanes, uint32_t count, T* outValues)
+    {
+        uint32_t e = 0;
+        T accumulator = 0;
+#ifdef CODEC_SSE2
+        //16 elements per iteration: interleaving the planes gives the integers, the prefix sum is done in log steps within the register
+        if constexpr (sizeof(T) == 2)
+        {
+            __m128i carry = _mm_setzero_si128();
+            for (; e + 16 <= count; e += 16)
+            {
+                __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanePlanes + e));
+                __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanePlanes + count + e));
+                __m128i values[2] = { _mm_unpacklo_epi8(p0, p1), _mm_unpackhi_epi8(p0, p1) };
+                for (__m128i& v : values)
+                {
+                    v = _mm_xor_si128(_mm_srli_epi16(v, 1), _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(v, _mm_srli_epi16(_mm_set1_epi16(-1), 15))));
+                    v = _mm_add_epi16(v, _mm_slli_si128(v, 2));
+                    v = _mm_add_epi16(v, _mm_slli_si128(v, 4));
+                    v = _mm_add_epi16(v, _mm_slli_si128(v, 8));
+                    v = _mm_add_epi16(v, carry);
+                    __m128i last = _mm_shufflehi_epi16(v, 0xFF);
+                    carry = _mm_unpackhi_epi64(last, last);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(outValues + e + (&v - values) * 8), v);
+                }
+            }
+            accumulator = static_cast<T>(_mm_extract_epi16(carry, 0));
+        }
+        else if constexpr (sizeof(T) == 4)
+        {
+            __m128i carry = _mm_setzero_si128();
+            for (; e + 16 <= count; e += 16)
+            {
+                __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanePlanes + e));
+                __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanePlanes + count + e));
+                __m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanePlanes + 2 * count + e));
+                __m128i p3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanePlanes + 3 * count + e));
+                __m128i low01 = _mm_unpacklo_epi8(p0, p1), high01 = _mm_unpackhi_epi8(p0, p1);
+                __m128i low23 = _mm_unpacklo_epi8(p2, p3), high23 = _mm_unpackhi_epi8(p2, p3);
+                __m128i values[4] = { _mm_unpacklo_epi16(low01, low23), _mm_unpackhi_epi16(low01, low23), _mm_unpacklo_epi16(high01, high23), _mm_unpackhi_epi16(high01, high23) };
+                for (__m128i& v : values)
+                {
+                    v = _mm_xor_si128(_mm_srli_epi32(v, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(v, _mm_srli_epi32(_mm_set1_epi32(-1), 31))));
+                    v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+                    v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+                    v = _mm_add_epi32(v, carry);
+                    carry = _mm_shuffle_epi32(v, 0xFF);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(outValues + e + (&v - values) * 4), v);
+                }
+            }
+            accumulator = static_cast<T>(_mm_cvtsi128_si32(carry));
+        }
+#endif
+        for (; e < count; e++)
+        {
+            T value = 0;
+            for (uint32_t b = 0; b < sizeof(T); b++)
+                value |= static_cast<T>(static_cast<T>(lanePlanes[b * count + e]) << (8 * b));
+            accumulator += unzigzag(value);
+            outValues[e] = accumulator;
+        }
+    }
+
+    // Lane by lane: byte planes back to delta decoded integers, then scattered to the elements
+    template <typename T>
+    void unfilterChunk(const uint8_t* planes, uint32_t count, uint32_t elementSize, uint8_t* dst)
+    {
+        const uint32_t laneCount = elementSize / sizeof(T);
+        if constexpr (sizeof(T) == 1)
+        {
+            //No delta coding, only the transposition
+            for (uint32_t l = 0; l < laneCount; l++)
+            {
+                const uint8_t* plane = planes + l * count;
+                for (uint32_t e = 0; e < count; e++)
+                    dst[e * elementSize + l] = plane[e];
+            }
+            return;
+        }
+
+        if (laneCount == 1)
+        {
+            decodeLane<T>(planes, count, reinterpret_cast<T*>(dst));
+            return;
+        }
+
+        thread_local std::vector<T> values;
+        values.resize(count);
+        for (uint32_t l = 0; l < laneCount; l++)
+        {
+            decodeLane<T>(planes + l * sizeof(T) * count, count, values.data());
+
+            uint8_t* laneDst = dst + l * sizeof(T);
+            for (uint32_t e = 0; e < count; e++)
+                memcpy(laneDst + e * elementSize, values.data() + e, sizeof(T));
+        }
+    }
+
+    void filter(const uint8_t* src, uint32_t count, uint32_t elementSize, uint32_t laneSize, uint8_t* planes)
+    {
+        switch (laneSize)
+        {
+        case 1: filterChunk<uint8_t>(src, count, elementSize, planes); break;
+        case 2: filterChunk<uint16_t>(src, count, elementSize, planes); break;
+        case 4: filterChunk<uint32_t>(src, count, elementSize, planes); break;
+        default: throw std::runtime_error("Unsupported codec lane size");
+        }
+    }
+
+    void unfilter(const uint8_t* planes, uint32_t count, uint32_t elementSize, uint32_t laneSize, uint8_t* dst)
+    {
+        switch (laneSize)
+        {
+        case 1: unfilterChunk<uint8_t>(planes, count, elementSize, dst); break;
+        case 2: unfilterChunk<uint16_t>(planes, count, elementSize, dst); break;
+        case 4: unfilterChunk<uint32_t>(planes, count, elementSize, dst); break;
+        default: throw std::runtime_error("Unsupported codec lane size");
+        }
+    }
+
+    void encode(const void* data, size_t size, uint32_t elementSize, uint32_t laneSize, std::vector<std::byte>& outEncoded)
+    {
+        if (elementSize == 0 || elementSize % laneSize != 0 || size % elementSize != 0)
+            throw std::runtime_error("Codec element size must be a multiple of the lane size");
+
+        const uint8_t* src = static_cast<const uint8_t*>(data);
+        const uint32_t chunkElements = std::max(1u, CODEC_CHUNK_SIZE / elementSize);
+        const size_t chunkSize = size_t(chunkElements) * elementSize;
+
+        StreamHeader header{};
+        header.elementSize = elementSize;
+        header.laneSize = laneSize;
+        header.chunkCount = static_cast<uint32_t>((size + chunkSize - 1) / chunkSize);
+        header.decodedSize = size;
+
+        //Chunks are encoded in parallel and concatenated in order
+        std::vector<ChunkEntry> chunks(header.chunkCount);
+        std::vector<std::vector<uint8_t>> payloads(header.chunkCount);
+        GeometryTools::runParallel(header.chunkCount, 0, [&](uint32_t c){
+            const size_t begin = c * chunkSize;
+            const uint32_t decoded = static_cast<uint32_t>(std::min(chunkSize, size - begin));
+            std::vector<uint8_t> planes(decoded);
+            filter(src + begin, decoded / elementSize, elementSize, laneSize, planes.data());
+            lzCompress(planes.data(), planes.size(), payloads[c]);
+
+            chunks[c].decodedSize = decoded;
+            chunks[c].encoding = FilteredLzChunk;
+            if (payloads[c].size() >= decoded)
+            {
+                payloads[c].assign(src + begin, src + begin + decoded);
+                chunks[c].encoding = RawChunk;
+            }
+            chunks[c].storedSize = static_cast<uint32_t>(payloads[c].size());
+        });
+
+        uint64_t offset = 0;
+        for (ChunkEntry& chunk : chunks)
+        {
+            chunk.offset = offset;
+            offset += chunk.storedSize;
+        }
+
+        const size_t start = outEncoded.size();
+        outEncoded.resize(start + sizeof(StreamHeader) + chunks.size() * sizeof(ChunkEntry) + offset);
+        std::byte* out = outEncoded.data() + start;
+        memcpy(out, &header, sizeof(StreamHeader));
+        memcpy(out + sizeof(StreamHeader), chunks.data(), chunks.size() * sizeof(ChunkEntry));
+        out += sizeof(StreamHeader) + chunks.size() * sizeof(ChunkEntry);
+        for (uint32_t c = 0; c < header.chunkCount; c++)
+            memcpy(out + chunks[c].offset, payloads[c].data(), payloads[c].size());
+    }
+
+    StreamHeader readHeader(const std::byte* encoded, size_t encodedSize)
+    {
+        StreamHeader header;
+        if (encodedSize < sizeof(StreamHeader))
+            throw std::runtime_error("Truncated codec stream");
+        memcpy(&header, encoded, sizeof(StreamHeader));
+        if (header.magic != CODEC_MAGIC || encodedSize < sizeof(StreamHeader) + size_t(header.chunkCount) * sizeof(ChunkEntry))
+            throw std::runtime_error("Corrupted codec stream");
+        return header;
+    }
+
+    uint64_t decodedSize(const std::byte* encoded, size_t encodedSize)
+    {
+        return readHeader(encoded, encodedSize).decodedSize;
+    }
+
+    void decode(const std::byte* encoded, size_t encodedSize, std::byte* outDecoded, size_t decodedSize, uint32_t threadCount)
+    {
+        const StreamHeader header = readHeader(encoded, encodedSize);
+        if (header.decodedSize != decodedSize)
+            throw std::runtime_error("Codec stream size mismatch");
+
+        std::vector<ChunkEntry> chunks(header.chunkCount);
+        memcpy(chunks.data(), encoded + sizeof(StreamHeader), chunks.size() * sizeof(ChunkEntry));
+        if (header.elementSize == 0)
+            throw std::runtime_error("Corrupted codec stream");
+        const std::byte* payload = encoded + sizeof(StreamHeader) + chunks.size() * sizeof(ChunkEntry);
+        const size_t payloadSize = encodedSize - (payload - encoded);
+
+        const uint32_t chunkElements = std::max(1u, CODEC_CHUNK_SIZE / header.elementSize);
+        const size_t chunkSize = size_t(chunkElements) * header.elementSize;
+
+        //Workers cannot throw across threads, the first error is rethrown once every chunk is done
+        std::atomic<bool> failed = false;
+        GeometryTools::runParallel(header.chunkCount, threadCount, [&](uint32_t c){
+            const ChunkEntry& chunk = chunks[c];
+            const size_t begin = c * chunkSize;
+            if (chunk.offset + chunk.storedSize > payloadSize || begin + chunk.decodedSize > decodedSize || chunk.decodedSize % header.elementSize != 0)
+            {
+                failed = true;
+                return;
+            }
+
+            const uint8_t* src = reinterpret_cast<const uint8_t*>(payload + chunk.offset);
+            uint8_t* dst = reinterpret_cast<uint8_t*>(outDecoded + begin);
+            if (chunk.encoding == RawChunk)
+            {
+                memcpy(dst, src, chunk.decodedSize);
+                return;
+            }
+
+            thread_local std::vector<uint8_t> planes;
+            planes.resize(chunk.decodedSize + LZ_DECODE_SLACK);
+            try {
+                lzDecompress(src, chunk.storedSize, planes.data(), chunk.decodedSize);
+                unfilter(planes.data(), chunk.decodedSize / header.elementSize, header.elementSize, header.laneSize, dst);
+            }
+            catch (const std::exception&)
+            {
+                failed = true;
+            }
+        });
+
+        if (failed)
+            throw std::runtime_error("Corrupted codec stream");
+    }
+}
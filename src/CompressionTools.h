@@ -0,0 +1,35 @@
+#pragma once
+#include "Defs.h"
+
+//Dependency free codec for baked geometry: delta + zigzag per lane, byte plane transposition, then LZ
+//Streams are cut in chunks decodable independently, so decoding scales with the thread count
+namespace CompressionTools {
+    constexpr uint32_t CODEC_CHUNK_SIZE = 1 << 16; //Decoded bytes per chunk (rounded down to whole elements)
+    constexpr uint32_t CODEC_MAGIC = 0x43445950; //"PYDC"
+
+    struct StreamHeader {
+        uint32_t magic = CODEC_MAGIC;
+        uint32_t elementSize = 1;
+        uint32_t laneSize = 1; //Width of the delta coded integers, 1 disables delta coding
+        uint32_t chunkCount = 0;
+        uint64_t decodedSize = 0;
+    };
+
+    enum ChunkEncoding : uint32_t {
+        RawChunk, //Stored as is, when filtering and LZ did not make it smaller
+        FilteredLzChunk,
+    };
+
+    struct ChunkEntry {
+        uint64_t offset = 0; //From the end of the chunk table
+        uint32_t storedSize = 0;
+        uint32_t decodedSize = 0;
+        uint32_t encoding = RawChunk;
+        uint32_t padding = 0;
+    };
+
+    //elementSize must be a multiple of laneSize (1, 2 or 4), each lane is delta coded against the same lane of the previous element
+    void encode(const void* data, size_t size, uint32_t elementSize, uint32_t laneSize, std::vector<std::byte>& outEncoded);
+    [[nodiscard]]uint64_t decodedSize(const std::byte* encoded, size_t encodedSize);
+    void decode(const std::byte* encoded, size_t encodedSize, std::byte* outDecoded, size_t decodedSize, uint32_t threadCount = 0);
+}
@@ -10,12 +10,21 @@
 
 /* RENDERING CONSTS*/
 const bool ENABLE_MSAA = false;
+const bool ENABLE_VERTEX_QUANTIZATION = true; //Mesh shaders read QuantizedVertex instead of Vertex (specialization constant 0)
+const float LOD_PIXEL_ERROR = 1.0f; //Meshlet LODs are selected so that their simplification error projects below this many pixels
 const uint32_t SHADOW_CASCADE_COUNT = 4;
 const uint32_t MAX_LIGHT_COUNT = 10;
 const uint32_t MAX_TEXTURE_COUNT = 4096;
+const uint32_t TEXTURE_COUNT_WARNING = MAX_TEXTURE_COUNT - MAX_TEXTURE_COUNT / 8; //Bindless array usage reported once it is reached
 const uint32_t MAX_MATERIAL_COUNT = 4096;
+const bool ENABLE_TEXTURE_STREAMING = true; //Baked textures start with their mip tail only, finer mips are streamed from the fragment shader feedback
+const uint32_t TEXTURE_STREAMING_TAIL_SIZE = 128; //Largest extent of the mips loaded with the scene
+const vk::DeviceSize TEXTURE_STREAMING_BUDGET = vk::DeviceSize(512) << 20; //Memory of the streamed mips, the tails are not counted
+const uint32_t TEXTURE_STREAMING_MAX_LOADS = 4; //Textures loading finer mips at the same time
 
 const std::filesystem::path BAKED_ASSETS_PATH = "baked_assets/";
+const uint32_t BAKED_MODEL_VERSION = 11; //Bump when the baked model layout changes, older files get rebaked
+const bool ENABLE_BAKED_MODEL_COMPRESSION = true; //Baked geometry goes through CompressionTools, raw files are mapped without any copy but are ~2x larger
 
 /* ENUMS */
 enum RenderPassesId {
@@ -56,9 +65,16 @@ struct ModelPushConstant {
 	uint32_t meshlet;
 	uint32_t meshletCount;
 	uint32_t shellCount = 8;
+	uint32_t frameId = 0; //Frame in flight, selects the culling statistics slot and the texture feedback slot written by fragmentPBR.frag
+	float lodPixelScale = 0.f; //Half the viewport height over LOD_PIXEL_ERROR: converts a projected LOD error to tolerance units
 	//float padding[5];
 };
 
+struct MeshletCullingStats {
+	uint32_t testedMeshlets = 0;
+	uint32_t coneRejectedMeshlets = 0;
+};
+
 struct Time {
 	float elapsedSinceStart;
 	float deltaTime;
@@ -66,12 +82,23 @@ struct Time {
 
 struct MeshletIndexingInfo{
 	glm::vec4 boundingSphere = glm::vec4();
+	glm::vec4 normalCone = glm::vec4(0.f, 0.f, 0.f, 1.f); //xyz: cone axis, w: cutoff (sine of the cone half angle), 1 disables cone culling
 	uint32_t vertexCount = 0;
 	uint32_t vertexOffset = 0;
 	uint32_t primitiveCount = 0;
 	uint32_t primitiveOffset = 0;
 	uint32_t meshletId = 0;
-	uint64_t padding = 0;
+	uint32_t meshId = 0; //Index in the scene MeshInfo buffer
+	float lodError = 0.f; //Simplification error of the group this meshlet was built from, 0 at full resolution
+	float parentLodError = -1.f; //Error of the meshlets built from this meshlet's group, negative for roots of the hierarchy
+	glm::vec4 lodBounds = glm::vec4(); //Sphere of the group this meshlet was built from, lodError is projected from it
+	glm::vec4 parentLodBounds = glm::vec4();
+};
+
+//Per mesh data shared by its meshlets
+struct MeshInfo {
+	glm::vec4 positionBounds = glm::vec4(0.f, 0.f, 0.f, 1.f); //xyz: minimum, w: largest extent (positions are quantized on a uniform grid)
+	glm::vec4 texCoordBounds = glm::vec4(0.f, 0.f, 1.f, 1.f); //xy: minimum, zw: extent
 };
 
 
@@ -145,12 +172,38 @@ struct Vertex {
 	}
 };
 
+//Compressed vertex layout (20 bytes instead of 64), decoded in the mesh shaders with the mesh MeshInfo
+struct QuantizedVertex {
+	uint16_t pos[3]; //Unorm inside MeshInfo::positionBounds
+	uint16_t texCoord[2]; //Unorm inside MeshInfo::texCoordBounds
+	uint16_t padding = 0;
+	uint32_t normal; //Octahedral, two snorm16
+	uint32_t tangent; //Octahedral, two unorm15, bit 31 set for negative handedness
+};
+static_assert(sizeof(QuantizedVertex) == 20);
+
+const vk::DeviceSize VERTEX_BUFFER_STRIDE = ENABLE_VERTEX_QUANTIZATION ? sizeof(QuantizedVertex) : sizeof(Vertex);
+
+//Position only stream read by the shadow and depth pre-pass mesh shaders
+struct QuantizedPosition {
+	uint16_t pos[3]; //Same encoding as QuantizedVertex::pos
+	uint16_t padding = 0;
+};
+static_assert(sizeof(QuantizedPosition) == 8);
+
+//Float positions are stored as vec4 (w = 1) so the stream keeps a 16 byte std430 stride
+const vk::DeviceSize POSITION_BUFFER_STRIDE = ENABLE_VERTEX_QUANTIZATION ? sizeof(QuantizedPosition) : sizeof(glm::vec4);
+
 struct Meshlet{
+	//Local vertex indices packed in 4 bytes, read as a single uint (i0 | i1 << 8 | i2 << 16) by the mesh shaders
 	struct Triangle{
-		uint32_t i0;
-		uint32_t i1;
-		uint32_t i2;
+		uint8_t i0;
+		uint8_t i1;
+		uint8_t i2;
+		uint8_t padding = 0;
 	};
+	static_assert(sizeof(Triangle) == sizeof(uint32_t));
+	static constexpr uint32_t MAX_VERTICES = 256; //Largest meshlet vertex count addressable by a Triangle
 	std::vector<uint32_t> uniqueVertexIndices;
 	std::vector<Triangle> primitiveIndices;
 	MeshletIndexingInfo meshletInfo;
@@ -146,6 +146,7 @@ void DepthPrePass::createDescriptorPool()
 
 	vk::DescriptorPoolCreateInfo poolInfo
 	{
+		.flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind, //Texture array
 		.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT),
 		.poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
 		.pPoolSizes = poolSizes.data(),
@@ -205,6 +206,7 @@ void DepthPrePass::createDescriptorSetLayout()
 	//Descriptor indexing
 	vk::DescriptorBindingFlags bindingFlags[2];
 	bindingFlags[1] = vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eVariableDescriptorCount; //Necessary for Dynamic indexing (VK_EXT_descriptor_indexing)
+	bindingFlags[1] |= vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending; //Elements are written while the set is bound
 
 	vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo{
 		.bindingCount = 2,
@@ -213,6 +215,7 @@ void DepthPrePass::createDescriptorSetLayout()
 
     vk::DescriptorSetLayoutCreateInfo layoutInfo{
         .pNext = &bindingFlagsCreateInfo,
+		.flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
 		.bindingCount = 2,
         .pBindings = bindings,
     };
@@ -264,7 +267,7 @@ void DepthPrePass::createDescriptorSets(VulkanScene* scene, std::vector<vk::Desc
 		std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, m_mainDescriptorSetLayout);
 
 		/* Dynamic Descriptor Counts */
-		uint32_t textureMaxCount = textureImageInfos.size();
+		uint32_t textureMaxCount = MAX_TEXTURE_COUNT; //Textures added to the scene are written in place
 		std::vector<uint32_t> textureMaxCounts(MAX_FRAMES_IN_FLIGHT, textureMaxCount);
 		//std::vector<uint32_t> textureMaxCounts(MAX_FRAMES_IN_FLIGHT, materialMaxCount);
 		vk::DescriptorSetVariableDescriptorCountAllocateInfo setCounts{
@@ -385,6 +388,22 @@ void DepthPrePass::createDescriptorSets(VulkanScene* scene, std::vector<vk::Desc
 	}
 }
 
+//Writes the streamed images in the texture array of this frame's descriptor set
+void DepthPrePass::updateTextureDescriptors(uint32_t currentFrame, const std::vector<TextureDescriptorUpdate>& updates)
+{
+	std::vector<vk::WriteDescriptorSet> descriptorWrites(updates.size());
+	for (size_t i = 0; i < updates.size(); i++)
+	{
+		descriptorWrites[i].dstSet = m_mainDescriptorSet[currentFrame];
+		descriptorWrites[i].dstBinding = 1;
+		descriptorWrites[i].dstArrayElement = updates[i].textureId;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+		descriptorWrites[i].pImageInfo = &updates[i].imageInfo;
+	}
+	m_context->getDevice().updateDescriptorSets(descriptorWrites, nullptr);
+}
+
 void DepthPrePass::createPipelineLayout(vk::DescriptorSetLayout geometryDescriptorSetLayout)
 {
 	 std::array<vk::DescriptorSetLayout, 3> layouts = { geometryDescriptorSetLayout, m_mainDescriptorSetLayout, m_materialDescriptorSetLayout };
@@ -408,7 +427,7 @@ void DepthPrePass::createDefaultPipeline()
 {
 	PipelineInfo pipelineInfo{
        .taskShaderPath = "shaders/taskShell.spv",
-       .meshShaderPath = "shaders/meshPBR.spv",
+       .meshShaderPath = "shaders/meshDepth.spv",
        .fragShaderPath = "shaders/fragmentDepthPrePass.spv",
     };
 
@@ -445,6 +464,7 @@ void DepthPrePass::drawRenderPass(vk::CommandBuffer commandBuffer, uint32_t swap
     };
     ModelPushConstant pushConstant; // TODO Remove useless push constant
 	pushConstant.shellCount = 1;
+	pushConstant.lodPixelScale = 0.5f * getRenderPassExtent().height / LOD_PIXEL_ERROR; //Must match the main pass so both select the same meshlets
     commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
 
     commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_mainPipeline->getPipeline()); //Only one main draw pipeline per frame in this renderer
@@ -42,6 +42,7 @@ public:
 	virtual vk::Extent2D getRenderPassExtent();
 	virtual void drawRenderPass(vk::CommandBuffer commandBuffer, uint32_t swapchainImageIndex, uint32_t m_currentFrame, std::vector<VulkanScene*> scenes);
 	virtual void updateDescriptorSets() {};
+	virtual void updateTextureDescriptors(uint32_t currentFrame, const std::vector<TextureDescriptorUpdate>& updates);
 
 	const VulkanImage* getDepthAttachment() { assert(m_depthAttachment != nullptr); return m_depthAttachment; };
 };
\ No newline at end of file
@@ -2,34 +2,14 @@
 #include <memory>
 #include <functional>
 #include <unordered_set>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <chrono>
 
 namespace GeometryTools
 {
-    struct EdgeEntry
-    {
-        uint32_t i0;
-        uint32_t i1;
-        uint32_t i2;
-
-        uint32_t face;
-        EdgeEntry* next;
-    };
-
-    size_t vecHash(const glm::vec3& vec)
-    {
-        size_t h = 0;
-
-        for (uint32_t i = 0; i < 3; ++i)
-        {
-            uint32_t highOrd = h & 0xf8000000;
-            h = h << 5;
-            h = h ^ (highOrd >> 27);
-            h = h ^ size_t(vec[i]);
-        }
-
-        return h;
-    }
-
     glm::vec4 computeNormal(glm::vec3* tri)
     {
         
@@ -40,20 +20,43 @@ namespace GeometryTools
         glm::vec3 v01 = p0 - p1;
         glm::vec3 v02 = p0 - p2;
 
-        return glm::vec4(glm::normalize(glm::cross(v01, v02)), 0);
+        glm::vec3 n = glm::cross(v01, v02);
+        float length = glm::length(n);
+
+        //Degenerate triangles have no orientation
+        if(length <= FLT_EPSILON)
+            return glm::vec4(0.0f);
+
+        return glm::vec4(n / length, 0);
+    }
+
+    // Sentinel for "vertex not in the current meshlet" / "no adjacent triangle"
+    static const uint32_t undef = uint32_t(-1);
+
+    // Triangle waiting in the frontier of the meshlet being built. Lower scores are better.
+    struct Candidate
+    {
+        float score;
+        uint32_t triangle;
+        uint32_t version; //Meshlet state the score was computed against
+    };
+
+    // Heap ordering: std::push_heap/pop_heap build a max heap, so the lowest score has to compare as the greatest
+    bool compareCandidates(const Candidate& a, const Candidate& b)
+    {
+        return a.score > b.score;
     }
 
     // Compute number of triangle vertices already exist in the meshlet
-    uint32_t computeReuse (const Meshlet& meshlet, uint32_t (&triIndices)[3])
+    // vertexSlots maps a mesh vertex index to its local index in the meshlet being built (undef when absent)
+    uint32_t computeReuse(const std::vector<uint32_t>& vertexSlots, uint32_t (&triIndices)[3])
     {
         uint32_t count = 0;
 
-        for(uint32_t i = 0; i < static_cast<uint32_t>(meshlet.uniqueVertexIndices.size()); ++i){
-            for(uint32_t j = 0; j < 3u; ++j)
-            {
-                if (meshlet.uniqueVertexIndices[i] == triIndices[j]){
-                    ++count;
-                }
+        for(uint32_t j = 0; j < 3u; ++j)
+        {
+            if (vertexSlots[triIndices[j]] != undef){
+                ++count;
             }
         }
         return count;
@@ -61,13 +64,13 @@ namespace GeometryTools
 
 
     // Computes a candidacy score based on spatial locality, orientational coherence, and vertex re-use within a meshlet.
-    float computeScore(const Meshlet& meshlet, glm::vec4 sphere, glm::vec4 normal, uint32_t (&triIndices)[3], glm::vec3* triVerts){
+    float computeScore(const std::vector<uint32_t>& vertexSlots, glm::vec4 sphere, glm::vec4 normal, uint32_t (&triIndices)[3], glm::vec3* triVerts){
         const float reuseWeight = 0.344f;
         const float locWeight = 0.333f;
         const float oriWeight = 0.333f;
 
         //Vertex reuse
-        uint32_t reuse = computeReuse(meshlet, triIndices);
+        uint32_t reuse = computeReuse(vertexSlots, triIndices);
         float reuseScore = 1 - (float(reuse) / 3.0);
 
         float maxSq = 0;
@@ -78,7 +81,7 @@ namespace GeometryTools
         }
 
         float r = sphere.w;
-        float r2 = r * r;
+        float r2 = std::max(r * r, FLT_EPSILON); //Degenerate seed triangles have a null radius
         float locScore = std::log(maxSq / r2 + 1);
 
         //Angle between normal and meshlet cone axis
@@ -158,14 +161,22 @@ namespace GeometryTools
 
     }
 
-    // Sort in reverse order to use vector as a queue with pop_back.
-    bool compareScores(const std::pair<uint32_t, float>& a, const std::pair<uint32_t, float>& b)
+    // Grows a bounding sphere so that it encloses the point (Ritter's incremental update)
+    void growSphere(glm::vec4& sphere, const glm::vec3& point)
     {
-        return a.second > b.second;
+        glm::vec3 center = glm::vec3(sphere);
+        float dist = glm::length(point - center);
+
+        if(dist > sphere.w)
+        {
+            float radius = (sphere.w + dist) * 0.5f;
+            center += (point - center) * ((radius - sphere.w) / dist);
+            sphere = glm::vec4(center, radius);
+        }
     }
 
     // Determines whether a candidate triangle can be added to a specific meshlet; if it can, does so.
-    bool addToMeshlet(uint32_t maxPrimitives, uint32_t maxVertices, Meshlet& meshlet, uint32_t (&tri)[3]){
+    bool addToMeshlet(uint32_t maxPrimitives, uint32_t maxVertices, Meshlet& meshlet, std::vector<uint32_t>& vertexSlots, uint32_t (&tri)[3]){
 
         if(meshlet.uniqueVertexIndices.size() == maxVertices)
             return false;
@@ -173,19 +184,14 @@ namespace GeometryTools
         if(meshlet.primitiveIndices.size() == maxPrimitives)
             return false;
 
-        static const uint32_t undef = uint32_t(-1);
-        uint32_t indices[3] = {undef, undef, undef};
-        uint32_t newCount = 3;
+        uint32_t indices[3] = {vertexSlots[tri[0]], vertexSlots[tri[1]], vertexSlots[tri[2]]};
+        uint32_t newCount = 0;
 
-        for(uint32_t i = 0; i < meshlet.uniqueVertexIndices.size(); ++i)
-        {
-            for(uint32_t j = 0; j < 3; ++j){
-                if(meshlet.uniqueVertexIndices[i] == tri[j])
-                {
-                    indices[j] = i;
-                    --newCount;
-                }
-            }
+        for(uint32_t j = 0; j < 3; ++j){
+            //A vertex repeated inside a degenerate triangle is only added once
+            bool repeated = (j > 0 && tri[j] == tri[0]) || (j > 1 && tri[j] == tri[1]);
+            if(indices[j] == undef && !repeated)
+                ++newCount;
         }
 
         // Will this triangle fit ?
@@ -195,18 +201,19 @@ namespace GeometryTools
         // Add unique vertex indices to unique vertex index list
         for (uint32_t j = 0; j < 3; ++j)
         {
-            if (indices[j] == undef)
+            if (vertexSlots[tri[j]] == undef)
             {
-                indices[j] = static_cast<uint32_t>(meshlet.uniqueVertexIndices.size());
+                vertexSlots[tri[j]] = static_cast<uint32_t>(meshlet.uniqueVertexIndices.size());
                 meshlet.uniqueVertexIndices.push_back(tri[j]);
             }
+            indices[j] = vertexSlots[tri[j]];
         }
 
         //Add the primitive
         typename Meshlet::Triangle prim = {};
-        prim.i0 = indices[0];
-        prim.i1 = indices[1];
-        prim.i2 = indices[2];
+        prim.i0 = static_cast<uint8_t>(indices[0]);
+        prim.i1 = static_cast<uint8_t>(indices[1]);
+        prim.i2 = static_cast<uint8_t>(indices[2]);
 
         meshlet.primitiveIndices.push_back(prim);
 
@@ -214,397 +221,1277 @@ namespace GeometryTools
 
     }
 
+    // Bit pattern of a coordinate, -0 and +0 are the same position
+    uint32_t positionBits(float coordinate)
+    {
+        if(coordinate == 0.0f)
+            coordinate = 0.0f;
+        uint32_t bits;
+        std::memcpy(&bits, &coordinate, sizeof(uint32_t));
+        return bits;
+    }
+
+    uint64_t hashPosition(const glm::vec3& position)
+    {
+        uint64_t h = 0;
+        for(uint32_t i = 0; i < 3u; ++i)
+        {
+            h ^= positionBits(position[i]);
+            h *= 0x9E3779B97F4A7C15ull;
+            h ^= h >> 32;
+        }
+        return h;
+    }
+
+    bool samePosition(const glm::vec3& a, const glm::vec3& b)
+    {
+        return positionBits(a.x) == positionBits(b.x) && positionBits(a.y) == positionBits(b.y) && positionBits(a.z) == positionBits(b.z);
+    }
+
+    uint64_t hashEdge(uint32_t i0, uint32_t i1)
+    {
+        uint64_t h = (uint64_t(i0) << 32 | i1) * 0x9E3779B97F4A7C15ull;
+        return h ^ (h >> 32);
+    }
+
+    // Power of two table size keeping the load factor at or below one half
+    size_t openAddressingTableSize(size_t count)
+    {
+        size_t tableSize = 1;
+        while (tableSize < count * 2)
+            tableSize <<= 1;
+        return tableSize;
+    }
+
+    // Fills outAdjacency[face * 3 + i] with the face across the edge (i, i + 1), undef on open edges.
+    // Vertices are welded on their exact position first so that attribute seams do not break adjacency.
     void buildAdjacencyList(const uint32_t* indices, uint32_t indexCount, const std::vector<Vertex>& vertices, uint32_t vertexCount, uint32_t* outAdjacency){
         const uint32_t triCount = indexCount / 3;
 
-        //Create a mapping of non-unique vertex indices to unique positions
-        std::vector<uint32_t> uniquePositions; //sparse vector of positions indices. (LUT)
-        uniquePositions.resize(vertexCount);
+        //Maps each vertex to the first vertex sharing its position
+        std::vector<uint32_t> uniquePositions(vertexCount);
+        {
+            const size_t mask = openAddressingTableSize(vertexCount) - 1;
+            std::vector<uint32_t> table(mask + 1, undef);
+
+            for(uint32_t i = 0; i < vertexCount; ++i)
+            {
+                const glm::vec3& position = vertices[i].pos;
+                for(size_t slot = hashPosition(position) & mask;; slot = (slot + 1) & mask)
+                {
+                    uint32_t candidate = table[slot];
+                    if(candidate == undef)
+                    {
+                        table[slot] = i;
+                        uniquePositions[i] = i;
+                        break;
+                    }
+                    if(samePosition(vertices[candidate].pos, position))
+                    {
+                        uniquePositions[i] = candidate;
+                        break;
+                    }
+                }
+            }
+        }
+
+        //Directed edge (i0, i1) -> half edge index (face * 3 + i) in an open addressing table sized from the edge count,
+        //non manifold edges occupy several slots with the same key
+        const size_t edgeMask = openAddressingTableSize(indexCount) - 1;
+        std::vector<uint32_t> edgeTable(edgeMask + 1, undef);
 
-        std::unordered_map<size_t, uint32_t> uniquePositionsMap;
-        uniquePositions.reserve(vertexCount);
+        auto edgeStart = [&](uint32_t halfEdge){ return uniquePositions[indices[halfEdge]]; };
+        auto edgeEnd = [&](uint32_t halfEdge){ return uniquePositions[indices[halfEdge - halfEdge % 3 + (halfEdge % 3 + 1) % 3]]; };
 
-        for(uint32_t i = 0; i < vertexCount; i++){
+        for(uint32_t halfEdge = 0; halfEdge < triCount * 3; ++halfEdge)
+        {
+            size_t slot = hashEdge(edgeStart(halfEdge), edgeEnd(halfEdge)) & edgeMask;
+            while(edgeTable[slot] != undef)
+                slot = (slot + 1) & edgeMask;
+            edgeTable[slot] = halfEdge;
+        }
 
-            glm::vec3 position = vertices[i].pos;
-            size_t hash = vecHash(position);
+        auto faceNormal = [&](uint32_t face){
+            glm::vec3 p0 = vertices[indices[face * 3]].pos;
+            glm::vec3 p1 = vertices[indices[face * 3 + 1]].pos;
+            glm::vec3 p2 = vertices[indices[face * 3 + 2]].pos;
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float length = glm::length(n);
+            return length > 0.0f ? n / length : n;
+        };
 
-            auto it = uniquePositionsMap.find(hash);
-            if(it != uniquePositionsMap.end()){
-                
-                //Reference previous index when already encountered
-                uniquePositions[i] = it->second;
-            }
-            else{
-                uniquePositionsMap.insert(std::make_pair(hash, static_cast<uint32_t>(i)));
-                uniquePositions[i] = static_cast<uint32_t>(i);
+        std::fill(outAdjacency, outAdjacency + indexCount, undef);
+
+        for(uint32_t halfEdge = 0; halfEdge < triCount * 3; ++halfEdge)
+        {
+            if(outAdjacency[halfEdge] != undef)
+                continue;
+
+            const uint32_t face = halfEdge / 3;
+            const uint32_t i0 = edgeStart(halfEdge);
+            const uint32_t i1 = edgeEnd(halfEdge);
+            if(i0 == i1)
+                continue;
+
+            //Looks for unpaired half edges running the opposite way, the most coplanar face wins on non manifold edges
+            uint32_t best = undef;
+            float bestDot = -2.0f;
+            glm::vec3 normal;
+            for(size_t slot = hashEdge(i1, i0) & edgeMask; edgeTable[slot] != undef; slot = (slot + 1) & edgeMask)
+            {
+                uint32_t candidate = edgeTable[slot];
+                uint32_t candidateFace = candidate / 3;
+                if(candidateFace == face || outAdjacency[candidate] != undef || edgeStart(candidate) != i1 || edgeEnd(candidate) != i0)
+                    continue;
+
+                //Two faces sharing two edges are only linked once
+                const uint32_t* faceAdjacency = &outAdjacency[face * 3];
+                if(faceAdjacency[0] == candidateFace || faceAdjacency[1] == candidateFace || faceAdjacency[2] == candidateFace)
+                    continue;
+
+                if(best == undef)
+                    normal = faceNormal(face);
+                float dot = glm::dot(normal, faceNormal(candidateFace));
+                if(dot > bestDot)
+                {
+                    best = candidate;
+                    bestDot = dot;
+                }
             }
 
+            if(best != undef)
+            {
+                outAdjacency[halfEdge] = best / 3;
+                outAdjacency[best] = face;
+            }
         }
+    }
 
-        //Linked list of edges for each vertex to ddetermine adjacency
-        const uint32_t hashSize = vertexCount / 3;
-        std::unique_ptr<EdgeEntry*[]> hashTable(new EdgeEntry*[hashSize]);
-        std::unique_ptr<EdgeEntry[]> entries(new EdgeEntry[triCount * 3]);
+    bool isMeshletFull(uint32_t maxVerts, uint32_t maxPrims, const Meshlet& meshlet)
+    {
+        assert(meshlet.uniqueVertexIndices.size() <= maxVerts);
+        assert(meshlet.primitiveIndices.size() <= maxPrims);
 
-        std::memset(hashTable.get(), 0, sizeof(EdgeEntry*) * hashSize);
-        
-        uint32_t entryIndex = 0;
+        return meshlet.uniqueVertexIndices.size() == maxVerts || meshlet.primitiveIndices.size() == maxPrims;
+    }
 
-        //Hash table entry for each Edge.
-        for (uint32_t iFace = 0; iFace < triCount; ++iFace)
+    // Computes the meshlet normal cone: the axis is the average triangle normal, the cutoff is the sine of the angle
+    // between the axis and the furthest normal. The whole meshlet is back facing when seen from inside the cone
+    // mirrored around its apex, cutoff >= 1 means it can never be rejected.
+    glm::vec4 computeNormalCone(const Meshlet& meshlet, const std::vector<Vertex>& vertices)
+    {
+        std::vector<glm::vec3> normals;
+        normals.reserve(meshlet.primitiveIndices.size());
+
+        glm::vec3 axis = glm::vec3(0.0f);
+        for(const Meshlet::Triangle& tri : meshlet.primitiveIndices)
         {
-            uint32_t index = iFace * 3;
+            glm::vec3 points[3] = {
+                vertices[meshlet.uniqueVertexIndices[tri.i0]].pos,
+                vertices[meshlet.uniqueVertexIndices[tri.i1]].pos,
+                vertices[meshlet.uniqueVertexIndices[tri.i2]].pos,
+            };
 
-            for(uint32_t iEdge = 0; iEdge < 3; ++iEdge){
-                
-                uint32_t i0 = uniquePositions[indices[index + iEdge % 3]];
-                uint32_t i1 = uniquePositions[indices[index + (iEdge + 1) % 3]];
-                uint32_t i2 = uniquePositions[indices[index + (iEdge + 2) % 3]];
+            glm::vec3 normal = glm::vec3(computeNormal(points));
+            if(normal == glm::vec3(0.0f))
+                continue;
 
-                auto& entry = entries[entryIndex++];
-                entry.i0 = i0;
-                entry.i1 = i1;
-                entry.i2 = i2;
+            normals.push_back(normal);
+            axis += normal;
+        }
 
-                uint32_t key = entry.i0 % hashSize;
+        float axisLength = glm::length(axis);
+        if(axisLength <= FLT_EPSILON)
+            return glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        axis /= axisLength;
 
-                entry.next = hashTable[key];
-                entry.face = iFace;
+        float minDot = 1.0f;
+        for(const glm::vec3& normal : normals)
+            minDot = std::min(minDot, glm::dot(axis, normal));
 
-                hashTable[key] = &entry;
+        //Normals spread over more than a hemisphere
+        if(minDot <= 0.0f)
+            return glm::vec4(axis, 1.0f);
 
-            }
+        return glm::vec4(axis, std::sqrt(1.0f - minDot * minDot));
+    }
+
+    // Closes a meshlet: computes its bounding sphere and normal cone, and releases its vertices from the slot table
+    void finalizeMeshlet(Meshlet& meshlet, const std::vector<Vertex>& vertices, std::vector<uint32_t>& vertexSlots)
+    {
+        std::vector<glm::vec3> positions;
+        positions.reserve(meshlet.uniqueVertexIndices.size());
+
+        for(uint32_t vertexIndex : meshlet.uniqueVertexIndices)
+        {
+            positions.push_back(vertices[vertexIndex].pos);
+            vertexSlots[vertexIndex] = undef;
         }
 
-        //Adjacency list
-        std::memset(outAdjacency, uint32_t(-1), indexCount * sizeof(uint32_t));
+        meshlet.meshletInfo.boundingSphere = minimumBoundingSphere(positions.data(), static_cast<uint32_t>(positions.size()));
+        meshlet.meshletInfo.normalCone = computeNormalCone(meshlet, vertices);
+    }
+
+    void bakeMeshlets(uint32_t maxPrimitives, uint32_t maxVertices, const uint32_t *indices, uint32_t indexCount, const std::vector<Vertex>& vertices, std::vector<Meshlet> &outMeshlets){
+        
+        const uint32_t triCount = indexCount / 3;
+
+        //Local indices are stored on 8 bits
+        assert(maxVertices <= Meshlet::MAX_VERTICES);
+
+        outMeshlets.clear();
+
+        if(triCount == 0)
+            return;
+
+        //Primitive adjacency list
+        std::vector<uint32_t> adjacency;
+        adjacency.resize(indexCount);
+
+        buildAdjacencyList(indices, indexCount, vertices, vertices.size(), adjacency.data());
+
+        outMeshlets.emplace_back();
+        auto* curr = &outMeshlets.back();
+
+        //Bitmask all the triangles to determine wether a specific one has been added
+        std::vector<bool> checklist;
+        checklist.resize(triCount);
+
+        //Last meshlet whose frontier a triangle was pushed to, avoids duplicates in the candidate heap
+        std::vector<uint32_t> frontierMark(triCount, undef);
+
+        //Local index of each vertex in the current meshlet, undef when the vertex is not part of it
+        std::vector<uint32_t> vertexSlots(vertices.size(), undef);
+
+        //Min-heap (by score) of the triangles adjacent to the current meshlet
+        std::vector<Candidate> candidates;
 
-        for(uint32_t iFace = 0; iFace < triCount; ++iFace){
+        glm::vec4 psphere = glm::vec4(0.0f);
+        glm::vec3 normalSum = glm::vec3(0.0f);
+        glm::vec4 normal = glm::vec4(0.0f);
 
-            uint32_t index = iFace * 3;
-            for (uint32_t point = 0; point < 3; ++point)
+        //Bumped each time the meshlet changes, scores computed against an older state are re-evaluated lazily
+        uint32_t version = 0;
+        uint32_t meshletIndex = 0;
+
+        auto scoreTriangle = [&](uint32_t triangle){
+            uint32_t triIndices[3] = 
             {
-                if(outAdjacency[iFace * 3 + point] != uint32_t(-1)) 
-                    continue;
-                
-                // Look for edges directed in the opposite direction
-                uint32_t i0 = uniquePositions[indices[index + ((point + 1) % 3)]];
-                uint32_t i1 = uniquePositions[indices[index + ((point) % 3)]];
-                uint32_t i2 = uniquePositions[indices[index + ((point + 2) % 3)]];
+                indices[triangle * 3],
+                indices[triangle * 3 + 1],
+                indices[triangle * 3 + 2],
+            };
 
-                //find a face sharing this edge
-                uint32_t key = i0 % hashSize;
+            assert(triIndices[0] < vertices.size());
+            assert(triIndices[1] < vertices.size());
+            assert(triIndices[2] < vertices.size());
 
-                EdgeEntry* found = nullptr;
-                EdgeEntry* foundPrev = nullptr;
+            glm::vec3 triVerts[3] = 
+            {
+                vertices[triIndices[0]].pos,
+                vertices[triIndices[1]].pos,
+                vertices[triIndices[2]].pos,
+            };
 
-                for (EdgeEntry* current = hashTable[key], *prev = nullptr; current != nullptr; prev = current, current = current->next)
-                {
-                    if(current->i1 == i1 && current->i0)
-                    {
-                        found = current;
-                        foundPrev = prev;
-                        break;
-                    }
-                }
+            return computeScore(vertexSlots, psphere, normal, triIndices, triVerts);
+        };
 
-                //Cache the face normal
-                glm::vec4 n0;
-                {
-                    glm::vec4 p0 = glm::vec4(vertices[i1].pos, 0);
-                    glm::vec4 p1 = glm::vec4(vertices[i0].pos, 0);
-                    glm::vec4 p2 = glm::vec4(vertices[i2].pos, 0);
+        auto pushCandidate = [&](uint32_t triangle, float score){
+            frontierMark[triangle] = meshletIndex;
+            candidates.push_back({score, triangle, version});
+            std::push_heap(candidates.begin(), candidates.end(), &compareCandidates);
+        };
 
-                    glm::vec4 e0 = p0 - p1;
-                    glm::vec4 e1 = p1 - p2;
+        auto startMeshlet = [&](){
+            finalizeMeshlet(*curr, vertices, vertexSlots);
 
-                    n0 = glm::vec4(glm::normalize(glm::cross(glm::vec3(e0), glm::vec3(e1))), 0);
+            psphere = glm::vec4(0.0f);
+            normalSum = glm::vec3(0.0f);
+            normal = glm::vec4(0.0f);
+            ++version;
+            ++meshletIndex;
+
+            outMeshlets.emplace_back();
+            curr = &outMeshlets.back();
+        };
+
+        //Arbitrarily start at triangle 0
+        uint32_t triIndex = 0;
+
+        //Continue adding triangles until every one of them belongs to a meshlet
+        while (true)
+        {
+            if(candidates.empty())
+            {
+                while(triIndex < triCount && checklist[triIndex])
+                    ++triIndex;
+
+                if (triIndex == triCount)
+                    break;
+
+                pushCandidate(triIndex, 0.0f);
+            }
+
+            std::pop_heap(candidates.begin(), candidates.end(), &compareCandidates);
+            Candidate candidate = candidates.back();
+            candidates.pop_back();
+
+            uint32_t index = candidate.triangle;
+
+            //Already processed triangle
+            if(checklist[index])
+                continue;
+
+            //The meshlet changed since this triangle was scored, re-score it and put it back if it is no longer the best
+            if(candidate.version != version && !curr->primitiveIndices.empty())
+            {
+                candidate.score = scoreTriangle(index);
+                candidate.version = version;
+
+                if(!candidates.empty() && compareCandidates(candidate, candidates.front()))
+                {
+                    candidates.push_back(candidate);
+                    std::push_heap(candidates.begin(), candidates.end(), &compareCandidates);
+                    continue;
                 }
+            }
 
-                //Use face normal dot product to determine best edge-sharing candidate
-                float bestDot = -2.0f;
-                
-                for(EdgeEntry* current = found, *prev = foundPrev; current != nullptr; prev == current, current = current->next)
+            uint32_t tri[3] = 
+            {
+                indices[index * 3],
+                indices[index * 3 + 1],
+                indices[index * 3 + 2],
+            };
+
+            assert(tri[0] < vertices.size());
+            assert(tri[1] < vertices.size());
+            assert(tri[2] < vertices.size());
+
+            //Try to add a triangle to meshlet
+            if (!addToMeshlet(maxPrimitives, maxVertices, *curr, vertexSlots, tri))
+            {
+                //Nothing else fits in this meshlet, the rejected triangle seeds the next one
+                if(candidates.empty())
                 {
-                    if(bestDot == -2.0f || (current->i1 == i1 && current->i0 == i0))
-                    {
-                        glm::vec4 p0 = glm::vec4(vertices[current->i0].pos, 0);
-                        glm::vec4 p1 = glm::vec4(vertices[current->i1].pos, 0);
-                        glm::vec4 p2 = glm::vec4(vertices[current->i2].pos, 0);
+                    startMeshlet();
+                    pushCandidate(index, 0.0f);
+                }
+                continue;
+            }
 
-                        glm::vec4 e0 = p0 - p1;
-                        glm::vec4 e1 = p1 - p2;
+            checklist[index] = true; //Marked
+            ++version;
 
-                        glm::vec4 n1 = glm::vec4(glm::normalize(glm::cross(glm::vec3(e0), glm::vec3(e1))), 0);
+            glm::vec3 points[3] = {
+                vertices[tri[0]].pos,
+                vertices[tri[1]].pos,
+                vertices[tri[2]].pos,
+            };
 
-                        float dot = glm::dot(n0, n1);
+            //New bounding sphere & normal axis, grown incrementally instead of recomputed over the whole meshlet
+            if(curr->primitiveIndices.size() == 1)
+            {
+                psphere = minimumBoundingSphere(points, 3);
+            }
+            else
+            {
+                for(uint32_t i = 0; i < 3u; ++i)
+                    growSphere(psphere, points[i]);
+            }
 
-                        if(dot > bestDot)
-                        {
-                            found = current;
-                            foundPrev = prev;
-                            bestDot = dot;
-                        }
+            normalSum += glm::vec3(computeNormal(points));
+            float normalLength = glm::length(normalSum);
+            if(normalLength > FLT_EPSILON)
+                normal = glm::vec4(normalSum / normalLength, 0.0f);
 
-                    }
-                }
+            // Determine wether we need to move to the next meshlet
+            if (isMeshletFull(maxVertices, maxPrimitives, *curr))
+            {
+                // Use the frontier triangle with the fewest free neighbours as the next seed, it is the most likely to be left isolated
+                uint32_t seed = undef;
+                uint32_t seedFreeCount = 4;
 
-                //Update the hash table and adjacency list
-                if (found && found->face != uint32_t(-1))
+                for(const Candidate& c : candidates)
                 {
-                    if(foundPrev != nullptr){
-                        foundPrev->next = found->next;
-                    }
-                    else 
+                    if(checklist[c.triangle])
+                        continue;
+
+                    uint32_t freeCount = 0;
+                    for(uint32_t i = 0; i < 3u; ++i)
                     {
-                        hashTable[key] = found->next;
+                        uint32_t adj = adjacency[c.triangle * 3 + i];
+                        if(adj != undef && !checklist[adj])
+                            ++freeCount;
                     }
 
-                    //Update adjacency information
-                    outAdjacency[iFace * 3 + point] = found->face;
-
-                    //Search and remove this face from the table linked list
-                    uint32_t key2 = i1 % hashSize;
-                    for (EdgeEntry* current = hashTable[key2], *prev = nullptr; current != nullptr; prev = current, current = current->next){
-                        if(current->face == iFace && current->i1 == i0 && current->i0 == i1){
-                            if(prev != nullptr){
-                                prev->next = current->next;
-                            }
-                            else 
-                            {
-                                hashTable[key2] = current->next;
-                            }
-
-                            break;
-                        }
+                    if(freeCount < seedFreeCount)
+                    {
+                        seed = c.triangle;
+                        seedFreeCount = freeCount;
                     }
+                }
 
-                    bool linked = false;
-                    for(uint32_t point2 = 0; point2 < point; ++point2){
-                        if(found->face == outAdjacency[iFace * 3 + point2]){
-                            linked = true;
-                            outAdjacency[iFace * 3 + point] = uint32_t(-1);
-                            break;
-                        }
-                    }
+                candidates.clear();
+                startMeshlet();
 
-                    if(!linked){
-                        uint32_t edge2 = 0;
-                        for(; edge2 < 3 ;++edge2)
-                        {
-                            uint32_t k = indices[found->face * 3 + edge2 ];
+                if(seed != undef)
+                    pushCandidate(seed, 0.0f);
 
-                            if(k == uint32_t(-1))
-                                continue;
+                continue;
+            }
 
-                            if(uniquePositions[k] == i0)
-                                break;
+            // Find and add all applicable adjacent triangles to candidate list
+            const uint32_t adjIndex = index * 3;
 
-                        }
-                        if (edge2 < 3)
-                        {
-                            outAdjacency[found->face * 3 + edge2] = iFace;
-                        }
-                    }
+            for (uint32_t i = 0; i < 3u; ++i){
+                uint32_t adj = adjacency[adjIndex + i];
 
+                //Invalid triangle in adjacency slot
+                if(adj == undef)
+                    continue;
 
-                }
+                //Already processed triangle
+                if(checklist[adj])
+                    continue;
 
+                //Already in the candidate list
+                if(frontierMark[adj] == meshletIndex)
+                    continue;
 
+                pushCandidate(adj, scoreTriangle(adj));
             }
+        }
 
+        if (outMeshlets.back().primitiveIndices.empty())
+        {
+            outMeshlets.pop_back();
         }
+        else
+        {
+            finalizeMeshlet(outMeshlets.back(), vertices, vertexSlots);
+        }
+    }
 
+    // Spreads the bits of a 10 bit integer so that they occupy every third bit
+    uint32_t expandBits(uint32_t v)
+    {
+        v = (v * 0x00010001u) & 0xFF0000FFu;
+        v = (v * 0x00000101u) & 0x0F00F00Fu;
+        v = (v * 0x00000011u) & 0xC30C30C3u;
+        v = (v * 0x00000005u) & 0x49249249u;
+        return v;
     }
-    bool isMeshletFull(uint32_t maxVerts, uint32_t maxPrims, const Meshlet& meshlet)
+
+    // Splits a mesh into spatially coherent chunks of at most chunkTriangles triangles by sorting triangle centroids along a Morton curve.
+    // Each chunk lists its triangles in their original order so the split only depends on the geometry.
+    void partitionTriangles(const uint32_t* indices, uint32_t indexCount, const std::vector<Vertex>& vertices, uint32_t chunkTriangles, std::vector<std::vector<uint32_t>>& outChunks)
     {
-        assert(meshlet.uniqueVertexIndices.size() <= maxVerts);
-        assert(meshlet.primitiveIndices.size() <= maxPrims);
+        const uint32_t triCount = indexCount / 3;
 
-        return meshlet.uniqueVertexIndices.size() == maxVerts || meshlet.primitiveIndices.size() == maxPrims;
+        std::vector<glm::vec3> centroids(triCount);
+        glm::vec3 minBound = glm::vec3(FLT_MAX);
+        glm::vec3 maxBound = glm::vec3(-FLT_MAX);
+
+        for(uint32_t i = 0; i < triCount; ++i)
+        {
+            centroids[i] = (vertices[indices[i * 3]].pos + vertices[indices[i * 3 + 1]].pos + vertices[indices[i * 3 + 2]].pos) / 3.0f;
+            minBound = glm::min(minBound, centroids[i]);
+            maxBound = glm::max(maxBound, centroids[i]);
+        }
+
+        glm::vec3 extent = glm::max(maxBound - minBound, glm::vec3(FLT_EPSILON));
+
+        //(Morton code, triangle) pairs are unique so the sort is deterministic
+        std::vector<std::pair<uint32_t, uint32_t>> keys(triCount);
+        for(uint32_t i = 0; i < triCount; ++i)
+        {
+            glm::vec3 n = (centroids[i] - minBound) / extent;
+            glm::uvec3 q = glm::uvec3(glm::clamp(n * 1023.0f, glm::vec3(0.0f), glm::vec3(1023.0f)));
+            keys[i] = std::make_pair((expandBits(q.x) << 2) | (expandBits(q.y) << 1) | expandBits(q.z), i);
+        }
+        std::sort(keys.begin(), keys.end());
+
+        outChunks.clear();
+        for(uint32_t first = 0; first < triCount; first += chunkTriangles)
+        {
+            uint32_t last = std::min(first + chunkTriangles, triCount);
+
+            std::vector<uint32_t> triangles;
+            triangles.reserve(last - first);
+            for(uint32_t i = first; i < last; ++i)
+                triangles.push_back(keys[i].second);
+            std::sort(triangles.begin(), triangles.end());
+
+            outChunks.push_back(std::move(triangles));
+        }
     }
 
-    void bakeMeshlets(uint32_t maxPrimitives, uint32_t maxVertices, uint32_t *indices, uint32_t indexCount, std::vector<Vertex>& vertices, std::vector<Meshlet> &outMeshlets){
-        
-        const uint32_t triCount = indexCount / 3;
+    // Bakes a subset of a mesh's triangles. The chunk is compacted to its own vertices so the per-vertex work does not scale with the full mesh.
+    void bakeChunk(uint32_t maxPrimitives, uint32_t maxVertices, const uint32_t* indices, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& triangles, std::vector<Meshlet>& outMeshlets)
+    {
+        std::vector<uint32_t> chunkVertexIndices;
+        chunkVertexIndices.reserve(triangles.size() * 3);
+        for(uint32_t triangle : triangles)
+        {
+            for(uint32_t j = 0; j < 3u; ++j)
+                chunkVertexIndices.push_back(indices[triangle * 3 + j]);
+        }
+        std::sort(chunkVertexIndices.begin(), chunkVertexIndices.end());
+        chunkVertexIndices.erase(std::unique(chunkVertexIndices.begin(), chunkVertexIndices.end()), chunkVertexIndices.end());
 
-        //Primitive adjacency list
-        std::vector<uint32_t> adjacency;
-        adjacency.resize(indexCount);
+        std::vector<Vertex> chunkVertices;
+        chunkVertices.reserve(chunkVertexIndices.size());
+        for(uint32_t vertexIndex : chunkVertexIndices)
+            chunkVertices.push_back(vertices[vertexIndex]);
 
-        buildAdjacencyList(indices, indexCount, vertices, vertices.size(), adjacency.data());
+        std::vector<uint32_t> chunkIndices;
+        chunkIndices.reserve(triangles.size() * 3);
+        for(uint32_t triangle : triangles)
+        {
+            for(uint32_t j = 0; j < 3u; ++j)
+            {
+                auto it = std::lower_bound(chunkVertexIndices.begin(), chunkVertexIndices.end(), indices[triangle * 3 + j]);
+                chunkIndices.push_back(static_cast<uint32_t>(it - chunkVertexIndices.begin()));
+            }
+        }
+
+        bakeMeshlets(maxPrimitives, maxVertices, chunkIndices.data(), static_cast<uint32_t>(chunkIndices.size()), chunkVertices, outMeshlets);
+
+        //Back to mesh vertex indices
+        for(Meshlet& meshlet : outMeshlets)
+        {
+            for(uint32_t& vertexIndex : meshlet.uniqueVertexIndices)
+                vertexIndex = chunkVertexIndices[vertexIndex];
+        }
+    }
+
+    // Runs job(0) ... job(jobCount - 1) on up to threadCount threads (0: one per hardware thread), the calling thread takes part
+    void runParallel(uint32_t jobCount, uint32_t threadCount, const std::function<void(uint32_t)>& job)
+    {
+        if(threadCount == 0)
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        threadCount = std::min(threadCount, jobCount);
+
+        std::atomic<uint32_t> nextJob = 0;
+        auto worker = [&](){
+            for(uint32_t j = nextJob++; j < jobCount; j = nextJob++)
+                job(j);
+        };
+
+        std::vector<std::jthread> threads;
+        for(uint32_t i = 1; i < threadCount; ++i)
+            threads.emplace_back(worker);
+        worker();
+    }
+
+    void bakeMeshletsParallel(uint32_t maxPrimitives, uint32_t maxVertices, const std::vector<MeshletBakeInput>& meshes, std::vector<std::vector<Meshlet>>& outMeshlets, uint32_t threadCount)
+    {
+        struct BakeJob
+        {
+            uint32_t mesh;
+            std::vector<uint32_t> triangles; //Empty when the whole mesh is baked at once
+            std::vector<Meshlet> meshlets;
+        };
+
+        //Job list only depends on the input, each job writes to its own slot and results are stitched in job order
+        std::vector<BakeJob> jobs;
+        for(uint32_t i = 0; i < meshes.size(); ++i)
+        {
+            const MeshletBakeInput& mesh = meshes[i];
+            if(mesh.indexCount < 3)
+                continue;
+
+            if(mesh.indexCount / 3 <= MESHLET_BAKE_CHUNK_TRIANGLES)
+            {
+                jobs.push_back({i, {}, {}});
+                continue;
+            }
+
+            std::vector<std::vector<uint32_t>> chunks;
+            partitionTriangles(mesh.indices, mesh.indexCount, *mesh.vertices, MESHLET_BAKE_CHUNK_TRIANGLES, chunks);
+            for(auto& chunk : chunks)
+                jobs.push_back({i, std::move(chunk), {}});
+        }
+
+        runParallel(static_cast<uint32_t>(jobs.size()), threadCount, [&](uint32_t j){
+            BakeJob& job = jobs[j];
+            const MeshletBakeInput& mesh = meshes[job.mesh];
+
+            if(job.triangles.empty())
+                bakeMeshlets(maxPrimitives, maxVertices, mesh.indices, mesh.indexCount, *mesh.vertices, job.meshlets);
+            else
+                bakeChunk(maxPrimitives, maxVertices, mesh.indices, *mesh.vertices, job.triangles, job.meshlets);
+        });
 
         outMeshlets.clear();
-        outMeshlets.emplace_back();
-        auto* curr = &outMeshlets.back();
+        outMeshlets.resize(meshes.size());
+        for(BakeJob& job : jobs)
+        {
+            auto& meshlets = outMeshlets[job.mesh];
+            if(meshlets.empty())
+                meshlets = std::move(job.meshlets);
+            else
+                meshlets.insert(meshlets.end(), std::make_move_iterator(job.meshlets.begin()), std::make_move_iterator(job.meshlets.end()));
+        }
+    }
 
-        //Bitmask all the triangles to determine wether a specific one has been added
-        std::vector<bool> checklist;
-        checklist.resize(triCount);
+    // Symmetric 4x4 matrix of the quadric error metric (sum of squared distances to planes), only the 10 unique coefficients are kept
+    struct Quadric
+    {
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+        double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+        double a22 = 0.0, a23 = 0.0;
+        double a33 = 0.0;
+        double weight = 0.0;
+    };
 
-        std::vector<glm::vec3> m_positions;
-        std::vector<glm::vec3> normals;
-        std::vector<std::pair<uint32_t, float>> candidates;
-        std::unordered_set<uint32_t> candidateCheck;
+    void addPlaneQuadric(Quadric& q, glm::dvec3 n, double d, double weight)
+    {
+        q.a00 += weight * n.x * n.x; q.a01 += weight * n.x * n.y; q.a02 += weight * n.x * n.z; q.a03 += weight * n.x * d;
+        q.a11 += weight * n.y * n.y; q.a12 += weight * n.y * n.z; q.a13 += weight * n.y * d;
+        q.a22 += weight * n.z * n.z; q.a23 += weight * n.z * d;
+        q.a33 += weight * d * d;
+        q.weight += weight;
+    }
 
-        glm::vec4 psphere, normal;
+    void addQuadric(Quadric& q, const Quadric& other)
+    {
+        q.a00 += other.a00; q.a01 += other.a01; q.a02 += other.a02; q.a03 += other.a03;
+        q.a11 += other.a11; q.a12 += other.a12; q.a13 += other.a13;
+        q.a22 += other.a22; q.a23 += other.a23;
+        q.a33 += other.a33;
+        q.weight += other.weight;
+    }
 
-        //Arbitrarily start at triangle 0
-        uint32_t triIndex = 0;
-        candidates.push_back(std::make_pair(triIndex, 0.0f));
-        candidateCheck.insert(triIndex);
+    // Mean squared distance from p to the planes accumulated in q
+    double evaluateQuadric(const Quadric& q, glm::dvec3 p)
+    {
+        double error = q.a00 * p.x * p.x + 2.0 * q.a01 * p.x * p.y + 2.0 * q.a02 * p.x * p.z + 2.0 * q.a03 * p.x
+                     + q.a11 * p.y * p.y + 2.0 * q.a12 * p.y * p.z + 2.0 * q.a13 * p.y
+                     + q.a22 * p.z * p.z + 2.0 * q.a23 * p.z
+                     + q.a33;
+        return std::max(error, 0.0) / std::max(q.weight, 1e-20);
+    }
 
-        //Continue adding triangles until
-        while (!candidates.empty())
+    // Edge collapse moving vertex "from" onto vertex "to". Lower costs are better.
+    struct Collapse
+    {
+        double cost;
+        uint32_t from;
+        uint32_t to;
+        uint32_t fromVersion;
+        uint32_t toVersion;
+    };
+
+    bool compareCollapses(const Collapse& a, const Collapse& b)
+    {
+        return a.cost > b.cost;
+    }
+
+    // Simplifies a triangle list down to targetIndexCount indices with quadric driven edge collapses onto existing vertices.
+    // Vertices on the open border of the triangle set (which includes the border shared with the rest of the mesh) are locked,
+    // so the result still matches its neighbours exactly. Returns the error of the worst collapse as a distance.
+    float simplifyLockedBorder(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, uint32_t targetIndexCount, std::vector<uint32_t>& outIndices)
+    {
+        //Compacts the triangle set to local vertices
+        std::vector<uint32_t> localToVertex(indices);
+        std::sort(localToVertex.begin(), localToVertex.end());
+        localToVertex.erase(std::unique(localToVertex.begin(), localToVertex.end()), localToVertex.end());
+        const uint32_t vertexCount = static_cast<uint32_t>(localToVertex.size());
+        const uint32_t triCount = static_cast<uint32_t>(indices.size() / 3);
+
+        std::vector<uint32_t> triangles(indices.size());
+        std::vector<glm::dvec3> positions(vertexCount);
+        for(size_t i = 0; i < indices.size(); ++i)
+            triangles[i] = static_cast<uint32_t>(std::lower_bound(localToVertex.begin(), localToVertex.end(), indices[i]) - localToVertex.begin());
+        for(uint32_t v = 0; v < vertexCount; ++v)
+            positions[v] = glm::dvec3(vertices[localToVertex[v]].pos);
+
+        //Border edges are used by a single triangle of the set, their vertices are locked
+        std::vector<std::pair<uint64_t, uint32_t>> edges;
+        edges.reserve(indices.size());
+        for(uint32_t t = 0; t < triCount; ++t)
         {
-            uint32_t index = candidates.back().first;
-            candidates.pop_back();
+            for(uint32_t j = 0; j < 3u; ++j)
+            {
+                uint32_t a = triangles[t * 3 + j], b = triangles[t * 3 + (j + 1) % 3];
+                edges.push_back({(uint64_t(std::min(a, b)) << 32) | std::max(a, b), 0});
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        std::vector<bool> locked(vertexCount, false);
+        for(size_t i = 0; i < edges.size();)
+        {
+            size_t j = i;
+            while(j < edges.size() && edges[j].first == edges[i].first)
+                ++j;
+            if(j - i == 1)
+            {
+                locked[uint32_t(edges[i].first >> 32)] = true;
+                locked[uint32_t(edges[i].first & 0xFFFFFFFF)] = true;
+            }
+            i = j;
+        }
 
-            uint32_t tri[3] = 
+        //Area weighted plane quadrics and vertex to triangle lists
+        std::vector<Quadric> quadrics(vertexCount);
+        std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+        for(uint32_t t = 0; t < triCount; ++t)
+        {
+            glm::dvec3 p0 = positions[triangles[t * 3]], p1 = positions[triangles[t * 3 + 1]], p2 = positions[triangles[t * 3 + 2]];
+            glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+            double area = glm::length(n);
+            if(area > 0.0)
             {
-                indices[index * 3],
-                indices[index * 3 + 1],
-                indices[index * 3 + 2],
-            };
+                n /= area;
+                for(uint32_t j = 0; j < 3u; ++j)
+                    addPlaneQuadric(quadrics[triangles[t * 3 + j]], n, -glm::dot(n, p0), area * 0.5);
+            }
+            for(uint32_t j = 0; j < 3u; ++j)
+                vertexTriangles[triangles[t * 3 + j]].push_back(t);
+        }
 
-            assert(tri[0] < vertices.size());
-            assert(tri[1] < vertices.size());
-            assert(tri[2] < vertices.size());
+        std::vector<bool> deadTriangles(triCount, false);
+        std::vector<uint32_t> versions(vertexCount, 0);
+        std::vector<Collapse> heap;
 
-            //Try to add a triangle to meshlet
-            if (addToMeshlet(maxPrimitives, maxVertices, *curr, tri))
+        auto pushCollapses = [&](uint32_t v){
+            for(uint32_t t : vertexTriangles[v])
             {
-                checklist[index] = true; //Marked
-            
-
-                glm::vec3 points[3] = {
-                    vertices[tri[0]].pos,
-                    vertices[tri[1]].pos,
-                    vertices[tri[2]].pos,
-                };
-
-                m_positions.push_back(points[0]);
-                m_positions.push_back(points[1]);
-                m_positions.push_back(points[2]);
-
-                glm::vec3 normal = glm::vec3(computeNormal(points));
-                normals.push_back(normal);
-
-                //New bounding sphere & normal axis
-                psphere = minimumBoundingSphere(m_positions.data(), static_cast<uint32_t>(m_positions.size()));
-
-                glm::vec4 nsphere = minimumBoundingSphere(normals.data(), static_cast<uint32_t>(normals.size()));
-                normal = glm::normalize(glm::vec3(nsphere));
-
-                // Find and add all applicable adjacent triangles to candidate list
-                const uint32_t adjIndex = index * 3;
-                
-                uint32_t adj[3] = {
-                    adjacency[adjIndex],
-                    adjacency[adjIndex + 1],
-                    adjacency[adjIndex + 2],
-                };
-
-                for (uint32_t i = 0; i < 3u; ++i){
-                    //Invalid triangle in adjacency slot
-                    if(adj[i] == -1)
+                if(deadTriangles[t])
+                    continue;
+                for(uint32_t j = 0; j < 3u; ++j)
+                {
+                    uint32_t other = triangles[t * 3 + j];
+                    if(other == v)
                         continue;
+                    Quadric q = quadrics[v];
+                    addQuadric(q, quadrics[other]);
+                    if(!locked[v])
+                        heap.push_back({evaluateQuadric(q, positions[other]), v, other, versions[v], versions[other]});
+                    if(!locked[other])
+                        heap.push_back({evaluateQuadric(q, positions[v]), other, v, versions[other], versions[v]});
+                }
+            }
+        };
 
-                    //Already processed triangke
-                    if(checklist[adj[i]])
-                        continue;
+        for(uint32_t v = 0; v < vertexCount; ++v)
+            pushCollapses(v);
+        std::make_heap(heap.begin(), heap.end(), compareCollapses);
 
-                    //Already in the candidate list
-                    if(candidateCheck.count(adj[i]))
-                        continue;
+        uint32_t liveTriangles = triCount;
+        double maxCost = 0.0;
+        while(liveTriangles * 3 > targetIndexCount && !heap.empty())
+        {
+            std::pop_heap(heap.begin(), heap.end(), compareCollapses);
+            Collapse collapse = heap.back();
+            heap.pop_back();
+
+            //Lazy removal: the quadric of one of the two vertices changed since the collapse was scored
+            if(collapse.fromVersion != versions[collapse.from] || collapse.toVersion != versions[collapse.to])
+                continue;
+
+            //Rejects the collapse if the edge is gone or if it would flip a triangle
+            bool edgeExists = false;
+            bool flips = false;
+            for(uint32_t t : vertexTriangles[collapse.from])
+            {
+                if(deadTriangles[t])
+                    continue;
+                uint32_t* tri = &triangles[t * 3];
+                if(tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+                {
+                    edgeExists = true;
+                    continue;
+                }
 
-                    candidates.push_back(std::make_pair(adj[i], FLT_MAX));
-                    candidateCheck.insert(adj[i]);
+                glm::dvec3 p[3] = {positions[tri[0]], positions[tri[1]], positions[tri[2]]};
+                glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                for(uint32_t j = 0; j < 3u; ++j)
+                {
+                    if(tri[j] == collapse.from)
+                        p[j] = positions[collapse.to];
                 }
+                glm::dvec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+                if(glm::dot(before, after) <= 0.0)
+                {
+                    flips = true;
+                    break;
+                }
+            }
+            if(!edgeExists || flips)
+                continue;
 
-                //Re-Score remaining triangles
-                for (uint32_t i = 0; i < static_cast<uint32_t>(candidates.size()); i++)
+            for(uint32_t t : vertexTriangles[collapse.from])
+            {
+                if(deadTriangles[t])
+                    continue;
+                uint32_t* tri = &triangles[t * 3];
+                if(tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
                 {
-                    uint32_t candidate = candidates[i].first;
-                    
-                    uint32_t triIndices[3] = 
-                    {
-                        indices[candidate * 3],
-                        indices[candidate * 3 + 1],
-                        indices[candidate * 3 + 2],
-                    };
+                    deadTriangles[t] = true;
+                    --liveTriangles;
+                    continue;
+                }
+                for(uint32_t j = 0; j < 3u; ++j)
+                {
+                    if(tri[j] == collapse.from)
+                        tri[j] = collapse.to;
+                }
+                vertexTriangles[collapse.to].push_back(t);
+            }
+            vertexTriangles[collapse.from].clear();
+            addQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+            versions[collapse.from]++;
+            versions[collapse.to]++;
+            maxCost = std::max(maxCost, collapse.cost);
+
+            size_t heapSize = heap.size();
+            pushCollapses(collapse.to);
+            for(size_t i = heapSize; i < heap.size(); ++i)
+                std::push_heap(heap.begin(), heap.begin() + i + 1, compareCollapses);
+        }
 
-                    assert(triIndices[0] < vertices.size());
-                    assert(triIndices[1] < vertices.size());
-                    assert(triIndices[2] < vertices.size());
+        outIndices.clear();
+        outIndices.reserve(liveTriangles * 3);
+        for(uint32_t t = 0; t < triCount; ++t)
+        {
+            const uint32_t* tri = &triangles[t * 3];
+            if(deadTriangles[t] || tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2])
+                continue;
+            for(uint32_t j = 0; j < 3u; ++j)
+                outIndices.push_back(localToVertex[tri[j]]);
+        }
 
-                    glm::vec3 triVerts[3] = 
-                    {
-                        vertices[triIndices[0]].pos,
-                        vertices[triIndices[1]].pos,
-                        vertices[triIndices[2]].pos,
-                    };
+        return static_cast<float>(std::sqrt(maxCost));
+    }
 
-                    candidates[i].second = computeScore(*curr, psphere, glm::vec4(normal, 0.0), triIndices, triVerts);
+    // Smallest sphere enclosing both spheres
+    glm::vec4 mergeSpheres(const glm::vec4& a, const glm::vec4& b)
+    {
+        glm::vec3 offset = glm::vec3(b) - glm::vec3(a);
+        float dist = glm::length(offset);
+        if(dist + b.w <= a.w)
+            return a;
+        if(dist + a.w <= b.w)
+            return b;
+
+        float radius = (dist + a.w + b.w) * 0.5f;
+        glm::vec3 center = glm::vec3(a) + offset * ((radius - a.w) / dist);
+        return glm::vec4(center, radius);
+    }
 
+    // Splits the meshlets of one hierarchy level into groups of up to MESHLET_GROUP_SIZE meshlets sharing the most vertices.
+    // Meshlets are seeded in bake order, which is spatially coherent.
+    void groupMeshlets(const std::vector<Meshlet>& meshlets, const std::vector<uint32_t>& level, uint32_t vertexCount, std::vector<std::vector<uint32_t>>& outGroups)
+    {
+        //Vertex to level meshlets, in compressed rows
+        std::vector<uint32_t> vertexOffsets(vertexCount + 1, 0);
+        for(uint32_t m : level)
+        {
+            for(uint32_t v : meshlets[m].uniqueVertexIndices)
+                vertexOffsets[v + 1]++;
+        }
+        for(uint32_t v = 0; v < vertexCount; ++v)
+            vertexOffsets[v + 1] += vertexOffsets[v];
+
+        std::vector<uint32_t> vertexMeshlets(vertexOffsets.back());
+        std::vector<uint32_t> fill(vertexOffsets.begin(), vertexOffsets.end() - 1);
+        for(uint32_t i = 0; i < level.size(); ++i)
+        {
+            for(uint32_t v : meshlets[level[i]].uniqueVertexIndices)
+                vertexMeshlets[fill[v]++] = i;
+        }
+
+        std::vector<bool> grouped(level.size(), false);
+        std::vector<uint32_t> sharedVertices(level.size(), 0);
+        std::vector<uint32_t> candidates;
+
+        outGroups.clear();
+        for(uint32_t seed = 0; seed < level.size(); ++seed)
+        {
+            if(grouped[seed])
+                continue;
+
+            std::vector<uint32_t> group;
+            uint32_t next = seed;
+            while(next != undef)
+            {
+                grouped[next] = true;
+                group.push_back(level[next]);
+                if(group.size() == MESHLET_GROUP_SIZE)
+                    break;
+
+                for(uint32_t v : meshlets[level[next]].uniqueVertexIndices)
+                {
+                    for(uint32_t k = vertexOffsets[v]; k < vertexOffsets[v + 1]; ++k)
+                    {
+                        uint32_t neighbour = vertexMeshlets[k];
+                        if(grouped[neighbour])
+                            continue;
+                        if(sharedVertices[neighbour]++ == 0)
+                            candidates.push_back(neighbour);
+                    }
                 }
 
-                // Determine wether we need to move to the next meshlet
-                if (isMeshletFull(maxVertices, maxPrimitives, *curr))
+                next = undef;
+                uint32_t bestShared = 0;
+                for(uint32_t candidate : candidates)
                 {
-                    outMeshlets.back().meshletInfo.boundingSphere = minimumBoundingSphere(m_positions.data(), m_positions.size());
-                    m_positions.clear();
-                    normals.clear();
-                    candidateCheck.clear();
+                    if(!grouped[candidate] && sharedVertices[candidate] > bestShared)
+                    {
+                        bestShared = sharedVertices[candidate];
+                        next = candidate;
+                    }
+                }
+            }
+
+            for(uint32_t candidate : candidates)
+                sharedVertices[candidate] = 0;
+            candidates.clear();
+            outGroups.push_back(std::move(group));
+        }
+    }
 
-                    // Use one of our existing candidates as the next meshlet seed.
-                    if(!candidates.empty())
+    void buildMeshletHierarchy(uint32_t maxPrimitives, uint32_t maxVertices, const std::vector<Vertex>& vertices, std::vector<Meshlet>& meshlets)
+    {
+        //Full resolution meshlets have no error and are measured from their own bounds
+        std::vector<uint32_t> level;
+        for(uint32_t i = 0; i < meshlets.size(); ++i)
+        {
+            MeshletIndexingInfo& info = meshlets[i].meshletInfo;
+            info.lodError = 0.0f;
+            info.lodBounds = info.boundingSphere;
+            info.parentLodError = -1.0f;
+            info.parentLodBounds = info.boundingSphere;
+            level.push_back(i);
+        }
+
+        for(uint32_t depth = 0; depth < MESHLET_MAX_LOD_LEVELS && level.size() > 1; ++depth)
+        {
+            std::vector<std::vector<uint32_t>> groups;
+            groupMeshlets(meshlets, level, static_cast<uint32_t>(vertices.size()), groups);
+
+            std::vector<uint32_t> nextLevel;
+            for(const std::vector<uint32_t>& group : groups)
+            {
+                std::vector<uint32_t> groupIndices;
+                float groupError = 0.0f;
+                glm::vec4 groupBounds = meshlets[group[0]].meshletInfo.lodBounds;
+                for(uint32_t m : group)
+                {
+                    const Meshlet& meshlet = meshlets[m];
+                    for(const Meshlet::Triangle& tri : meshlet.primitiveIndices)
                     {
-                        candidates[0] = candidates.back();
-                        candidates.resize(1);
-                        candidateCheck.insert(candidates[0].first);
+                        groupIndices.push_back(meshlet.uniqueVertexIndices[tri.i0]);
+                        groupIndices.push_back(meshlet.uniqueVertexIndices[tri.i1]);
+                        groupIndices.push_back(meshlet.uniqueVertexIndices[tri.i2]);
                     }
+                    groupError = std::max(groupError, meshlet.meshletInfo.lodError);
+                    groupBounds = mergeSpheres(groupBounds, meshlet.meshletInfo.lodBounds);
+                }
 
-                    outMeshlets.emplace_back();
-                    curr = &outMeshlets.back();
+                std::vector<uint32_t> simplifiedIndices;
+                float simplificationError = simplifyLockedBorder(groupIndices, vertices, static_cast<uint32_t>(groupIndices.size() / 6 * 3), simplifiedIndices);
+
+                //Locked borders left too little to remove, the group's meshlets stay roots of the hierarchy
+                if(simplifiedIndices.empty() || simplifiedIndices.size() > groupIndices.size() * MESHLET_LOD_MIN_REDUCTION)
+                    continue;
+
+                //Errors grow monotonically towards the roots so that a view never selects both a meshlet and its parent
+                groupError += simplificationError;
+                for(uint32_t m : group)
+                {
+                    meshlets[m].meshletInfo.parentLodError = groupError;
+                    meshlets[m].meshletInfo.parentLodBounds = groupBounds;
                 }
-                else 
+
+                std::vector<uint32_t> simplifiedTriangles(simplifiedIndices.size() / 3);
+                for(uint32_t t = 0; t < simplifiedTriangles.size(); ++t)
+                    simplifiedTriangles[t] = t;
+
+                std::vector<Meshlet> parents;
+                bakeChunk(maxPrimitives, maxVertices, simplifiedIndices.data(), vertices, simplifiedTriangles, parents);
+                for(Meshlet& parent : parents)
                 {
-                    std::sort(candidates.begin(), candidates.end(), &compareScores);
+                    parent.meshletInfo.lodError = groupError;
+                    parent.meshletInfo.lodBounds = groupBounds;
+                    parent.meshletInfo.parentLodError = -1.0f;
+                    parent.meshletInfo.parentLodBounds = groupBounds;
+                    nextLevel.push_back(static_cast<uint32_t>(meshlets.size()));
+                    meshlets.push_back(std::move(parent));
                 }
+            }
+
+            level = std::move(nextLevel);
+        }
+    }
+
+    void buildMeshletHierarchies(uint32_t maxPrimitives, uint32_t maxVertices, const std::vector<MeshletBakeInput>& meshes, std::vector<std::vector<Meshlet>>& meshlets, uint32_t threadCount)
+    {
+        runParallel(static_cast<uint32_t>(meshes.size()), threadCount, [&](uint32_t i){
+            if(!meshlets[i].empty())
+                buildMeshletHierarchy(maxPrimitives, maxVertices, *meshes[i].vertices, meshlets[i]);
+        });
+    }
+
+    //Bakes the meshlets and their LOD hierarchy of every mesh, the vertices are copied into the output meshes
+    BakeStatistics bakeMeshes(uint32_t maxPrimitives, uint32_t maxVertices, const std::vector<MeshletBakeInput>& meshes, std::vector<Mesh>& outMeshes, uint32_t threadCount)
+    {
+        auto bakeStart = std::chrono::high_resolution_clock::now();
+        BakeStatistics statistics{};
 
+        std::vector<std::vector<Meshlet>> bakedMeshlets;
+        bakeMeshletsParallel(maxPrimitives, maxVertices, meshes, bakedMeshlets, threadCount);
+        for(const auto& meshlets : bakedMeshlets)
+            statistics.meshletCount += meshlets.size();
+
+        buildMeshletHierarchies(maxPrimitives, maxVertices, meshes, bakedMeshlets, threadCount);
+        for(const auto& meshlets : bakedMeshlets)
+            statistics.lodMeshletCount += meshlets.size();
+
+        outMeshes.clear();
+        outMeshes.resize(meshes.size());
+        for(uint32_t i = 0; i < meshes.size(); ++i)
+        {
+            statistics.triangleCount += meshes[i].indexCount / 3;
+            if(meshes[i].indexCount > 0)
+            {
+                outMeshes[i].meshlets = std::move(bakedMeshlets[i]);
+                outMeshes[i].vertices = *meshes[i].vertices;
             }
-            else 
+        }
+
+        statistics.seconds = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - bakeStart).count();
+        return statistics;
+    }
+
+    // Hashes a byte range 8 bytes at a time, used to detect changed bake inputs (not cryptographic)
+    uint64_t hashBytes(const void* data, size_t size, uint64_t seed)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        uint64_t h = seed ^ (size * 0xC2B2AE3D27D4EB4Full);
+
+        auto mix = [&h](uint64_t word){
+            h ^= word * 0xC2B2AE3D27D4EB4Full;
+            h = (h << 31) | (h >> 33);
+            h *= 0x9E3779B97F4A7C15ull;
+        };
+
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+        {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, sizeof(uint64_t));
+            mix(word);
+        }
+        if (i < size)
+        {
+            uint64_t tail = 0;
+            std::memcpy(&tail, bytes + i, size - i);
+            mix(tail);
+        }
+
+        h ^= h >> 29;
+        h *= 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 32;
+        return h;
+    }
+
+    // Identifies the geometry a mesh is baked from
+    uint64_t hashMeshInput(const MeshletBakeInput& mesh)
+    {
+        uint64_t h = hashBytes(mesh.indices, mesh.indexCount * sizeof(uint32_t));
+        return hashBytes(mesh.vertices->data(), mesh.vertices->size() * sizeof(Vertex), h);
+    }
+
+    // Hashes the raw bytes of a vertex, the padding members are zero initialized
+    uint64_t hashVertex(const Vertex& vertex)
+    {
+        static_assert(sizeof(Vertex) % sizeof(uint32_t) == 0);
+
+        uint32_t words[sizeof(Vertex) / sizeof(uint32_t)];
+        std::memcpy(words, &vertex, sizeof(Vertex));
+
+        uint64_t h = 0;
+        for (uint32_t word : words)
+        {
+            h ^= word;
+            h *= 0x9E3779B97F4A7C15ull;
+            h ^= h >> 32;
+        }
+        return h;
+    }
+
+    // Merges bitwise identical vertices with an open addressing hash table and rewrites the indices,
+    // the first occurrence of each vertex keeps its relative order
+    void weldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        const size_t mask = openAddressingTableSize(vertices.size()) - 1;
+        std::vector<uint32_t> table(mask + 1, undef);
+        std::vector<uint32_t> remap(vertices.size());
+        uint32_t uniqueCount = 0;
+
+        for (uint32_t i = 0; i < vertices.size(); ++i)
+        {
+            for (size_t slot = hashVertex(vertices[i]) & mask;; slot = (slot + 1) & mask)
             {
-                if(candidates.empty())
+                uint32_t candidate = table[slot];
+                if (candidate == undef)
                 {
-                    outMeshlets.back().meshletInfo.boundingSphere = minimumBoundingSphere(m_positions.data(), m_positions.size());
-                    m_positions.clear();
-                    normals.clear();
-                    candidateCheck.clear();
-
-                    outMeshlets.emplace_back();
-                    curr = &outMeshlets.back();
+                    //New vertex, compacted in place (uniqueCount <= i)
+                    table[slot] = uniqueCount;
+                    vertices[uniqueCount] = vertices[i];
+                    remap[i] = uniqueCount++;
+                    break;
+                }
+                if (std::memcmp(&vertices[candidate], &vertices[i], sizeof(Vertex)) == 0)
+                {
+                    remap[i] = candidate;
+                    break;
                 }
             }
+        }
 
-            if(candidates.empty())
-            {
-                while(triIndex < triCount && checklist[triIndex])
-                    ++triIndex;
+        vertices.resize(uniqueCount);
+        for (uint32_t& index : indices)
+            index = remap[index];
+    }
 
-                if (triIndex == triCount)
-                    break;
+    // Bounds used to quantize the mesh vertices. Positions use a uniform grid so that the quantization error is isotropic.
+    MeshInfo computeQuantizationBounds(const std::vector<Vertex>& vertices)
+    {
+        MeshInfo meshInfo{};
+        if(vertices.empty())
+            return meshInfo;
 
-                candidates.push_back(std::make_pair(triIndex, 0.0f));
-                candidateCheck.insert(triIndex);
-                
-            }
+        glm::vec3 minPos = vertices[0].pos, maxPos = vertices[0].pos;
+        glm::vec2 minUV = vertices[0].texCoord, maxUV = vertices[0].texCoord;
+
+        for(const Vertex& vertex : vertices)
+        {
+            minPos = glm::min(minPos, vertex.pos);
+            maxPos = glm::max(maxPos, vertex.pos);
+            minUV = glm::min(minUV, vertex.texCoord);
+            maxUV = glm::max(maxUV, vertex.texCoord);
         }
-        if (outMeshlets.back().primitiveIndices.empty())
+
+        glm::vec3 extent = maxPos - minPos;
+        meshInfo.positionBounds = glm::vec4(minPos, std::max(std::max(extent.x, extent.y), std::max(extent.z, FLT_EPSILON)));
+        meshInfo.texCoordBounds = glm::vec4(minUV, glm::max(maxUV - minUV, glm::vec2(FLT_EPSILON)));
+
+        return meshInfo;
+    }
+
+    uint16_t quantizeUnorm16(float v)
+    {
+        return static_cast<uint16_t>(std::round(glm::clamp(v, 0.0f, 1.0f) * 65535.0f));
+    }
+
+    // Octahedral mapping of a unit vector to [-1, 1]^2
+    glm::vec2 octEncode(glm::vec3 n)
+    {
+        float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        if(l1 <= FLT_EPSILON)
+            return glm::vec2(0.0f);
+
+        n /= l1;
+        glm::vec2 e = glm::vec2(n.x, n.y);
+        if(n.z < 0.0f)
         {
-            outMeshlets.pop_back();
+            glm::vec2 s = glm::vec2(e.x >= 0.0f ? 1.0f : -1.0f, e.y >= 0.0f ? 1.0f : -1.0f);
+            e = (1.0f - glm::abs(glm::vec2(e.y, e.x))) * s;
         }
+        return e;
+    }
+
+    glm::vec3 octDecode(glm::vec2 e)
+    {
+        glm::vec3 n = glm::vec3(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+        float t = std::max(-n.z, 0.0f);
+        n.x += n.x >= 0.0f ? -t : t;
+        n.y += n.y >= 0.0f ? -t : t;
+        return glm::normalize(n);
+    }
+
+    QuantizedVertex quantizeVertex(const Vertex& vertex, const MeshInfo& meshInfo)
+    {
+        QuantizedVertex quantized{};
+
+        glm::vec3 pos = (vertex.pos - glm::vec3(meshInfo.positionBounds)) / meshInfo.positionBounds.w;
+        glm::vec2 uv = (vertex.texCoord - glm::vec2(meshInfo.texCoordBounds)) / glm::vec2(meshInfo.texCoordBounds.z, meshInfo.texCoordBounds.w);
+        for(uint32_t i = 0; i < 3; ++i)
+            quantized.pos[i] = quantizeUnorm16(pos[i]);
+        for(uint32_t i = 0; i < 2; ++i)
+            quantized.texCoord[i] = quantizeUnorm16(uv[i]);
+
+        //Same convention as GLSL packSnorm2x16
+        glm::vec2 normal = octEncode(vertex.normal);
+        quantized.normal = uint32_t(uint16_t(int16_t(std::round(glm::clamp(normal.x, -1.0f, 1.0f) * 32767.0f))))
+            | (uint32_t(uint16_t(int16_t(std::round(glm::clamp(normal.y, -1.0f, 1.0f) * 32767.0f)))) << 16);
+
+        glm::vec2 tangent = octEncode(glm::vec3(vertex.tangent)) * 0.5f + 0.5f;
+        quantized.tangent = uint32_t(std::round(glm::clamp(tangent.x, 0.0f, 1.0f) * 32767.0f))
+            | (uint32_t(std::round(glm::clamp(tangent.y, 0.0f, 1.0f) * 32767.0f)) << 15)
+            | (vertex.tangent.w < 0.0f ? 1u << 31 : 0u);
+
+        return quantized;
+    }
+
+    // CPU mirror of the mesh shader decoder
+    Vertex dequantizeVertex(const QuantizedVertex& quantized, const MeshInfo& meshInfo)
+    {
+        Vertex vertex{};
+
+        glm::vec3 pos = glm::vec3(quantized.pos[0], quantized.pos[1], quantized.pos[2]) / 65535.0f;
+        vertex.pos = glm::vec3(meshInfo.positionBounds) + pos * meshInfo.positionBounds.w;
+
+        glm::vec2 uv = glm::vec2(quantized.texCoord[0], quantized.texCoord[1]) / 65535.0f;
+        vertex.texCoord = glm::vec2(meshInfo.texCoordBounds) + uv * glm::vec2(meshInfo.texCoordBounds.z, meshInfo.texCoordBounds.w);
+
+        glm::vec2 normal = glm::vec2(int16_t(quantized.normal & 0xFFFF), int16_t(quantized.normal >> 16)) / 32767.0f;
+        vertex.normal = octDecode(glm::clamp(normal, -1.0f, 1.0f));
+
+        glm::vec2 tangent = glm::vec2(quantized.tangent & 0x7FFF, (quantized.tangent >> 15) & 0x7FFF) / 32767.0f * 2.0f - 1.0f;
+        vertex.tangent = glm::vec4(octDecode(tangent), (quantized.tangent >> 31) ? -1.0f : 1.0f);
+
+        return vertex;
+    }
+
+    float angleDegrees(glm::vec3 a, glm::vec3 b)
+    {
+        if(glm::length(a) <= FLT_EPSILON || glm::length(b) <= FLT_EPSILON)
+            return 0.0f;
+        return glm::degrees(std::acos(glm::clamp(glm::dot(glm::normalize(a), glm::normalize(b)), -1.0f, 1.0f)));
+    }
+
+    QuantizationError measureQuantizationError(const std::vector<Vertex>& vertices, const std::vector<QuantizedVertex>& quantizedVertices, const MeshInfo& meshInfo)
+    {
+        assert(vertices.size() == quantizedVertices.size());
+
+        QuantizationError error{};
+        for(size_t i = 0; i < vertices.size(); ++i)
+        {
+            const Vertex& reference = vertices[i];
+            Vertex decoded = dequantizeVertex(quantizedVertices[i], meshInfo);
+
+            error.position = std::max(error.position, glm::length(decoded.pos - reference.pos) / meshInfo.positionBounds.w);
+            glm::vec2 uvError = glm::abs(decoded.texCoord - reference.texCoord);
+            error.texCoord = std::max(error.texCoord, std::max(uvError.x, uvError.y));
+            error.normal = std::max(error.normal, angleDegrees(decoded.normal, reference.normal));
+            error.tangent = std::max(error.tangent, angleDegrees(glm::vec3(decoded.tangent), glm::vec3(reference.tangent)));
+            if((decoded.tangent.w < 0.0f) != (reference.tangent.w < 0.0f))
+                error.handednessMismatches++;
+        }
+        return error;
+    }
+
+    bool isWithinQuantizationTolerance(const QuantizationError& error)
+    {
+        return error.position <= QUANTIZATION_POSITION_TOLERANCE
+            && error.texCoord <= QUANTIZATION_TEXCOORD_TOLERANCE
+            && error.normal <= QUANTIZATION_ANGLE_TOLERANCE
+            && error.tangent <= QUANTIZATION_ANGLE_TOLERANCE
+            && error.handednessMismatches == 0;
     }
 }
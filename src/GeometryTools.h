@@ -1,7 +1,77 @@
 #pragma once
 #include "Defs.h"
+#include <functional>
 
 namespace GeometryTools{
-    void bakeMeshlets(uint32_t maxPrimitives, uint32_t maxVertices, uint32_t* indices, uint32_t indexCount, std::vector<Vertex>& vertices, std::vector<Meshlet>& outMeshlets);
+    //Geometry of a mesh to bake, the data is only read and must outlive the bake
+    struct MeshletBakeInput{
+        const uint32_t* indices = nullptr;
+        uint32_t indexCount = 0;
+        const std::vector<Vertex>* vertices = nullptr;
+    };
+
+    //Largest deviation of the quantized vertices from the float ones
+    struct QuantizationError{
+        float position = 0.0f; //Relative to the largest bounds extent
+        float texCoord = 0.0f;
+        float normal = 0.0f; //Degrees
+        float tangent = 0.0f; //Degrees
+        uint32_t handednessMismatches = 0;
+    };
+
+    //Deviations above these are visible (a few pixels / half a texel of a 4K texture)
+    constexpr float QUANTIZATION_POSITION_TOLERANCE = 1e-4f;
+    constexpr float QUANTIZATION_TEXCOORD_TOLERANCE = 1.0f / 8192.0f;
+    constexpr float QUANTIZATION_ANGLE_TOLERANCE = 0.1f;
+
+    //Statistics of a bakeMeshes call
+    struct BakeStatistics{
+        size_t triangleCount = 0;
+        size_t meshletCount = 0; //Finest level only
+        size_t lodMeshletCount = 0; //All the hierarchy levels
+        size_t reusedMeshCount = 0; //Meshes taken from the previous bake because their inputs did not change
+        float seconds = 0.0f;
+    };
+
+    //Meshlet limits shared by the runtime and the offline baker, the mesh shaders are written for these
+    constexpr uint32_t MESHLET_MAX_PRIMITIVES = 128;
+    constexpr uint32_t MESHLET_MAX_VERTICES = 128;
+
+    //Meshes above this triangle count are split into spatial chunks baked independently
+    constexpr uint32_t MESHLET_BAKE_CHUNK_TRIANGLES = 1 << 16;
+
+    //Cluster hierarchy: meshlets are grouped by MESHLET_GROUP_SIZE, each group is simplified to half its triangles and baked again
+    constexpr uint32_t MESHLET_GROUP_SIZE = 4;
+    constexpr uint32_t MESHLET_MAX_LOD_LEVELS = 16;
+    constexpr float MESHLET_LOD_MIN_REDUCTION = 0.85f; //Groups simplified above this triangle ratio are not worth another level
+
+    //Everything the baked meshlets depend on besides the geometry, stored in the baked files to detect stale bakes
+    struct BakeParameters{
+        uint32_t maxPrimitives = MESHLET_MAX_PRIMITIVES;
+        uint32_t maxVertices = MESHLET_MAX_VERTICES;
+        uint32_t chunkTriangles = MESHLET_BAKE_CHUNK_TRIANGLES;
+        uint32_t lodGroupSize = MESHLET_GROUP_SIZE;
+        uint32_t lodMaxLevels = MESHLET_MAX_LOD_LEVELS;
+        float lodMinReduction = MESHLET_LOD_MIN_REDUCTION;
+
+        bool operator==(const BakeParameters&) const = default;
+    };
+
+    void buildAdjacencyList(const uint32_t* indices, uint32_t indexCount, const std::vector<Vertex>& vertices, uint32_t vertexCount, uint32_t* outAdjacency);
+    void bakeMeshlets(uint32_t maxPrimitives, uint32_t maxVertices, const uint32_t* indices, uint32_t indexCount, const std::vector<Vertex>& vertices, std::vector<Meshlet>& outMeshlets);
+    void bakeMeshletsParallel(uint32_t maxPrimitives, uint32_t maxVertices, const std::vector<MeshletBakeInput>& meshes, std::vector<std::vector<Meshlet>>& outMeshlets, uint32_t threadCount = 0);
+    BakeStatistics bakeMeshes(uint32_t maxPrimitives, uint32_t maxVertices, const std::vector<MeshletBakeInput>& meshes, std::vector<Mesh>& outMeshes, uint32_t threadCount = 0);
+    [[nodiscard]]uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+    [[nodiscard]]uint64_t hashMeshInput(const MeshletBakeInput& mesh);
+    void runParallel(uint32_t jobCount, uint32_t threadCount, const std::function<void(uint32_t)>& job);
+    void buildMeshletHierarchy(uint32_t maxPrimitives, uint32_t maxVertices, const std::vector<Vertex>& vertices, std::vector<Meshlet>& meshlets);
+    void buildMeshletHierarchies(uint32_t maxPrimitives, uint32_t maxVertices, const std::vector<MeshletBakeInput>& meshes, std::vector<std::vector<Meshlet>>& meshlets, uint32_t threadCount = 0);
+    float simplifyLockedBorder(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, uint32_t targetIndexCount, std::vector<uint32_t>& outIndices);
+    MeshInfo computeQuantizationBounds(const std::vector<Vertex>& vertices);
+    QuantizedVertex quantizeVertex(const Vertex& vertex, const MeshInfo& meshInfo);
+    Vertex dequantizeVertex(const QuantizedVertex& vertex, const MeshInfo& meshInfo);
+    QuantizationError measureQuantizationError(const std::vector<Vertex>& vertices, const std::vector<QuantizedVertex>& quantizedVertices, const MeshInfo& meshInfo);
+    [[nodiscard]]bool isWithinQuantizationTolerance(const QuantizationError& error);
+    void weldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
     glm::vec4 minimumBoundingSphere(glm::vec3* points, uint32_t count);
-}
\ No newline at end of file
+}
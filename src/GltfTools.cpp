@@ -0,0 +1,902 @@
+#define TINYGLTF_IMPLEMENTATION
+#include "GltfTools.h"
+#include "GeometryTools.h"
+#include <thread>
+#include <numeric>
+#include <chrono>
+#include <glm/gtc/quaternion.hpp>
+
+namespace GltfTools {
+
+    //Image decoding is skipped entirely when only the geometry is needed
+    static bool skipImage(tinygltf::Image*, const int, std::string*, std::string*, int, int, const unsigned char*, int, void*)
+    {
+        return true;
+    }
+
+    //GLB chunk types
+    constexpr uint32_t GLB_MAGIC = 0x46546C67; //"glTF"
+    constexpr uint32_t GLB_JSON_CHUNK = 0x4E4F534A; //"JSON"
+    constexpr uint32_t GLB_BIN_CHUNK = 0x004E4942; //"BIN\0"
+
+    //Parses the GLB container of a mapped file, the chunks are only located
+    static void locateGlbChunks(const SerializationTools::MappedFile& file, std::string_view& outJson, std::span<const unsigned char>& outBinary, uint64_t& outBinaryOffset)
+    {
+        uint32_t header[3] = {}; //magic, version, length
+        if (file.size() < sizeof(header) + 2 * sizeof(uint32_t))
+            throw std::runtime_error("Invalid GLB header");
+        std::memcpy(header, file.data(), sizeof(header));
+        if (header[0] != GLB_MAGIC || header[1] != 2 || header[2] > file.size())
+            throw std::runtime_error("Invalid GLB header");
+
+        uint64_t offset = sizeof(header);
+        while (offset + 2 * sizeof(uint32_t) <= header[2])
+        {
+            uint32_t chunk[2] = {}; //length, type
+            std::memcpy(chunk, file.data() + offset, sizeof(chunk));
+            offset += sizeof(chunk);
+            if (offset + chunk[0] > header[2])
+                throw std::runtime_error("GLB chunk out of the file range");
+
+            const unsigned char* data = reinterpret_cast<const unsigned char*>(file.data() + offset);
+            if (chunk[1] == GLB_JSON_CHUNK && outJson.empty())
+                outJson = std::string_view(reinterpret_cast<const char*>(data), chunk[0]);
+            else if (chunk[1] == GLB_BIN_CHUNK && outBinary.empty())
+            {
+                outBinary = std::span<const unsigned char>(data, chunk[0]);
+                outBinaryOffset = offset;
+            }
+            offset += (chunk[0] + 3) & ~3u;
+        }
+        if (outJson.empty())
+            throw std::runtime_error("GLB without JSON chunk");
+    }
+
+    //The BIN chunk buffer gets a one byte placeholder so that tinygltf doesn't copy the chunk, images stored in the chunk point to a placeholder view until tinygltf is done
+    static std::string stripGlbBinaryBuffer(std::string_view json, int& outBinaryBuffer, size_t& outBinaryLength, std::vector<std::pair<size_t, int>>& outImageViews)
+    {
+        nlohmann::json document = nlohmann::json::parse(json.begin(), json.end());
+        outBinaryBuffer = -1;
+        if (!document.contains("buffers"))
+            return std::string(json);
+
+        auto& buffers = document["buffers"];
+        for (size_t i = 0; i < buffers.size(); i++)
+        {
+            if (!buffers[i].contains("uri"))
+            {
+                outBinaryBuffer = static_cast<int>(i);
+                outBinaryLength = buffers[i].value("byteLength", size_t(0));
+                buffers[i]["uri"] = "data:application/octet-stream;base64,AA==";
+                buffers[i]["byteLength"] = 1;
+                break;
+            }
+        }
+        if (outBinaryBuffer < 0 || !document.contains("images") || !document.contains("bufferViews"))
+            return document.dump();
+
+        auto& bufferViews = document["bufferViews"];
+        const size_t placeholderView = bufferViews.size();
+        for (size_t i = 0; i < document["images"].size(); i++)
+        {
+            auto& image = document["images"][i];
+            if (!image.contains("bufferView"))
+                continue;
+            int view = image["bufferView"].get<int>();
+            if (view >= 0 && static_cast<size_t>(view) < placeholderView && bufferViews[view].value("buffer", -1) == outBinaryBuffer)
+            {
+                outImageViews.emplace_back(i, view);
+                image["bufferView"] = placeholderView;
+            }
+        }
+        if (!outImageViews.empty())
+            bufferViews.push_back({ { "buffer", outBinaryBuffer }, { "byteLength", 1 } });
+        return document.dump();
+    }
+
+    //Picks the right tinygltf function depending on the file format and manages errors
+    //GLB files are mapped and only their JSON chunk goes through tinygltf when images are not needed, accessors then read the BIN chunk from the mapping
+    void loadGltfData(const std::filesystem::path& path, GltfAsset& outAsset, bool loadImages)
+    {
+        bool ret = false;
+        tinygltf::TinyGLTF loader;
+        std::string err;
+        std::string warn;
+        tinygltf::Model& gltfModel = outAsset.model;
+        std::span<const unsigned char> binaryChunk;
+        int binaryBuffer = -1;
+        size_t binaryLength = 0;
+
+        if (!loadImages)
+        {
+            loader.SetImageLoader(skipImage, nullptr);
+        }
+
+        if (path.extension() == ".gltf")
+        {
+            ret = loader.LoadASCIIFromFile(&gltfModel, &err, &warn, path.string());
+        }
+        else if (path.extension() == ".glb")
+        {
+            outAsset.file = std::make_unique<SerializationTools::MappedFile>(path);
+            std::string_view json;
+            locateGlbChunks(*outAsset.file, json, binaryChunk, outAsset.binaryChunkOffset);
+            if (loadImages)
+            {
+                //Decoded images need the whole BIN chunk, tinygltf still reads it from the mapping
+                ret = loader.LoadBinaryFromMemory(&gltfModel, &err, &warn, reinterpret_cast<const unsigned char*>(outAsset.file->data()), static_cast<unsigned int>(outAsset.file->size()), path.parent_path().string());
+                binaryChunk = {};
+            }
+            else
+            {
+                std::vector<std::pair<size_t, int>> imageViews;
+                std::string strippedJson = stripGlbBinaryBuffer(json, binaryBuffer, binaryLength, imageViews);
+                ret = loader.LoadASCIIFromString(&gltfModel, &err, &warn, strippedJson.data(), static_cast<unsigned int>(strippedJson.size()), path.parent_path().string());
+                if (ret)
+                {
+                    for (auto [image, view] : imageViews)
+                        gltfModel.images[image].bufferView = view;
+                    if (!imageViews.empty())
+                        gltfModel.bufferViews.pop_back();
+                    gltfModel.buffers[binaryBuffer].uri.clear();
+                    gltfModel.buffers[binaryBuffer].data.clear();
+                }
+            }
+        }
+        else {
+            throw std::runtime_error("Model format not supported");
+        }
+
+        if (!err.empty()) {
+            throw std::runtime_error(err);
+        }
+
+        if (!ret) {
+            throw std::runtime_error("Failed to parse glTf\n");
+        }
+
+        outAsset.buffers.resize(gltfModel.buffers.size());
+        for (size_t i = 0; i < gltfModel.buffers.size(); i++)
+        {
+            outAsset.buffers[i] = gltfModel.buffers[i].data;
+        }
+        if (binaryBuffer >= 0)
+        {
+            outAsset.buffers[binaryBuffer] = binaryChunk.first(std::min(binaryChunk.size(), binaryLength));
+        }
+    }
+
+    //Files the geometry is read from: the glTF itself and its external buffers
+    std::vector<std::filesystem::path> listSourceFiles(const std::filesystem::path& path, const GltfAsset& asset)
+    {
+        std::vector<std::filesystem::path> sourceFiles = { path };
+        for (const auto& buffer : asset.model.buffers)
+        {
+            if (buffer.uri.empty() || tinygltf::IsDataURI(buffer.uri))
+                continue;
+
+            std::string decodedUri;
+            tinygltf::URIDecode(buffer.uri, &decodedUri, nullptr);
+            sourceFiles.push_back(path.parent_path() / decodedUri);
+        }
+        return sourceFiles;
+    }
+
+    //Locates the encoded image of a texture without decoding it: external image files or glTF buffer ranges for embedded images
+    static void importTexture(const std::filesystem::path& path, const GltfAsset& asset, int textureIndex, SerializationTools::BakedTexture& outTexture)
+    {
+        if (textureIndex < 0 || static_cast<size_t>(textureIndex) >= asset.model.textures.size())
+            return;
+
+        int imageIndex = asset.model.textures[textureIndex].source;
+        if (imageIndex < 0 || static_cast<size_t>(imageIndex) >= asset.model.images.size())
+            return;
+
+        const tinygltf::Image& image = asset.model.images[imageIndex];
+        if (!image.uri.empty() && !tinygltf::IsDataURI(image.uri))
+        {
+            std::string decodedUri;
+            tinygltf::URIDecode(image.uri, &decodedUri, nullptr);
+            SerializationTools::setBakedPath(outTexture.path, decodedUri);
+        }
+        else if (image.bufferView >= 0 && static_cast<size_t>(image.bufferView) < asset.model.bufferViews.size())
+        {
+            const tinygltf::BufferView& bufferView = asset.model.bufferViews[image.bufferView];
+            const tinygltf::Buffer& buffer = asset.model.buffers[bufferView.buffer];
+            outTexture.offset = bufferView.byteOffset;
+            outTexture.size = bufferView.byteLength;
+            if (buffer.uri.empty() && path.extension() == ".glb")
+            {
+                SerializationTools::setBakedPath(outTexture.path, path.filename().generic_string());
+                outTexture.offset += asset.binaryChunkOffset;
+            }
+            else if (!buffer.uri.empty() && !tinygltf::IsDataURI(buffer.uri))
+            {
+                std::string decodedUri;
+                tinygltf::URIDecode(buffer.uri, &decodedUri, nullptr);
+                SerializationTools::setBakedPath(outTexture.path, decodedUri);
+            }
+            else
+            {
+                outTexture = {};
+                std::cerr << "Images embedded in data URIs are not supported: " << path << " image " << imageIndex << std::endl;
+            }
+        }
+        else
+        {
+            //Neither an image file nor a buffer range: the texture is skipped rather than guessed from the image name
+            std::cerr << "Unresolvable glTF image, neither a file URI nor a buffer view: " << path << " image " << imageIndex << std::endl;
+        }
+    }
+
+    //Material parameters and texture references, stored in the baked model so that loading it does not need the glTF
+    void importMaterials(const std::filesystem::path& path, const GltfAsset& asset, std::vector<SerializationTools::BakedMaterial>& outMaterials)
+    {
+        outMaterials.clear();
+        outMaterials.resize(asset.model.materials.size());
+        for (size_t i = 0; i < asset.model.materials.size(); i++)
+        {
+            const tinygltf::Material& materialInfo = asset.model.materials[i];
+            const tinygltf::PbrMetallicRoughness& pbr = materialInfo.pbrMetallicRoughness;
+            SerializationTools::BakedMaterial& material = outMaterials[i];
+
+            material.baseColorFactor = glm::vec4(pbr.baseColorFactor[0], pbr.baseColorFactor[1], pbr.baseColorFactor[2], pbr.baseColorFactor[3]);
+            material.emissiveFactor = glm::vec4(materialInfo.emissiveFactor[0], materialInfo.emissiveFactor[1], materialInfo.emissiveFactor[2], 1.f);
+            material.metallicFactor = static_cast<float>(pbr.metallicFactor);
+            material.roughnessFactor = static_cast<float>(pbr.roughnessFactor);
+            material.alphaCutoff = static_cast<float>(materialInfo.alphaCutoff);
+            if (materialInfo.alphaMode == "MASK")
+                material.alphaMode = MaskAlphaMode;
+            else if (materialInfo.alphaMode == "BLEND")
+                material.alphaMode = TransparentAlphaMode;
+
+            importTexture(path, asset, pbr.baseColorTexture.index, material.textures[SerializationTools::BakedAlbedoTexture]);
+            importTexture(path, asset, materialInfo.normalTexture.index, material.textures[SerializationTools::BakedNormalTexture]);
+            importTexture(path, asset, pbr.metallicRoughnessTexture.index, material.textures[SerializationTools::BakedMetallicRoughnessTexture]);
+            importTexture(path, asset, materialInfo.emissiveTexture.index, material.textures[SerializationTools::BakedEmissiveTexture]);
+        }
+    }
+
+    //Accessor data resolved once: first element, stride and element layout
+    struct AccessorView {
+        const unsigned char* data = nullptr; //nullptr when the accessor has no buffer view (zeros, sparse accessors only)
+        size_t stride = 0;
+        size_t count = 0;
+        int componentType = 0;
+        int componentCount = 0;
+        bool normalized = false;
+    };
+
+    //Range checked view of count elements at byteOffset in a buffer view, stride 0 for tightly packed elements
+    static AccessorView resolveView(const GltfAsset& asset, int bufferViewIndex, size_t byteOffset, size_t stride, size_t count, int componentType, int componentCount, bool normalized)
+    {
+        AccessorView view{ nullptr, stride, count, componentType, componentCount, normalized };
+        const int componentSize = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(componentType));
+        if (componentSize <= 0 || componentCount <= 0)
+            throw std::runtime_error("Invalid glTF accessor type");
+
+        const size_t elementSize = size_t(componentSize) * componentCount;
+        if (view.stride == 0)
+            view.stride = elementSize;
+        if (bufferViewIndex < 0 || count == 0)
+            return view;
+
+        if (static_cast<size_t>(bufferViewIndex) >= asset.model.bufferViews.size())
+            throw std::runtime_error("Invalid glTF buffer view");
+        const tinygltf::BufferView& bufferView = asset.model.bufferViews[bufferViewIndex];
+        if (bufferView.buffer < 0 || static_cast<size_t>(bufferView.buffer) >= asset.buffers.size())
+            throw std::runtime_error("Invalid glTF buffer");
+        const std::span<const unsigned char> buffer = asset.buffers[bufferView.buffer];
+
+        const size_t end = byteOffset + view.stride * (count - 1) + elementSize;
+        if (end > bufferView.byteLength || bufferView.byteOffset + bufferView.byteLength > buffer.size())
+            throw std::runtime_error("glTF accessor out of its buffer range");
+
+        view.data = buffer.data() + bufferView.byteOffset + byteOffset;
+        return view;
+    }
+
+    static AccessorView resolveAccessor(const GltfAsset& asset, const tinygltf::Accessor& accessor)
+    {
+        size_t stride = 0;
+        if (accessor.bufferView >= 0 && static_cast<size_t>(accessor.bufferView) < asset.model.bufferViews.size())
+            stride = asset.model.bufferViews[accessor.bufferView].byteStride;
+        return resolveView(asset, accessor.bufferView, accessor.byteOffset, stride, accessor.count, accessor.componentType, tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type)), accessor.normalized);
+    }
+
+    //glTF normalized integers: unsigned map to [0, 1], signed to [-1, 1]
+    template <typename T, bool Normalized>
+    static float componentToFloat(T value)
+    {
+        if constexpr (!Normalized || std::is_floating_point_v<T>)
+            return static_cast<float>(value);
+        else if constexpr (std::is_signed_v<T>)
+            return std::max(static_cast<float>(value) / std::numeric_limits<T>::max(), -1.0f);
+        else
+            return static_cast<float>(value) / std::numeric_limits<T>::max();
+    }
+
+    //Writes N floats per element at out + i * outStride (bytes), one specialization per source component type
+    template <typename T, int N, bool Normalized>
+    static void decodeElements(const AccessorView& view, float* out, size_t outStride)
+    {
+        unsigned char* output = reinterpret_cast<unsigned char*>(out);
+        const unsigned char* input = view.data;
+        for (size_t i = 0; i < view.count; i++, input += view.stride, output += outStride)
+        {
+            if constexpr (std::is_same_v<T, float>)
+            {
+                memcpy(output, input, N * sizeof(float));
+            }
+            else
+            {
+                T components[N];
+                memcpy(components, input, sizeof(components));
+                float values[N];
+                for (int k = 0; k < N; k++)
+                    values[k] = componentToFloat<T, Normalized>(components[k]);
+                memcpy(output, values, sizeof(values));
+            }
+        }
+    }
+
+    template <int N>
+    static void decodeFloatView(const AccessorView& view, float* out, size_t outStride)
+    {
+        if (view.componentCount != N)
+            throw std::runtime_error("Unexpected glTF accessor type");
+
+        if (view.data == nullptr)
+        {
+            for (size_t i = 0; i < view.count; i++)
+                memset(reinterpret_cast<unsigned char*>(out) + i * outStride, 0, N * sizeof(float));
+            return;
+        }
+
+        switch (view.componentType)
+        {
+        case TINYGLTF_COMPONENT_TYPE_FLOAT: decodeElements<float, N, false>(view, out, outStride); break;
+        case TINYGLTF_COMPONENT_TYPE_BYTE: view.normalized ? decodeElements<int8_t, N, true>(view, out, outStride) : decodeElements<int8_t, N, false>(view, out, outStride); break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: view.normalized ? decodeElements<uint8_t, N, true>(view, out, outStride) : decodeElements<uint8_t, N, false>(view, out, outStride); break;
+        case TINYGLTF_COMPONENT_TYPE_SHORT: view.normalized ? decodeElements<int16_t, N, true>(view, out, outStride) : decodeElements<int16_t, N, false>(view, out, outStride); break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: view.normalized ? decodeElements<uint16_t, N, true>(view, out, outStride) : decodeElements<uint16_t, N, false>(view, out, outStride); break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: decodeElements<uint32_t, N, false>(view, out, outStride); break;
+        default: throw std::runtime_error("Unsupported glTF component type");
+        }
+    }
+
+    template <typename T>
+    static void decodeUnsignedElements(const AccessorView& view, uint32_t* out)
+    {
+        const unsigned char* input = view.data;
+        for (size_t i = 0; i < view.count; i++, input += view.stride)
+        {
+            T value;
+            memcpy(&value, input, sizeof(T));
+            out[i] = value;
+        }
+    }
+
+    static void decodeUnsignedView(const AccessorView& view, uint32_t* out)
+    {
+        if (view.componentCount != 1)
+            throw std::runtime_error("Unexpected glTF accessor type");
+
+        if (view.data == nullptr)
+        {
+            std::fill(out, out + view.count, 0);
+            return;
+        }
+
+        switch (view.componentType)
+        {
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: decodeUnsignedElements<uint8_t>(view, out); break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: decodeUnsignedElements<uint16_t>(view, out); break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: decodeUnsignedElements<uint32_t>(view, out); break;
+        default: throw std::runtime_error("Unsupported glTF index component type");
+        }
+    }
+
+    //Sparse accessors: the base values are overridden at the listed element indices
+    static std::vector<uint32_t> decodeSparseIndices(const GltfAsset& asset, const tinygltf::Accessor& accessor)
+    {
+        const auto& sparse = accessor.sparse;
+        std::vector<uint32_t> sparseIndices(sparse.count);
+        decodeUnsignedView(resolveView(asset, sparse.indices.bufferView, sparse.indices.byteOffset, 0, sparse.count, sparse.indices.componentType, 1, false), sparseIndices.data());
+        for (uint32_t index : sparseIndices)
+        {
+            if (index >= accessor.count)
+                throw std::runtime_error("glTF sparse index out of the accessor range");
+        }
+        return sparseIndices;
+    }
+
+    //Decodes a float accessor of N components (any component type) at out + i * outStride (bytes)
+    template <int N>
+    static size_t decodeAttribute(const GltfAsset& asset, const tinygltf::Accessor& accessor, float* out, size_t outStride)
+    {
+        AccessorView view = resolveAccessor(asset, accessor);
+        decodeFloatView<N>(view, out, outStride);
+
+        size_t decodedBytes = view.count * view.componentCount * tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(view.componentType));
+        if (accessor.sparse.isSparse && accessor.sparse.count > 0)
+        {
+            std::vector<uint32_t> sparseIndices = decodeSparseIndices(asset, accessor);
+            std::vector<float> sparseValues(size_t(accessor.sparse.count) * N);
+            AccessorView valuesView = resolveView(asset, accessor.sparse.values.bufferView, accessor.sparse.values.byteOffset, 0, accessor.sparse.count, accessor.componentType, view.componentCount, accessor.normalized);
+            decodeFloatView<N>(valuesView, sparseValues.data(), N * sizeof(float));
+            for (size_t i = 0; i < sparseIndices.size(); i++)
+                memcpy(reinterpret_cast<unsigned char*>(out) + sparseIndices[i] * outStride, &sparseValues[i * N], N * sizeof(float));
+        }
+        return decodedBytes;
+    }
+
+    //Decodes u8/u16/u32 indices and rebases them on the first vertex of the primitive
+    static size_t decodeIndices(const GltfAsset& asset, const tinygltf::Accessor& accessor, uint32_t vertexBase, size_t vertexCount, uint32_t* out)
+    {
+        AccessorView view = resolveAccessor(asset, accessor);
+        decodeUnsignedView(view, out);
+
+        if (accessor.sparse.isSparse && accessor.sparse.count > 0)
+        {
+            std::vector<uint32_t> sparseIndices = decodeSparseIndices(asset, accessor);
+            std::vector<uint32_t> sparseValues(accessor.sparse.count);
+            decodeUnsignedView(resolveView(asset, accessor.sparse.values.bufferView, accessor.sparse.values.byteOffset, 0, accessor.sparse.count, accessor.componentType, 1, false), sparseValues.data());
+            for (size_t i = 0; i < sparseIndices.size(); i++)
+                out[sparseIndices[i]] = sparseValues[i];
+        }
+
+        uint32_t maxIndex = 0;
+        for (size_t i = 0; i < view.count; i++)
+            maxIndex = std::max(maxIndex, out[i]);
+        if (view.count > 0 && maxIndex >= vertexCount)
+            throw std::runtime_error("glTF index exceeds the primitive vertex count");
+
+        for (size_t i = 0; i < view.count; i++)
+            out[i] += vertexBase;
+        return view.count * tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(view.componentType));
+    }
+
+    static int findAttribute(const tinygltf::Primitive& primitive, const char* name)
+    {
+        auto attribute = primitive.attributes.find(name);
+        return attribute == primitive.attributes.end() ? -1 : attribute->second;
+    }
+
+    //glTF primitives without normals use flat normals: every triangle gets its own vertices
+    static void flattenPrimitive(MeshGeometry& geometry, size_t vertexBase, size_t indexBase)
+    {
+        std::vector<Vertex> corners;
+        corners.reserve(geometry.indices.size() - indexBase);
+        for (size_t i = indexBase; i + 2 < geometry.indices.size(); i += 3)
+        {
+            Vertex v0 = geometry.vertices[geometry.indices[i + 0]];
+            Vertex v1 = geometry.vertices[geometry.indices[i + 1]];
+            Vertex v2 = geometry.vertices[geometry.indices[i + 2]];
+            glm::vec3 normal = glm::cross(v1.pos - v0.pos, v2.pos - v0.pos);
+            float length = glm::length(normal);
+            normal = length > FLT_EPSILON ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+            v0.normal = v1.normal = v2.normal = normal;
+            corners.push_back(v0);
+            corners.push_back(v1);
+            corners.push_back(v2);
+        }
+
+        geometry.vertices.resize(vertexBase);
+        geometry.vertices.insert(geometry.vertices.end(), corners.begin(), corners.end());
+        geometry.indices.resize(indexBase + corners.size());
+        for (size_t i = 0; i < corners.size(); i++)
+            geometry.indices[indexBase + i] = static_cast<uint32_t>(vertexBase + i);
+    }
+
+    static bool isTriangleList(const tinygltf::Primitive& primitive)
+    {
+        return primitive.mode == TINYGLTF_MODE_TRIANGLES || primitive.mode == -1;
+    }
+
+    //Appends a primitive to a geometry, missing attributes stay zero
+    static void decodePrimitive(const GltfAsset& asset, const tinygltf::Primitive& primitive, MeshGeometry& geometry, ImportStatistics& statistics)
+    {
+        int positionIndex = findAttribute(primitive, "POSITION");
+        int normalIndex = findAttribute(primitive, "NORMAL");
+        int texCoordIndex = findAttribute(primitive, "TEXCOORD_0");
+        int tangentIndex = findAttribute(primitive, "TANGENT");
+
+        const size_t vertexBase = geometry.vertices.size();
+        const size_t indexBase = geometry.indices.size();
+        const size_t vertexCount = asset.model.accessors[positionIndex].count;
+
+        //Vertices, shared between the primitive's triangles
+        geometry.vertices.resize(vertexBase + vertexCount, Vertex{});
+        Vertex* vertices = geometry.vertices.data() + vertexBase;
+        statistics.decodedBytes += decodeAttribute<3>(asset, asset.model.accessors[positionIndex], &vertices->pos.x, sizeof(Vertex));
+        if (normalIndex >= 0)
+            statistics.decodedBytes += decodeAttribute<3>(asset, asset.model.accessors[normalIndex], &vertices->normal.x, sizeof(Vertex));
+        if (texCoordIndex >= 0)
+            statistics.decodedBytes += decodeAttribute<2>(asset, asset.model.accessors[texCoordIndex], &vertices->texCoord.x, sizeof(Vertex));
+        //Tangents are only meaningful with the normals they were authored against, flat shaded primitives get generated ones
+        if (tangentIndex >= 0 && normalIndex >= 0)
+            statistics.decodedBytes += decodeAttribute<4>(asset, asset.model.accessors[tangentIndex], &vertices->tangent.x, sizeof(Vertex));
+
+        //Indices, non indexed primitives list their vertices in order
+        if (primitive.indices >= 0)
+        {
+            const tinygltf::Accessor& indicesAccessor = asset.model.accessors[primitive.indices];
+            geometry.indices.resize(indexBase + indicesAccessor.count);
+            statistics.decodedBytes += decodeIndices(asset, indicesAccessor, static_cast<uint32_t>(vertexBase), vertexCount, geometry.indices.data() + indexBase);
+        }
+        else
+        {
+            geometry.indices.resize(indexBase + vertexCount);
+            std::iota(geometry.indices.begin() + indexBase, geometry.indices.end(), static_cast<uint32_t>(vertexBase));
+        }
+        geometry.indices.resize(indexBase + (geometry.indices.size() - indexBase) / 3 * 3);
+
+        if (normalIndex < 0)
+            flattenPrimitive(geometry, vertexBase, indexBase);
+    }
+
+    //Bakes a node transform into the vertices appended since vertexBase and indexBase, mirroring transforms keep their triangles front facing
+    static void transformPrimitive(MeshGeometry& geometry, size_t vertexBase, size_t indexBase, const glm::mat4& transform)
+    {
+        const glm::mat3 linear = glm::mat3(transform);
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+        const bool mirrored = glm::determinant(linear) < 0.0f;
+
+        for (size_t i = vertexBase; i < geometry.vertices.size(); i++)
+        {
+            Vertex& vertex = geometry.vertices[i];
+            vertex.pos = glm::vec3(transform * glm::vec4(vertex.pos, 1.0f));
+            glm::vec3 normal = normalMatrix * vertex.normal;
+            float length = glm::length(normal);
+            vertex.normal = length > FLT_EPSILON ? normal / length : vertex.normal;
+
+            //Imported tangents follow the surface, mirroring flips the bitangent
+            if (vertex.tangent.w != 0.0f)
+            {
+                glm::vec3 tangent = linear * glm::vec3(vertex.tangent);
+                length = glm::length(tangent);
+                vertex.tangent = glm::vec4(length > FLT_EPSILON ? tangent / length : glm::vec3(vertex.tangent), mirrored ? -vertex.tangent.w : vertex.tangent.w);
+            }
+        }
+
+        if (mirrored)
+        {
+            for (size_t i = indexBase; i + 2 < geometry.indices.size(); i += 3)
+                std::swap(geometry.indices[i + 1], geometry.indices[i + 2]);
+        }
+    }
+
+    //Local transform of a node, either a matrix or translation * rotation * scale
+    static glm::mat4 nodeMatrix(const tinygltf::Node& node)
+    {
+        if (node.matrix.size() == 16)
+        {
+            glm::mat4 matrix;
+            for (int i = 0; i < 16; i++)
+                matrix[i / 4][i % 4] = static_cast<float>(node.matrix[i]);
+            return matrix;
+        }
+
+        glm::mat4 matrix(1.0f);
+        if (node.translation.size() == 3)
+            matrix = glm::translate(matrix, glm::vec3(node.translation[0], node.translation[1], node.translation[2]));
+        if (node.rotation.size() == 4)
+            matrix *= glm::mat4_cast(glm::quat(static_cast<float>(node.rotation[3]), static_cast<float>(node.rotation[0]), static_cast<float>(node.rotation[1]), static_cast<float>(node.rotation[2])));
+        if (node.scale.size() == 3)
+            matrix = glm::scale(matrix, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
+        return matrix;
+    }
+
+    //Per instance transforms of EXT_mesh_gpu_instancing, relative to the node
+    static std::vector<glm::mat4> gpuInstanceMatrices(const GltfAsset& asset, const tinygltf::Node& node)
+    {
+        auto extension = node.extensions.find("EXT_mesh_gpu_instancing");
+        if (extension == node.extensions.end() || !extension->second.Has("attributes"))
+            return {};
+
+        const tinygltf::Value& attributes = extension->second.Get("attributes");
+        auto accessorIndex = [&attributes, &asset](const char* name) {
+            int index = attributes.Has(name) ? attributes.Get(name).GetNumberAsInt() : -1;
+            return index >= 0 && static_cast<size_t>(index) < asset.model.accessors.size() ? index : -1;
+        };
+        const int translationIndex = accessorIndex("TRANSLATION");
+        const int rotationIndex = accessorIndex("ROTATION");
+        const int scaleIndex = accessorIndex("SCALE");
+
+        size_t instanceCount = 0;
+        for (int index : { translationIndex, rotationIndex, scaleIndex })
+        {
+            if (index < 0)
+                continue;
+            if (instanceCount != 0 && asset.model.accessors[index].count != instanceCount)
+                throw std::runtime_error("EXT_mesh_gpu_instancing attributes have different counts");
+            instanceCount = asset.model.accessors[index].count;
+        }
+
+        std::vector<glm::vec3> translations(instanceCount, glm::vec3(0.0f));
+        std::vector<glm::vec4> rotations(instanceCount, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        std::vector<glm::vec3> scales(instanceCount, glm::vec3(1.0f));
+        if (translationIndex >= 0)
+            decodeAttribute<3>(asset, asset.model.accessors[translationIndex], &translations[0].x, sizeof(glm::vec3));
+        if (rotationIndex >= 0)
+            decodeAttribute<4>(asset, asset.model.accessors[rotationIndex], &rotations[0].x, sizeof(glm::vec4));
+        if (scaleIndex >= 0)
+            decodeAttribute<3>(asset, asset.model.accessors[scaleIndex], &scales[0].x, sizeof(glm::vec3));
+
+        std::vector<glm::mat4> matrices(instanceCount);
+        for (size_t i = 0; i < instanceCount; i++)
+        {
+            glm::quat rotation = glm::normalize(glm::quat(rotations[i].w, rotations[i].x, rotations[i].y, rotations[i].z));
+            matrices[i] = glm::scale(glm::translate(glm::mat4(1.0f), translations[i]) * glm::mat4_cast(rotation), scales[i]);
+        }
+        return matrices;
+    }
+
+    //Depth first traversal of the node hierarchy, collects the world transforms of every mesh
+    static void collectMeshTransforms(const GltfAsset& asset, int nodeIndex, const glm::mat4& parentMatrix, std::vector<std::vector<glm::mat4>>& meshTransforms, uint32_t depth)
+    {
+        if (nodeIndex < 0 || static_cast<size_t>(nodeIndex) >= asset.model.nodes.size() || depth > asset.model.nodes.size())
+            throw std::runtime_error("Invalid glTF node hierarchy");
+
+        const tinygltf::Node& node = asset.model.nodes[nodeIndex];
+        const glm::mat4 matrix = parentMatrix * nodeMatrix(node);
+
+        if (node.mesh >= 0 && static_cast<size_t>(node.mesh) < asset.model.meshes.size())
+        {
+            //Skinned meshes are not animated, their vertices are drawn in bind pose and the node transform is ignored as the spec requires
+            const glm::mat4 meshMatrix = node.skin >= 0 ? glm::mat4(1.0f) : matrix;
+            std::vector<glm::mat4> instanceMatrices = gpuInstanceMatrices(asset, node);
+            if (instanceMatrices.empty())
+                meshTransforms[node.mesh].push_back(meshMatrix);
+            for (const glm::mat4& instanceMatrix : instanceMatrices)
+                meshTransforms[node.mesh].push_back(meshMatrix * instanceMatrix);
+        }
+
+        for (int child : node.children)
+            collectMeshTransforms(asset, child, matrix, meshTransforms, depth + 1);
+    }
+
+    //Meshes used once are transformed and merged by material in the first geometries (drawn by the first instance, with an identity transform)
+    //Meshes used by several nodes or GPU instances keep their own geometries, one per material, drawn by one instance per use
+    ImportStatistics importGeometry(const GltfAsset& asset, std::vector<MeshGeometry>& outGeometries, std::vector<SerializationTools::BakedInstance>& outInstances)
+    {
+        const size_t materialCount = std::max<size_t>(asset.model.materials.size(), 1);
+        auto materialIndex = [&asset](const tinygltf::Primitive& primitive) {
+            return (primitive.material < 0 || static_cast<size_t>(primitive.material) >= asset.model.materials.size()) ? 0u : static_cast<uint32_t>(primitive.material);
+        };
+
+        ImportStatistics statistics{};
+        auto decodeStart = std::chrono::high_resolution_clock::now();
+
+        //Files without scene are drawn as a flat list of meshes
+        std::vector<std::vector<glm::mat4>> meshTransforms(asset.model.meshes.size());
+        if (asset.model.scenes.empty())
+        {
+            for (auto& transforms : meshTransforms)
+                transforms.push_back(glm::mat4(1.0f));
+        }
+        else
+        {
+            const tinygltf::Scene& scene = asset.model.scenes[asset.model.defaultScene >= 0 && static_cast<size_t>(asset.model.defaultScene) < asset.model.scenes.size() ? asset.model.defaultScene : 0];
+            for (int node : scene.nodes)
+                collectMeshTransforms(asset, node, glm::mat4(1.0f), meshTransforms, 0);
+        }
+
+        //Geometry layout: merged geometries first, then the geometries of each shared mesh
+        outGeometries.clear();
+        outGeometries.resize(materialCount);
+        for (uint32_t i = 0; i < materialCount; i++)
+            outGeometries[i].materialIndex = i;
+        outInstances.clear();
+        outInstances.push_back({ .transform = glm::mat4(1.0f), .firstMesh = 0, .meshCount = static_cast<uint32_t>(materialCount) });
+
+        std::vector<std::vector<uint32_t>> primitiveGeometries(asset.model.meshes.size());
+        for (size_t meshIndex = 0; meshIndex < asset.model.meshes.size(); meshIndex++)
+        {
+            const tinygltf::Mesh& mesh = asset.model.meshes[meshIndex];
+            const bool isShared = meshTransforms[meshIndex].size() > 1;
+            const size_t firstGeometry = outGeometries.size();
+            for (const auto& primitive : mesh.primitives)
+            {
+                uint32_t geometryIndex = materialIndex(primitive);
+                if (isShared)
+                {
+                    auto geometry = std::find_if(outGeometries.begin() + firstGeometry, outGeometries.end(), [&](const MeshGeometry& g) { return g.materialIndex == materialIndex(primitive); });
+                    if (geometry == outGeometries.end())
+                    {
+                        geometry = outGeometries.insert(outGeometries.end(), MeshGeometry{ .vertices = {}, .indices = {}, .materialIndex = materialIndex(primitive) });
+                    }
+                    geometryIndex = static_cast<uint32_t>(geometry - outGeometries.begin());
+                }
+                primitiveGeometries[meshIndex].push_back(geometryIndex);
+            }
+
+            if (isShared)
+            {
+                for (const glm::mat4& transform : meshTransforms[meshIndex])
+                    outInstances.push_back({ .transform = transform, .firstMesh = static_cast<uint32_t>(firstGeometry), .meshCount = static_cast<uint32_t>(outGeometries.size() - firstGeometry) });
+            }
+        }
+
+        //Sizes first, the streams are then decoded in place
+        std::vector<size_t> vertexCounts(outGeometries.size(), 0);
+        std::vector<size_t> indexCounts(outGeometries.size(), 0);
+        for (size_t meshIndex = 0; meshIndex < asset.model.meshes.size(); meshIndex++)
+        {
+            const size_t copyCount = std::min<size_t>(meshTransforms[meshIndex].size(), 1);
+            for (size_t p = 0; p < asset.model.meshes[meshIndex].primitives.size(); p++)
+            {
+                const tinygltf::Primitive& primitive = asset.model.meshes[meshIndex].primitives[p];
+                int positionIndex = findAttribute(primitive, "POSITION");
+                if (!isTriangleList(primitive) || positionIndex < 0)
+                    continue;
+                size_t vertexCount = asset.model.accessors[positionIndex].count;
+                size_t indexCount = primitive.indices >= 0 ? asset.model.accessors[primitive.indices].count : vertexCount;
+                vertexCounts[primitiveGeometries[meshIndex][p]] += copyCount * (findAttribute(primitive, "NORMAL") >= 0 ? vertexCount : std::max(vertexCount, indexCount));
+                indexCounts[primitiveGeometries[meshIndex][p]] += copyCount * indexCount;
+            }
+        }
+        for (size_t i = 0; i < outGeometries.size(); i++)
+        {
+            outGeometries[i].vertices.reserve(vertexCounts[i]);
+            outGeometries[i].indices.reserve(indexCounts[i]);
+        }
+
+        for (size_t meshIndex = 0; meshIndex < asset.model.meshes.size(); meshIndex++)
+        {
+            const tinygltf::Mesh& mesh = asset.model.meshes[meshIndex];
+            if (meshTransforms[meshIndex].empty())
+                continue;
+
+            for (size_t p = 0; p < mesh.primitives.size(); p++)
+            {
+                const tinygltf::Primitive& primitive = mesh.primitives[p];
+                if (!isTriangleList(primitive) || findAttribute(primitive, "POSITION") < 0)
+                {
+                    std::cerr << "Skipped a glTF primitive of mesh " << mesh.name << ": only triangle lists with positions are supported" << std::endl;
+                    continue;
+                }
+
+                MeshGeometry& geometry = outGeometries[primitiveGeometries[meshIndex][p]];
+                const size_t vertexBase = geometry.vertices.size();
+                const size_t indexBase = geometry.indices.size();
+                decodePrimitive(asset, primitive, geometry, statistics);
+
+                //Merged meshes are moved to the model space here, shared ones stay in mesh space
+                if (meshTransforms[meshIndex].size() == 1 && meshTransforms[meshIndex][0] != glm::mat4(1.0f))
+                    transformPrimitive(geometry, vertexBase, indexBase, meshTransforms[meshIndex][0]);
+            }
+        }
+        statistics.decodeSeconds = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - decodeStart).count();
+        statistics.instanceCount = outInstances.size() - 1;
+
+        //Primitives often duplicate vertices (and materials merge several primitives), keep a single copy of each
+        for (auto& geometry : outGeometries)
+        {
+            statistics.importedVertexCount += geometry.vertices.size();
+            GeometryTools::weldVertices(geometry.vertices, geometry.indices);
+            statistics.weldedVertexCount += geometry.vertices.size();
+        }
+
+        //Parallel inside each geometry, a single large mesh uses every thread
+        for (auto& geometry : outGeometries)
+        {
+            statistics.generatedTangentCount += generateTangents(geometry);
+        }
+
+        return statistics;
+    }
+
+    //Vertices or triangles processed by a parallel job of generateTangents
+    constexpr uint32_t TANGENT_CHUNK_SIZE = 1 << 14;
+
+    //Angle of a triangle corner, weights its contribution to the vertex tangent space as MikkTSpace does
+    static float cornerAngle(const glm::vec3& corner, const glm::vec3& a, const glm::vec3& b)
+    {
+        glm::vec3 edgeA = a - corner;
+        glm::vec3 edgeB = b - corner;
+        float lengths = glm::length(edgeA) * glm::length(edgeB);
+        return lengths > FLT_EPSILON ? std::acos(std::clamp(glm::dot(edgeA, edgeB) / lengths, -1.0f, 1.0f)) : 0.0f;
+    }
+
+    //Generates the tangents of the vertices without imported ones (tangent.w == 0), returns how many were generated
+    //Each vertex sums the angle weighted tangent frames of its triangles projected on its normal, so the result only depends on the triangle order through float rounding
+    size_t generateTangents(MeshGeometry& geometry)
+    {
+        const uint32_t vertexCount = static_cast<uint32_t>(geometry.vertices.size());
+        const uint32_t triangleCount = static_cast<uint32_t>(geometry.indices.size() / 3);
+        const Vertex* vertices = geometry.vertices.data();
+        const uint32_t* indices = geometry.indices.data();
+
+        size_t missingCount = 0;
+        for (const Vertex& vertex : geometry.vertices)
+            missingCount += vertex.tangent.w == 0.0f;
+        if (missingCount == 0)
+            return 0;
+
+        //Tangent and bitangent directions of each triangle, zero for degenerate texture mappings
+        std::vector<glm::vec3> triangleTangents(triangleCount);
+        std::vector<glm::vec3> triangleBitangents(triangleCount);
+        GeometryTools::runParallel((triangleCount + TANGENT_CHUNK_SIZE - 1) / TANGENT_CHUNK_SIZE, 0, [&](uint32_t chunk) {
+            const uint32_t end = std::min(triangleCount, (chunk + 1) * TANGENT_CHUNK_SIZE);
+            for (uint32_t t = chunk * TANGENT_CHUNK_SIZE; t < end; t++)
+            {
+                const Vertex& v0 = vertices[indices[3 * t + 0]];
+                const Vertex& v1 = vertices[indices[3 * t + 1]];
+                const Vertex& v2 = vertices[indices[3 * t + 2]];
+
+                glm::vec3 edge1 = v1.pos - v0.pos;
+                glm::vec3 edge2 = v2.pos - v0.pos;
+                glm::vec2 deltaUV1 = v1.texCoord - v0.texCoord;
+                glm::vec2 deltaUV2 = v2.texCoord - v0.texCoord;
+
+                float det = deltaUV1.x * deltaUV2.y - deltaUV1.y * deltaUV2.x;
+                if (std::abs(det) < FLT_EPSILON)
+                    continue;
+
+                //The sign of det carries the handedness, only the directions are kept
+                glm::vec3 tangent = (edge1 * deltaUV2.y - edge2 * deltaUV1.y) / det;
+                glm::vec3 bitangent = (edge2 * deltaUV1.x - edge1 * deltaUV2.x) / det;
+                float tangentLength = glm::length(tangent);
+                float bitangentLength = glm::length(bitangent);
+                if (tangentLength > FLT_EPSILON && bitangentLength > FLT_EPSILON)
+                {
+                    triangleTangents[t] = tangent / tangentLength;
+                    triangleBitangents[t] = bitangent / bitangentLength;
+                }
+            }
+        });
+
+        //Corners around each vertex, in triangle order
+        std::vector<uint32_t> firstCorner(vertexCount + 1, 0);
+        for (uint32_t i = 0; i < triangleCount * 3; i++)
+            firstCorner[indices[i] + 1]++;
+        for (uint32_t v = 0; v < vertexCount; v++)
+            firstCorner[v + 1] += firstCorner[v];
+        std::vector<uint32_t> corners(triangleCount * 3);
+        {
+            std::vector<uint32_t> cursor(firstCorner.begin(), firstCorner.end() - 1);
+            for (uint32_t i = 0; i < triangleCount * 3; i++)
+                corners[cursor[indices[i]]++] = i;
+        }
+
+        GeometryTools::runParallel((vertexCount + TANGENT_CHUNK_SIZE - 1) / TANGENT_CHUNK_SIZE, 0, [&](uint32_t chunk) {
+            const uint32_t end = std::min(vertexCount, (chunk + 1) * TANGENT_CHUNK_SIZE);
+            for (uint32_t v = chunk * TANGENT_CHUNK_SIZE; v < end; v++)
+            {
+                Vertex& vertex = geometry.vertices[v];
+                if (vertex.tangent.w != 0.0f)
+                    continue;
+
+                glm::vec3 n = glm::length(vertex.normal) > FLT_EPSILON ? glm::normalize(vertex.normal) : glm::vec3(0.0f, 0.0f, 1.0f);
+                glm::vec3 tangentSum(0.0f);
+                glm::vec3 bitangentSum(0.0f);
+                for (uint32_t c = firstCorner[v]; c < firstCorner[v + 1]; c++)
+                {
+                    const uint32_t corner = corners[c];
+                    const uint32_t t = corner / 3;
+                    const uint32_t k = corner % 3;
+                    float weight = cornerAngle(vertex.pos, vertices[indices[3 * t + (k + 1) % 3]].pos, vertices[indices[3 * t + (k + 2) % 3]].pos);
+
+                    //Gram-Schmidt against the vertex normal before summing, as the triangle frames are not orthogonal to it
+                    glm::vec3 tangent = triangleTangents[t] - n * glm::dot(n, triangleTangents[t]);
+                    glm::vec3 bitangent = triangleBitangents[t] - n * glm::dot(n, triangleBitangents[t]);
+                    float tangentLength = glm::length(tangent);
+                    float bitangentLength = glm::length(bitangent);
+                    if (tangentLength > FLT_EPSILON)
+                        tangentSum += tangent * (weight / tangentLength);
+                    if (bitangentLength > FLT_EPSILON)
+                        bitangentSum += bitangent * (weight / bitangentLength);
+                }
+
+                glm::vec3 tangent = tangentSum - n * glm::dot(n, tangentSum);
+                float length = glm::length(tangent);
+                tangent = length > FLT_EPSILON ? tangent / length : glm::normalize(glm::cross(n, std::abs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f)));
+                vertex.tangent = glm::vec4(tangent, glm::dot(glm::cross(n, tangent), bitangentSum) < 0.0f ? -1.0f : 1.0f);
+            }
+        });
+
+        return missingCount;
+    }
+}
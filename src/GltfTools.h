@@ -0,0 +1,39 @@
+#pragma once
+#include "Defs.h"
+#include "SerializationTools.h"
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#define TINYGLTF_USE_CPP14
+#include "tiny_gltf.h"
+
+//glTF import shared by the renderer and the offline baker, nothing here touches Vulkan
+namespace GltfTools {
+    //Vertices and indices of the primitives drawn with the same material
+    struct MeshGeometry{
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        uint32_t materialIndex = 0;
+    };
+
+    struct ImportStatistics{
+        size_t importedVertexCount = 0;
+        size_t weldedVertexCount = 0;
+        size_t decodedBytes = 0; //Accessor bytes read, for throughput measures
+        float decodeSeconds = 0.f;
+        size_t instanceCount = 0; //Instances of shared meshes
+        size_t generatedTangentCount = 0; //Vertices without a glTF TANGENT
+    };
+
+    //glTF document and the bytes of its buffers, which point into the mapped GLB BIN chunk instead of a copy when possible
+    struct GltfAsset{
+        tinygltf::Model model;
+        std::vector<std::span<const unsigned char>> buffers; //One per model buffer
+        std::unique_ptr<SerializationTools::MappedFile> file; //GLB files only
+        uint64_t binaryChunkOffset = 0; //Of the GLB BIN chunk in the file
+    };
+
+    void loadGltfData(const std::filesystem::path& path, GltfAsset& outAsset, bool loadImages = true);
+    [[nodiscard]]std::vector<std::filesystem::path> listSourceFiles(const std::filesystem::path& path, const GltfAsset& asset);
+    void importMaterials(const std::filesystem::path& path, const GltfAsset& asset, std::vector<SerializationTools::BakedMaterial>& outMaterials);
+    ImportStatistics importGeometry(const GltfAsset& asset, std::vector<MeshGeometry>& outGeometries, std::vector<SerializationTools::BakedInstance>& outInstances);
+    size_t generateTangents(MeshGeometry& geometry);
+}
@@ -170,6 +170,7 @@ void MainRenderPass::createDescriptorPool()
         poolSizes[3].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) * MAX_TEXTURE_COUNT; //Dynamic Indexing
 
         vk::DescriptorPoolCreateInfo poolInfo{
+            .flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind, //Texture array
             .maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT),
             .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
             .pPoolSizes = poolSizes.data(),
@@ -243,6 +244,7 @@ void MainRenderPass::createDescriptorSetLayout()
     //Descriptor indexing
     vk::DescriptorBindingFlags bindingFlags[4];
     bindingFlags[3] = vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eVariableDescriptorCount; //Necessary for Dynamic indexing (VK_EXT_descriptor_indexing)
+    bindingFlags[3] |= vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending; //Elements are written while the set is bound
 
     vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo{
         .bindingCount = 4,
@@ -251,6 +253,7 @@ void MainRenderPass::createDescriptorSetLayout()
 
     vk::DescriptorSetLayoutCreateInfo layoutInfo{
         .pNext = &bindingFlagsCreateInfo,
+        .flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
         .bindingCount = 4,
         .pBindings = bindings,
     };
@@ -295,16 +298,13 @@ void MainRenderPass::createDescriptorSetLayout()
 }
 
 //Creates the descriptor set that has the general/camera ubo, the light ubo array, the shadow map and the texture array
-void MainRenderPass::createMainDescriptorSet(VulkanScene* scene)
+void MainRenderPass::createMainDescriptorSet(VulkanScene* scene, const std::vector<vk::DescriptorImageInfo>& textureImageInfos)
 {
-    //Creates a vector of descriptorImageInfo from the scene's textures
-    std::vector<vk::DescriptorImageInfo> textureImageInfos = scene->generateTextureImageInfo();
-
     m_mainDescriptorSet.resize(MAX_FRAMES_IN_FLIGHT);
     std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, m_mainDescriptorSetLayout);
 
     /* Dynamic Descriptor Counts */
-    uint32_t textureMaxCount = textureImageInfos.size();
+    uint32_t textureMaxCount = MAX_TEXTURE_COUNT; //Textures added to the scene are written in place
     std::vector<uint32_t> textureMaxCounts(MAX_FRAMES_IN_FLIGHT, textureMaxCount);
     //std::vector<uint32_t> textureMaxCounts(MAX_FRAMES_IN_FLIGHT, materialMaxCount);
     vk::DescriptorSetVariableDescriptorCountAllocateInfo setCounts{
@@ -461,10 +461,26 @@ void MainRenderPass::createMaterialDescriptorSet(VulkanScene* scene)
 
 void MainRenderPass::createDescriptorSets(VulkanScene* scene, std::vector<vk::DescriptorImageInfo> textureImageInfos)
 {
-    createMainDescriptorSet(scene);
+    createMainDescriptorSet(scene, textureImageInfos);
     createMaterialDescriptorSet(scene);
 }
 
+//Writes the streamed images in the texture array of this frame's descriptor set
+void MainRenderPass::updateTextureDescriptors(uint32_t currentFrame, const std::vector<TextureDescriptorUpdate>& updates)
+{
+    std::vector<vk::WriteDescriptorSet> descriptorWrites(updates.size());
+    for (size_t i = 0; i < updates.size(); i++)
+    {
+        descriptorWrites[i].dstSet = m_mainDescriptorSet[currentFrame];
+        descriptorWrites[i].dstBinding = 3;
+        descriptorWrites[i].dstArrayElement = updates[i].textureId;
+        descriptorWrites[i].descriptorCount = 1;
+        descriptorWrites[i].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+        descriptorWrites[i].pImageInfo = &updates[i].imageInfo;
+    }
+    m_context->getDevice().updateDescriptorSets(descriptorWrites, nullptr);
+}
+
 void MainRenderPass::createPipelineLayout(vk::DescriptorSetLayout geometryDescriptorSetLayout)
 {
     std::array<vk::DescriptorSetLayout, 3> layouts = { geometryDescriptorSetLayout, m_mainDescriptorSetLayout, m_materialDescriptorSetLayout };
@@ -503,7 +519,7 @@ vk::Extent2D MainRenderPass::getRenderPassExtent()
 }
 
 //Records commands for drawing ImGUI debug window
-void MainRenderPass::renderImGui(vk::CommandBuffer commandBuffer)
+void MainRenderPass::renderImGui(vk::CommandBuffer commandBuffer, std::vector<VulkanScene*> scenes)
 {
     ImGui_ImplVulkan_NewFrame();
     ImGui_ImplGlfw_NewFrame();
@@ -519,6 +535,22 @@ void MainRenderPass::renderImGui(vk::CommandBuffer commandBuffer)
     
     ImGui::Text("Statistics:");
     ImGui::Text("Framerate: %f", framerate);
+
+    //Summed over the depth pre-pass and main pass, shadow cascades are not cone culled
+    MeshletCullingStats cullingStats{};
+    for (auto& scene : scenes)
+    {
+        cullingStats.testedMeshlets += scene->getCullingStats().testedMeshlets;
+        cullingStats.coneRejectedMeshlets += scene->getCullingStats().coneRejectedMeshlets;
+    }
+    float coneRejectedRatio = cullingStats.testedMeshlets > 0 ? 100.f * cullingStats.coneRejectedMeshlets / cullingStats.testedMeshlets : 0.f;
+    ImGui::Text("Cone culled meshlets: %u / %u in the LOD cut (%.1f%%)", cullingStats.coneRejectedMeshlets, cullingStats.testedMeshlets, coneRejectedRatio);
+
+    for (auto& scene : scenes)
+    {
+        const TextureStreamer* textureStreamer = scene->getTextureStreamer();
+        ImGui::Text("Streamed textures: %zu, %.1f / %llu MiB of mips, %u loading", textureStreamer->getStreamedTextureCount(), textureStreamer->getResidentSize() / float(1 << 20), static_cast<unsigned long long>(TEXTURE_STREAMING_BUDGET >> 20), textureStreamer->getLoadingCount());
+    }
     ImGui::Text("----------");
 
 
@@ -614,6 +646,7 @@ void MainRenderPass::drawRenderPass(vk::CommandBuffer commandBuffer, uint32_t sw
     };
     ModelPushConstant pushConstant;
     pushConstant.shellCount = shellCount;
+    pushConstant.lodPixelScale = 0.5f * getRenderPassExtent().height / LOD_PIXEL_ERROR;
     commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
 
     commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_mainPipeline->getPipeline()); //Only one main draw pipeline per frame in this renderer
@@ -624,7 +657,7 @@ void MainRenderPass::drawRenderPass(vk::CommandBuffer commandBuffer, uint32_t sw
         scene->draw(commandBuffer, m_currentFrame, m_pipelineLayout, pushConstant);
     }
     
-    renderImGui(commandBuffer);
+    renderImGui(commandBuffer, scenes);
     commandBuffer.endRenderPass();
 }
 
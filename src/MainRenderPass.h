@@ -57,12 +57,13 @@ public:
 	void createPipelineRessources()override;
 	void createPushConstantsRanges()override;
 	void updatePipelineRessources(uint32_t currentFrame, std::vector<VulkanScene*> scenes)override;
+	void updateTextureDescriptors(uint32_t currentFrame, const std::vector<TextureDescriptorUpdate>& updates)override;
 	[[nodiscard]] vk::Extent2D getRenderPassExtent() override;
-	void renderImGui(vk::CommandBuffer commandBuffer);
+	void renderImGui(vk::CommandBuffer commandBuffer, std::vector<VulkanScene*> scenes);
 	void drawRenderPass(vk::CommandBuffer commandBuffer, uint32_t swapchainImageIndex, uint32_t m_currentFrame, std::vector<VulkanScene*> scenes) override;
 private:
 	void createShadowMapSampler();
-	void createMainDescriptorSet(VulkanScene* scene);
+	void createMainDescriptorSet(VulkanScene* scene, const std::vector<vk::DescriptorImageInfo>& textureImageInfos);
 	void createMaterialDescriptorSet(VulkanScene* scene);
 	void updateMaterialUniformBuffer(uint32_t currentFrame, std::vector<VulkanScene*> scenes);
 
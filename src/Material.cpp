@@ -84,10 +84,6 @@ Material* Material::setAlphaMode(AlphaMode alphaMode) {
 
 Material* Material::setAlbedoTexture(VulkanImage* texture)
 {
-    if (m_hasAlbedoTexture)
-    {
-        delete m_albedoTexture;
-    }
     m_albedoTexture = texture;
     m_hasAlbedoTexture = true;
     return this;
@@ -115,29 +111,18 @@ bool Material::hasEmissiveTexture()
 
 Material* Material::setMetallicRoughnessTexture(VulkanImage* texture)
 {
-    if (m_hasMetallicRoughnessTexture) {
-        delete m_metallicRoughnessTexture;
-    }
     m_metallicRoughnessTexture = texture;
     m_hasMetallicRoughnessTexture = true;
     return this;
 }
 
 Material* Material::setNormalTexture(VulkanImage* texture) {
-    if (m_hasNormalTexture)
-    {
-        delete m_normalTexture;
-    }
     m_normalTexture = texture;
     m_hasNormalTexture = true;
     return this;
 }
 
 Material* Material::setEmissiveTexture(VulkanImage* texture) {
-    if (m_hasEmissiveTexture)
-    {
-        delete m_emissiveTexture;
-    }
     m_emissiveTexture = texture;
     m_hasEmissiveTexture = true;
     return this;
@@ -157,12 +142,9 @@ VulkanImage* Material::getAlbedoTexture() {
     throw std::runtime_error("Tried to retrieve an albedo texture that doesn't exist");
 }
 
+//Textures are owned by the TextureRegistry, they can be shared with other materials
 Material::~Material()
 {
-    delete m_albedoTexture;
-    delete m_normalTexture;
-    delete m_metallicRoughnessTexture;
-    delete m_emissiveTexture;
 }
 
 VulkanImage* Material::getNormalTexture() {
@@ -44,6 +44,7 @@ private:
 	AlphaMode m_alphaMode = AlphaMode::MaskAlphaMode;
 	float m_alphaCutoff = 0.5f;
 
+	//Textures are owned by the TextureRegistry
 	VulkanImage* m_albedoTexture = nullptr;
 	VulkanImage* m_metallicRoughnessTexture = nullptr; //Metalness : B, Roughness : G
 	VulkanImage* m_normalTexture = nullptr;
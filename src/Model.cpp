@@ -5,10 +5,9 @@ desc: Manages model loading and drawing
 */
 
 #include "Model.h"
-#define TINYGLTF_NO_STB_IMAGE_WRITE
-#define TINYGLTF_IMPLEMENTATION
-#define TINYGLTF_USE_CPP14
-#include "tiny_gltf.h"
+#include "GltfTools.h"
+#include "TextureRegistry.h"
+#include "TextureTools.h"
 #include <future>
 #include <thread>
 
@@ -31,161 +30,69 @@ Model::~Model() {
 }
 
 
-//Proxy function used for multithreading
-static VulkanImage* newVulkanImage(VulkanContext* context, VulkanImageParams imageParams, VulkanImageViewParams imageViewParams, std::string path)
-{
-	return new VulkanImage(context, imageParams, imageViewParams, path);
-}
-
-static void createAlbedoTextureFromGltfMaterial(VulkanContext* context, RawMesh& texturedMesh, const tinygltf::Material& materialInfo, const tinygltf::Model& gltfModel, const std::filesystem::path& path)
-{
-	int gltfTextureId = materialInfo.pbrMetallicRoughness.baseColorTexture.index;
-	if (gltfTextureId == -1)
-		return;
-
-	std::string texturePath = gltfModel.images[gltfModel.textures[gltfTextureId].source].uri;
-	if (texturePath == "")texturePath = gltfModel.images[gltfModel.textures[gltfTextureId].source].name + ".png";
-	if (texturePath == "")
-		return;
+//Texture formats of the material slots
+static const vk::Format BAKED_TEXTURE_FORMATS[SerializationTools::BakedTextureSlotCount] = {
+	vk::Format::eR8G8B8A8Srgb, //Albedo
+	vk::Format::eR8G8B8A8Unorm, //Normal
+	vk::Format::eR8G8B8A8Unorm, //Metallic roughness
+	vk::Format::eR8G8B8A8Srgb, //Emissive
+};
 
-	if (texturePath != "")
+//Helper function to load baked material data into a TexturedMesh material data, if a material already exists, it will not be replaced
+//The textures are only requested to the TextureRegistry, they are set once every material of the model has queued its textures
+static void createMaterialFromBakedMaterial(VulkanContext* context, RawMesh& texturedMesh, const SerializationTools::BakedMaterial& bakedMaterial, const std::filesystem::path& path, std::array<std::shared_future<VulkanImage*>, SerializationTools::BakedTextureSlotCount>& outTextures){
+	if(texturedMesh.material == nullptr)
 	{
-		VulkanImageParams imageParams
-		{
-			.numSamples = vk::SampleCountFlagBits::e1,
-			.format = vk::Format::eR8G8B8A8Srgb,
-			.tiling = vk::ImageTiling::eOptimal,
-			.usage = vk::ImageUsageFlagBits::eSampled,
-		};
-		VulkanImageViewParams imageViewParams{
-			.aspectFlags = vk::ImageAspectFlagBits::eColor,
-		};
-
-		VulkanImage* image = newVulkanImage(context, imageParams, imageViewParams, path.string() + "/" + texturePath);
-		if (image->hasLoadingFailed())
-		{
-			delete image;
-			return;
-		}
-		texturedMesh.material->setAlbedoTexture(image);
-	}
-
-}
-
-static void createNormalTextureFromGltfMaterial(VulkanContext* context, RawMesh& texturedMesh, const tinygltf::Material& materialInfo, const tinygltf::Model& gltfModel, const std::filesystem::path& path)
-{
-	int gltfTextureId = materialInfo.normalTexture.index;
-	if (gltfTextureId == -1)
-		return;
-
-	std::string texturePath = gltfModel.images[gltfModel.textures[gltfTextureId].source].uri;
-	if (texturePath == "")texturePath = gltfModel.images[gltfModel.textures[gltfTextureId].source].name + ".png";
-	if (texturePath == "")
-		return;
+		std::filesystem::path parentPath = path.parent_path();
 
-	if (texturePath != "")
-	{
-		VulkanImageParams imageParams
+		texturedMesh.material = (new Material(context))
+			->setBaseColor(bakedMaterial.baseColorFactor)
+			->setMetallicFactor(bakedMaterial.metallicFactor)
+			->setEmissiveFactor(bakedMaterial.emissiveFactor)
+			->setRoughnessFactor(bakedMaterial.roughnessFactor);
+
+		//Opaque materials keep the Material default mode
+		texturedMesh.material->setAlphaCutoff(bakedMaterial.alphaCutoff);
+		if (bakedMaterial.alphaMode != OpaqueAlphaMode)
 		{
-			.numSamples = vk::SampleCountFlagBits::e1,
-			.format = vk::Format::eR8G8B8A8Unorm,
-			.tiling = vk::ImageTiling::eOptimal,
-			.usage = vk::ImageUsageFlagBits::eSampled,
-		};
-		VulkanImageViewParams imageViewParams{
-			.aspectFlags = vk::ImageAspectFlagBits::eColor,
-		};
-		
-		texturedMesh.material->setNormalTexture(newVulkanImage(context, imageParams, imageViewParams, path.string() + "/" + texturePath));
-	}
-}
-
-static void createMetallicRoughnessTexture(VulkanContext* context, RawMesh& texturedMesh, const tinygltf::Material& materialInfo, const tinygltf::Model& gltfModel, const std::filesystem::path& path)
-{
-	int gltfTextureId = materialInfo.pbrMetallicRoughness.metallicRoughnessTexture.index;
-	if (gltfTextureId == -1)
-		return;
-
-	std::string texturePath = gltfModel.images[gltfModel.textures[gltfTextureId].source].uri;
-	if (texturePath == "")texturePath = gltfModel.images[gltfModel.textures[gltfTextureId].source].name + ".png";
-	if (texturePath == "")
-		return;
+			texturedMesh.material->setAlphaMode(static_cast<AlphaMode>(bakedMaterial.alphaMode));
+		}
 
-	if (texturePath != "")
-	{
-		VulkanImageParams imageParams
+		for (uint32_t slot = 0; slot < SerializationTools::BakedTextureSlotCount; slot++)
 		{
-			.numSamples = vk::SampleCountFlagBits::e1,
-			.format = vk::Format::eR8G8B8A8Unorm,
-			.tiling = vk::ImageTiling::eOptimal,
-			.usage = vk::ImageUsageFlagBits::eSampled,
-		};
-		VulkanImageViewParams imageViewParams{
-			.aspectFlags = vk::ImageAspectFlagBits::eColor,
-		};
-		texturedMesh.material->setMetallicRoughnessTexture(newVulkanImage(context, imageParams, imageViewParams, path.string() + "/" + texturePath));
+			const SerializationTools::BakedTexture& texture = bakedMaterial.textures[slot];
+			if (texture.path[0] == '\0')
+				continue;
+
+			TextureRequest request{
+				.path = parentPath / texture.path,
+				.offset = texture.offset,
+				.size = texture.size,
+				.format = BAKED_TEXTURE_FORMATS[slot],
+			};
+			outTextures[slot] = TextureRegistry::requestTexture(context, request);
+		}
 	}
 
 }
 
-static void createEmissiveTexture(VulkanContext* context, RawMesh& texturedMesh, const tinygltf::Material& materialInfo, const tinygltf::Model& gltfModel, const std::filesystem::path& path)
+//Waits for the requested textures and gives them to the material, images that failed to load are skipped
+static void setMaterialTextures(Material* material, const std::array<std::shared_future<VulkanImage*>, SerializationTools::BakedTextureSlotCount>& textures)
 {
-	int gltfTextureId = materialInfo.emissiveTexture.index;
-	if (gltfTextureId == -1)
-		return;
-
-	std::string texturePath = gltfModel.images[gltfModel.textures[gltfTextureId].source].uri;
-	if (texturePath == "")texturePath = gltfModel.images[gltfModel.textures[gltfTextureId].source].name + ".png";
-	if (texturePath == "")
-		return;
-
-	if (texturePath != "")
+	for (uint32_t slot = 0; slot < SerializationTools::BakedTextureSlotCount; slot++)
 	{
-		VulkanImageParams imageParams
-		{
-			.numSamples = vk::SampleCountFlagBits::e1,
-			.format = vk::Format::eR8G8B8A8Srgb,
-			.tiling = vk::ImageTiling::eOptimal,
-			.usage = vk::ImageUsageFlagBits::eSampled,
-		};
-		VulkanImageViewParams imageViewParams{
-			.aspectFlags = vk::ImageAspectFlagBits::eColor,
-		};
-		texturedMesh.material->setEmissiveTexture(newVulkanImage(context, imageParams, imageViewParams, path.string() + "/" + texturePath));
-	}
+		VulkanImage* image = textures[slot].valid() ? textures[slot].get() : nullptr;
+		if (image == nullptr)
+			continue;
 
-}
-
-//Helper function to load gltf material data into a TexturedMesh material data, if a material already exists, it will not be replaced
-static void createMaterialFromGltf(VulkanContext* context, RawMesh& texturedMesh, const tinygltf::Material& materialInfo, const tinygltf::Model& gltfModel, const std::filesystem::path& path){
-	if(texturedMesh.material == nullptr)
-	{
-		std::filesystem::path parentPath = path.parent_path();
-		std::vector<std::future<VulkanImage*>> textureLoadFutures;
-
-		glm::vec4 baseColor = glm::vec4(materialInfo.pbrMetallicRoughness.baseColorFactor[0], materialInfo.pbrMetallicRoughness.baseColorFactor[1], materialInfo.pbrMetallicRoughness.baseColorFactor[2], materialInfo.pbrMetallicRoughness.baseColorFactor[3]);
-		glm::vec4 emissiveFactor = glm::vec4(materialInfo.emissiveFactor[0], materialInfo.emissiveFactor[1], materialInfo.emissiveFactor[2], 1.f);
-		texturedMesh.material = (new Material(context))
-			->setBaseColor(baseColor)
-			->setMetallicFactor(materialInfo.pbrMetallicRoughness.metallicFactor)
-			->setEmissiveFactor(emissiveFactor)
-			->setRoughnessFactor(materialInfo.pbrMetallicRoughness.roughnessFactor);
-
-		texturedMesh.material->setAlphaCutoff(materialInfo.alphaCutoff);
-		if (materialInfo.alphaMode == "MASK")
+		switch (slot)
 		{
-			texturedMesh.material->setAlphaMode(MaskAlphaMode);
-		}
-		else if (materialInfo.alphaMode == "BLEND") {
-			texturedMesh.material->setAlphaMode(TransparentAlphaMode);
+		case SerializationTools::BakedAlbedoTexture: material->setAlbedoTexture(image); break;
+		case SerializationTools::BakedNormalTexture: material->setNormalTexture(image); break;
+		case SerializationTools::BakedMetallicRoughnessTexture: material->setMetallicRoughnessTexture(image); break;
+		case SerializationTools::BakedEmissiveTexture: material->setEmissiveTexture(image); break;
 		}
-
-		createAlbedoTextureFromGltfMaterial(context, texturedMesh, materialInfo, gltfModel, parentPath);
-		createNormalTextureFromGltfMaterial(context, texturedMesh, materialInfo, gltfModel, parentPath);
-		createMetallicRoughnessTexture(context, texturedMesh, materialInfo, gltfModel, parentPath);
-		createEmissiveTexture(context, texturedMesh, materialInfo, gltfModel, parentPath);
 	}
-
 }
 
 //returns the model matrix (world space) of the model computed from transform data
@@ -207,29 +114,38 @@ void Model::drawModel(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipeli
 		commandBuffer.drawIndexed(mesh.loadingIndices.size(), 1, indexOffset, 0, 0);
 		indexOffset += mesh.loadingIndices.size();
 	}*/
-	uint32_t k = 0;
-	for (int i = 0; i < m_rawMeshes.size(); i++)
+	//Every instance draws its range of meshes, shared meshes are drawn once per node using them
+	const auto& bakedMeshes = m_bakedModel.meshes;
+	const glm::mat4 modelMatrix = m_transform.computeMatrix();
+	for (const auto& instance : m_bakedModel.instances)
 	{
-		pushConstant.model = m_transform.computeMatrix();
-		pushConstant.materialId = static_cast<glm::int32>(m_rawMeshes[i].materialId);
-		
-		if(m_meshes[i].meshlets.size() > 0)
+		pushConstant.model = modelMatrix * instance.transform;
+		for (uint32_t i = instance.firstMesh; i < instance.firstMesh + instance.meshCount; i++)
 		{
-			pushConstant.meshlet = m_meshes[i].meshlets[0].meshletInfo.meshletId;
-			pushConstant.meshletCount = m_meshes[i].meshlets.size();
-			commandBuffer.pushConstants<ModelPushConstant>(pipelineLayout, vk::ShaderStageFlagBits::eTaskEXT | vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eFragment, 0, pushConstant);
-			if(this->m_meshes.size() < 16 && i == 3){vkDrawMeshTasks(commandBuffer, m_meshes[i].meshlets.size(), 1, pushConstant.shellCount);} else{ vkDrawMeshTasks(commandBuffer, m_meshes[i].meshlets.size(), 1, 1);}
+			pushConstant.materialId = static_cast<glm::int32>(m_rawMeshes[bakedMeshes[i].materialIndex].materialId);
+
+			if(bakedMeshes[i].meshletCount > 0)
+			{
+				pushConstant.meshlet = m_firstMeshletId + bakedMeshes[i].firstMeshlet;
+				pushConstant.meshletCount = bakedMeshes[i].meshletCount;
+				commandBuffer.pushConstants<ModelPushConstant>(pipelineLayout, vk::ShaderStageFlagBits::eTaskEXT | vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eFragment, 0, pushConstant);
+				if(bakedMeshes.size() < 16 && i == 3){vkDrawMeshTasks(commandBuffer, bakedMeshes[i].meshletCount, 1, pushConstant.shellCount);} else{ vkDrawMeshTasks(commandBuffer, bakedMeshes[i].meshletCount, 1, 1);}
+			}
 		}
-			
-		k += m_meshes[i].meshlets.size();
 	}
 
 }
 
-//returns textured meshes dividing the model
-std::vector<Mesh>& Model::getMeshes()
+//returns the baked geometry of the model, mapped from baked_assets/
+const SerializationTools::BakedModel& Model::getBakedModel()
+{
+	return m_bakedModel;
+}
+
+//Set by the scene when the model meshlets are uploaded
+void Model::setFirstMeshletId(uint32_t firstMeshletId)
 {
-	return m_meshes;
+	m_firstMeshletId = firstMeshletId;
 }
 
 //returns textured meshes dividing the model
@@ -280,201 +196,72 @@ void Model::clearLoadingIndexData()
 	}
 }
 
-//Picks the right tinygltf function depending on the file format and manages errors
-static void loadGltfData(const std::filesystem::path& path, tinygltf::Model& gltfModel) {
-	bool ret = false;
-	tinygltf::TinyGLTF loader;
-	std::string err;
-	std::string warn;
-
-	std::filesystem::path ext = path.extension();
-	if (path.extension() == ".gltf")
-	{
-		ret = loader.LoadASCIIFromFile(&gltfModel, &err, &warn, path.string());
-	}
-	else if (path.extension() == ".glb")
-	{
-		ret = loader.LoadBinaryFromFile(&gltfModel, &err, &warn, path.string());
-	}
-	else {
-		std::runtime_error("Model format not supported");
-	}
-
-	if (!err.empty()) {
-		throw std::runtime_error(err);
-	}
-
-	if (!ret) {
-		throw std::runtime_error("Failed to parse glTf\n");
-	}
-
-}
-
-//Loads GLTF and GLB files
-void Model::loadGltf(const std::filesystem::path& path, bool isBaked)
+//Imports the geometry, the materials and the node instances of GLTF and GLB files, only needed when the model has to be baked
+void Model::loadGltf(const std::filesystem::path& path, std::vector<GltfTools::MeshGeometry>& outGeometries, SerializationTools::ModelDescription& outDescription)
 {
-	tinygltf::Model gltfModel;
-	loadGltfData(path, gltfModel);
-	
-	size_t materialCount = gltfModel.materials.size();
-	m_rawMeshes.resize(materialCount);
-
-	if (materialCount <= 0)
-	{
-		RawMesh texturedMesh;
-		m_rawMeshes.push_back(texturedMesh);
-	}
-
-	if (!isBaked)
-	{
-		for (const auto& mesh : gltfModel.meshes) 
-		{
-			for (const auto& attribute : mesh.primitives) 
-			{
-				int positionBufferIndex = attribute.attributes.at("POSITION");
-				int texCoordBufferIndex = attribute.attributes.at("TEXCOORD_0");
-				int normalBufferIndex = attribute.attributes.at("NORMAL");
-				int indicesBufferIndex = attribute.indices;
-
-				//Vertices
-				for (int i = 0; i < gltfModel.accessors[indicesBufferIndex].count; i++) {
-					int positionBufferOffset = gltfModel.accessors[positionBufferIndex].byteOffset + gltfModel.bufferViews[gltfModel.accessors[positionBufferIndex].bufferView].byteOffset;
-					int texCoordBufferOffset = gltfModel.accessors[texCoordBufferIndex].byteOffset + gltfModel.bufferViews[gltfModel.accessors[texCoordBufferIndex].bufferView].byteOffset;
-					int indicesBufferOffset = gltfModel.accessors[indicesBufferIndex].byteOffset + gltfModel.bufferViews[gltfModel.accessors[indicesBufferIndex].bufferView].byteOffset;
-					int normalBufferOffset = gltfModel.accessors[normalBufferIndex].byteOffset + gltfModel.bufferViews[gltfModel.accessors[normalBufferIndex].bufferView].byteOffset;
-
-					int positionBufferStride = gltfModel.bufferViews[gltfModel.accessors[positionBufferIndex].bufferView].byteStride;
-					int texCoordBufferStride = gltfModel.bufferViews[gltfModel.accessors[texCoordBufferIndex].bufferView].byteStride;
-					int normalBufferStride = gltfModel.bufferViews[gltfModel.accessors[normalBufferIndex].bufferView].byteStride;
-
-					if (positionBufferStride == 0)positionBufferStride = 4 * 3;
-					if (texCoordBufferStride == 0)texCoordBufferStride = 4 * 2;
-					if (normalBufferStride == 0)normalBufferStride = 4 * 3;
-
-					uint16_t index = *(uint16_t*)(&gltfModel.buffers[0].data[indicesBufferOffset + 2 * i]); //TODO better index type handling
-
-					Vertex vertex{};
-					if (positionBufferStride * index + 2 * 4 > gltfModel.bufferViews[gltfModel.accessors[positionBufferIndex].bufferView].byteLength)
-					{
-						std::cout << "position exceeded !" << std::endl;
-					}
-					vertex.pos = glm::vec3(*(float*)(&gltfModel.buffers[0].data[positionBufferOffset + positionBufferStride * index + 0 * 4]),
-						*(float*)(&gltfModel.buffers[0].data[positionBufferOffset + positionBufferStride * index + 1 * 4]),
-						*(float*)(&gltfModel.buffers[0].data[positionBufferOffset + positionBufferStride * index + 2 * 4]));
-
-					vertex.texCoord = {
-						*(float*)(&gltfModel.buffers[0].data[texCoordBufferOffset + texCoordBufferStride * index + 0 * 4]),
-						*(float*)(&gltfModel.buffers[0].data[texCoordBufferOffset + texCoordBufferStride * index + 1 * 4])
-					};
-
-					vertex.normal = {
-						*(float*)(&gltfModel.buffers[0].data[normalBufferOffset + normalBufferStride * index + 0 * 4]),
-						*(float*)(&gltfModel.buffers[0].data[normalBufferOffset + normalBufferStride * index + 1 * 4]),
-						*(float*)(&gltfModel.buffers[0].data[normalBufferOffset + normalBufferStride * index + 2 * 4])
-					};
-
-					int materialIndex = attribute.material;
-					if (materialCount <= 0)
-					{
-						materialIndex = 0;
-					}
-					m_rawMeshes[materialIndex].loadingVertices.push_back(vertex);
-					m_rawMeshes[materialIndex].loadingIndices.push_back(m_rawMeshes[materialIndex].loadingIndices.size());
-
-				}
-			}
-		}
-	}
-	
-	for (uint32_t materialIndex = 0; materialIndex < materialCount; materialIndex++)
+	GltfTools::GltfAsset gltfAsset;
+	//Images are compressed by TextureTools straight from their files or buffer ranges, tinygltf only reads the geometry
+	GltfTools::loadGltfData(path, gltfAsset, false);
+	outDescription.sourceFiles = GltfTools::listSourceFiles(path, gltfAsset);
+	GltfTools::importMaterials(path, gltfAsset, outDescription.materials);
+	TextureTools::TextureBakeStatistics textureStatistics = TextureTools::bakeMaterialTextures(path, outDescription.materials, outDescription.sourceFiles);
+	std::cout << "Compressed textures of " << path << ": " << textureStatistics.textureCount << " textures (" << textureStatistics.reusedCount << " reused, " << textureStatistics.failedCount << " left uncompressed), " << textureStatistics.uncompressedSize / 1024 << " -> " << textureStatistics.compressedSize / 1024 << " KiB in " << textureStatistics.seconds << "s" << std::endl;
+
+	GltfTools::ImportStatistics statistics = GltfTools::importGeometry(gltfAsset, outGeometries, outDescription.instances);
+	outDescription.meshMaterials.clear();
+	for (const auto& geometry : outGeometries)
 	{
-		createMaterialFromGltf(m_context, m_rawMeshes[materialIndex], gltfModel.materials[materialIndex], gltfModel, path);
+		outDescription.meshMaterials.push_back(geometry.materialIndex);
 	}
-
-	if (!isBaked)
-		generateTangents();
-		
-
+	std::cout << "Welded " << path << ": " << statistics.importedVertexCount << " -> " << statistics.weldedVertexCount << " vertices (" << statistics.weldedVertexCount * sizeof(Vertex) / 1024 << " KiB vertex buffer), " << statistics.instanceCount << " shared mesh instances, " << statistics.generatedTangentCount << " generated tangents, accessors decoded at " << size_t(statistics.decodedBytes / 1e6 / std::max(statistics.decodeSeconds, 1e-6f)) << " MB/s" << std::endl;
 };
 
-//Calls the appropriate loading function depending on the file extension
+//Bakes the model if needed, then reads everything from the baked file: a warm start never parses the glTF
 void Model::loadModel(const std::filesystem::path& path) {
 	
 	const bool isBaked = SerializationTools::isModelBaked(path);
 
-	//Load GLTF
-	std::filesystem::path extension = path.extension();
-	if (extension == ".gltf" || extension == ".glb") {
-		loadGltf(path, isBaked);
-	}
-	else {
-		std::runtime_error("Only .gltf and .glb files are supported for 3D model loading/baking");
-	}
-
 	// Serialization has not been a success lol
 	if(!isBaked)
 	{
-		//Bake meshlets
-		for(RawMesh mesh: m_rawMeshes)
-		{
-			uint32_t maxPrimitives = 128;
-			uint32_t maxVertices = 128;
-
-			m_meshes.emplace_back();
-			if(mesh.loadingIndices.size() > 0)
-			{
-				GeometryTools::bakeMeshlets(maxPrimitives, maxVertices, mesh.loadingIndices.data(), mesh.loadingIndices.size(), mesh.loadingVertices, m_meshes.back().meshlets);
-				m_meshes.back().vertices = mesh.loadingVertices;
-				
-			}
+		//Fallback when the asset was not baked offline by pyrrha-bake or its sources changed, meshes with unchanged geometry are kept
+		std::filesystem::path extension = path.extension();
+		if (extension != ".gltf" && extension != ".glb") {
+			throw std::runtime_error("Only .gltf and .glb files are supported for 3D model loading/baking");
 		}
 
-		std::vector<std::jthread> writeBakedModelThreads;
-		writeBakedModelThreads.resize(m_meshes.size());
-	
-		SerializationTools::writeBakedModel(path, m_meshes);     
+		std::vector<GltfTools::MeshGeometry> geometries;
+		SerializationTools::ModelDescription description;
+		loadGltf(path, geometries, description);
 
-	}
-	else
-	{
-		SerializationTools::loadBakedModel(path, m_meshes);
-		std::cout << "Loaded Model: " << path << std::endl;
-	}	
-}
-
-//Used in a new thread by generateTangents to compute tangent data
-static void generateTangentData(RawMesh* texturedMesh) {
-	for (uint32_t i = 0; i < texturedMesh->loadingIndices.size(); i += 3)
-	{
-		uint32_t i0 = texturedMesh->loadingIndices[i + 0];
-		uint32_t i1 = texturedMesh->loadingIndices[i + 1];
-		uint32_t i2 = texturedMesh->loadingIndices[i + 2];
-
-		glm::vec3 edge1 = texturedMesh->loadingVertices[i1].pos - texturedMesh->loadingVertices[i0].pos;
-		glm::vec3 edge2 = texturedMesh->loadingVertices[i2].pos - texturedMesh->loadingVertices[i0].pos;
-
-		glm::vec2 deltaUV1 = texturedMesh->loadingVertices[i1].texCoord - texturedMesh->loadingVertices[i0].texCoord;
-		glm::vec2 deltaUV2 = texturedMesh->loadingVertices[i2].texCoord - texturedMesh->loadingVertices[i0].texCoord;
+		std::vector<GeometryTools::MeshletBakeInput> bakeInputs;
+		bakeInputs.reserve(geometries.size());
+		for(const auto& geometry: geometries)
+		{
+			bakeInputs.push_back({ geometry.indices.data(), static_cast<uint32_t>(geometry.indices.size()), &geometry.vertices });
+		}
 
-		float r = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV1.y * deltaUV2.x);
+		GeometryTools::BakeStatistics statistics = SerializationTools::bakeModel(path, bakeInputs, description);
+		std::cout << "Baked Model: " << path << " (" << statistics.triangleCount << " triangles in " << statistics.seconds << "s, " << size_t(statistics.triangleCount / std::max(statistics.seconds, 1e-6f)) << " triangles/s, " << statistics.meshletCount << " meshlets, " << statistics.lodMeshletCount << " with LODs, " << statistics.reusedMeshCount << " meshes reused)" << std::endl;
+	}
 
-		glm::vec3 tangent3 = (edge1 * deltaUV2.y - edge2 * deltaUV1.y) * r;
-		tangent3 = glm::normalize(tangent3);
-		float handedness = ((deltaUV1.y * deltaUV2.x - deltaUV2.y * deltaUV1.x) < 0.0f) ? -1.0f : 1.0f;
+	//Freshly baked or not, the geometry and the materials are always read from the mapped baked file
+	m_bakedModel = SerializationTools::mapBakedModel(path);
+	m_rawMeshes.resize(std::max<size_t>(m_bakedModel.materials.size(), 1));
 
-		glm::vec4 tangent4 = glm::vec4(tangent3, handedness);
-		texturedMesh->loadingVertices[i0].tangent = tangent4;
-		texturedMesh->loadingVertices[i1].tangent = tangent4;
-		texturedMesh->loadingVertices[i2].tangent = tangent4;
+	//Every texture of the model is queued before waiting on any, so that they are decoded concurrently
+	std::vector<std::array<std::shared_future<VulkanImage*>, SerializationTools::BakedTextureSlotCount>> materialTextures(m_bakedModel.materials.size());
+	for (size_t materialIndex = 0; materialIndex < m_bakedModel.materials.size(); materialIndex++)
+	{
+		createMaterialFromBakedMaterial(m_context, m_rawMeshes[materialIndex], m_bakedModel.materials[materialIndex], path, materialTextures[materialIndex]);
 	}
-}
-//Generates the tangent data in the Vertex struct
-void Model::generateTangents() {
-	std::vector<std::jthread> generateTangentDataThreads;
-	generateTangentDataThreads.resize(m_rawMeshes.size());
-	for (uint32_t i = 0; i < m_rawMeshes.size(); i++)
+	for (size_t materialIndex = 0; materialIndex < m_bakedModel.materials.size(); materialIndex++)
 	{
-		generateTangentDataThreads[i] = std::jthread(generateTangentData, &m_rawMeshes[i]);
+		setMaterialTextures(m_rawMeshes[materialIndex].material, materialTextures[materialIndex]);
 	}
-}
 
+	if (isBaked)
+	{
+		std::cout << "Loaded Model: " << path << " (" << m_bakedModel.meshlets.size() << " meshlets, " << m_bakedModel.vertexCount << " vertices, " << m_bakedModel.materials.size() << " materials, " << m_bakedModel.instances.size() << " instances)" << std::endl;
+	}
+}
\ No newline at end of file
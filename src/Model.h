@@ -7,6 +7,10 @@
 #include "SerializationTools.h"
 #include "GeometryTools.h"
 
+namespace GltfTools {
+	struct MeshGeometry;
+}
+
 struct ModelLoadingInfo {
 	std::filesystem::path path;
 	Transform transform;
@@ -25,23 +29,24 @@ struct RawMesh {
 class Model {
 private:
 	VulkanContext* m_context = nullptr;
-	std::vector<RawMesh> m_rawMeshes;
-	std::vector<Mesh> m_meshes;
+	std::vector<RawMesh> m_rawMeshes; //One per material
+	SerializationTools::BakedModel m_bakedModel;
+	uint32_t m_firstMeshletId = 0; //Position of the model meshlets in the scene meshlet buffer
 	Transform m_transform;
 
 	PFN_vkCmdDrawMeshTasksEXT vkDrawMeshTasks;
 
 
 	void loadModel(const std::filesystem::path& path);
-	void loadGltf(const std::filesystem::path& path, bool isBaked);
-	void generateTangents();
+	void loadGltf(const std::filesystem::path& path, std::vector<GltfTools::MeshGeometry>& outGeometries, SerializationTools::ModelDescription& outDescription);
 public:
 	Model(VulkanContext* context, const std::filesystem::path& path, const Transform& transform);
 	Model();
 	~Model();
 	[[nodiscard]]glm::mat4 getMatrix();
 	void drawModel(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout, uint32_t& indexOffset, ModelPushConstant& pushConstant);
-	[[nodiscard]]std::vector<Mesh>& getMeshes();
+	[[nodiscard]]const SerializationTools::BakedModel& getBakedModel();
+	void setFirstMeshletId(uint32_t firstMeshletId);
 	[[nodiscard]]std::vector<RawMesh>& getRawMeshes();
 
 	void translateBy(glm::vec3 translation);
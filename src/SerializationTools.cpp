@@ -1,158 +1,483 @@
 #include "SerializationTools.h"
+#include "CompressionTools.h"
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace SerializationTools{
 
-    bool isModelBaked(const std::filesystem::path& path)
+    std::filesystem::path bakedModelPath(const std::filesystem::path& path)
+    {
+        std::filesystem::path bakedPath = BAKED_ASSETS_PATH;
+        bakedPath += path;
+        return bakedPath;
+    }
+
+    uint64_t alignSection(uint64_t offset)
+    {
+        return (offset + BAKED_SECTION_ALIGNMENT - 1) & ~(BAKED_SECTION_ALIGNMENT - 1);
+    }
+
+    MappedFile::MappedFile(const std::filesystem::path& path)
     {
-        std::filesystem::path bakedModelPath = BAKED_ASSETS_PATH;
-        bakedModelPath += path;
-        if(std::filesystem::exists(bakedModelPath))
+#ifdef _WIN32
+        m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
         {
-            return true;
+            m_file = nullptr;
+            throw std::runtime_error("Failed to open " + path.string());
+        }
+
+        LARGE_INTEGER fileSize{};
+        GetFileSizeEx(m_file, &fileSize);
+        m_size = static_cast<size_t>(fileSize.QuadPart);
+        if (m_size == 0)
+            return;
+
+        m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping != nullptr)
+            m_data = static_cast<const std::byte*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (m_data == nullptr)
+        {
+            if (m_mapping != nullptr)
+                CloseHandle(m_mapping);
+            CloseHandle(m_file);
+            throw std::runtime_error("Failed to map " + path.string());
+        }
+#else
+        m_file = open(path.c_str(), O_RDONLY);
+        if (m_file < 0)
+            throw std::runtime_error("Failed to open " + path.string());
+
+        struct stat fileStat{};
+        fstat(m_file, &fileStat);
+        m_size = static_cast<size_t>(fileStat.st_size);
+        if (m_size == 0)
+            return;
+
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+        if (data == MAP_FAILED)
+        {
+            close(m_file);
+            throw std::runtime_error("Failed to map " + path.string());
         }
-        return false;
+        //The whole file is copied to staging memory right after mapping
+        madvise(data, m_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+        m_data = static_cast<const std::byte*>(data);
+#endif
+    }
+
+    MappedFile::~MappedFile()
+    {
+#ifdef _WIN32
+        if (m_data != nullptr)
+            UnmapViewOfFile(m_data);
+        if (m_mapping != nullptr)
+            CloseHandle(m_mapping);
+        if (m_file != nullptr)
+            CloseHandle(m_file);
+#else
+        if (m_data != nullptr)
+            munmap(const_cast<std::byte*>(m_data), m_size);
+        if (m_file >= 0)
+            close(m_file);
+#endif
+    }
+
+    const std::byte* MappedFile::data() const
+    {
+        return m_data;
+    }
+
+    size_t MappedFile::size() const
+    {
+        return m_size;
+    }
+
+    int64_t fileWriteTime(const std::filesystem::path& path)
+    {
+        return static_cast<int64_t>(std::filesystem::last_write_time(path).time_since_epoch().count());
+    }
+
+    uint64_t hashFile(const std::filesystem::path& path)
+    {
+        MappedFile file(path);
+        return GeometryTools::hashBytes(file.data(), file.size());
+    }
+
+    //Copies a null terminated path in a fixed size baked field
+    void setBakedPath(char (&bakedPath)[BAKED_PATH_LENGTH], const std::string& path)
+    {
+        if (path.size() >= BAKED_PATH_LENGTH)
+            throw std::runtime_error("Path too long to be stored in a baked model: " + path);
+        memset(bakedPath, 0, BAKED_PATH_LENGTH);
+        memcpy(bakedPath, path.data(), path.size());
+    }
 
+    BakedSource makeBakedSource(const std::filesystem::path& modelDirectory, const std::filesystem::path& sourceFile)
+    {
+        BakedSource source{};
+        setBakedPath(source.path, std::filesystem::relative(sourceFile, modelDirectory).generic_string());
+
+        source.size = std::filesystem::file_size(sourceFile);
+        source.writeTime = fileWriteTime(sourceFile);
+        source.hash = hashFile(sourceFile);
+        return source;
     }
 
-    void loadBakedModel(const std::filesystem::path& path, std::vector<Mesh>&meshes)
+    //Size and date first, the content hash is only computed for files touched since the bake
+    bool isSourceUnchanged(const std::filesystem::path& modelDirectory, const BakedSource& source)
     {
-    
-        std::filesystem::path bakedModelPath = BAKED_ASSETS_PATH;
-        bakedModelPath += path;
-        std::ifstream file(bakedModelPath, std::ios::binary);
+        std::filesystem::path sourceFile = modelDirectory / std::string(source.path, strnlen(source.path, sizeof(source.path)));
+        std::error_code error;
+        if (std::filesystem::file_size(sourceFile, error) != source.size || error)
+            return false;
+        if (fileWriteTime(sourceFile) == source.writeTime)
+            return true;
+        return hashFile(sourceFile) == source.hash;
+    }
 
-        if (!file.is_open()) {
-            // Handle file open error, e.g., throw an exception
-            throw std::runtime_error("Failed to open file for reading.");
+    bool isModelBaked(const std::filesystem::path& path)
+    {
+        if(!std::filesystem::exists(bakedModelPath(path)))
+        {
+            return false;
         }
 
-        // Read the number of meshes
-        uint32_t numMeshes;
-        file.read(reinterpret_cast<char*>(&numMeshes), sizeof(uint32_t));
+        //Files baked with an older layout, other parameters or from modified sources have to be baked again
+        try {
+            BakedModel model = mapBakedModel(path, false);
+            if (model.bakeParameters != GeometryTools::BakeParameters{} || model.sources.empty())
+                return false;
 
-        meshes.resize(numMeshes);
+            for (const BakedSource& source : model.sources)
+            {
+                if (!isSourceUnchanged(path.parent_path(), source))
+                    return false;
+            }
+            return true;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+
+    template <typename T>
+    std::span<const T> asSpan(std::span<const std::byte> bytes)
+    {
+        if (reinterpret_cast<uintptr_t>(bytes.data()) % alignof(T) != 0 || bytes.size() % sizeof(T) != 0)
+            throw std::runtime_error("Corrupted baked model section");
+        return std::span<const T>(reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T));
+    }
 
-        for (Mesh& mesh : meshes) {
-            // Read the size of vertices and meshlets
-            uint32_t numVertices, numMeshlets;
-            file.read(reinterpret_cast<char*>(&numVertices), sizeof(uint32_t));
-            file.read(reinterpret_cast<char*>(&numMeshlets), sizeof(uint32_t));
+    BakedModel mapBakedModel(const std::filesystem::path& path, bool decodeGeometry)
+    {
+        BakedModel model;
+        model.file = std::make_unique<MappedFile>(bakedModelPath(path));
+        const MappedFile& file = *model.file;
 
-            mesh.vertices.resize(numVertices);
-            mesh.meshlets.resize(numMeshlets);
+        if (file.size() < sizeof(BakedModelHeader))
+            throw std::runtime_error("Baked model is truncated.");
 
-            for (Meshlet& meshlet : mesh.meshlets) {
-                // Read the size of primitiveIndices and uniqueVertexIndices
-                uint32_t numPrimitives, numUniqueVertices;
-                file.read(reinterpret_cast<char*>(&numPrimitives), sizeof(uint32_t));
-                file.read(reinterpret_cast<char*>(&numUniqueVertices), sizeof(uint32_t));
+        BakedModelHeader& header = model.header;
+        memcpy(&header, file.data(), sizeof(BakedModelHeader));
+        if (header.magic != BAKED_MODEL_MAGIC || header.version != BAKED_MODEL_VERSION || header.sectionCount != BakedSectionCount) {
+            throw std::runtime_error("Baked model version mismatch.");
+        }
+        if (header.vertexStride != VERTEX_BUFFER_STRIDE || header.positionStride != POSITION_BUFFER_STRIDE || header.fileSize != file.size()) {
+            throw std::runtime_error("Baked model layout mismatch.");
+        }
 
-                meshlet.primitiveIndices.resize(numPrimitives);
-                meshlet.uniqueVertexIndices.resize(numUniqueVertices);
+        //Encoded sections are decoded in a single allocation, keeping the section alignment
+        uint64_t decodedSize = 0;
+        for (const BakedSection& section : header.sections)
+        {
+            if (section.offset + section.storedSize > file.size())
+                throw std::runtime_error("Corrupted baked model section");
+            if (section.encoding == BakedCodecEncoding)
+                decodedSize = alignSection(decodedSize) + section.size;
+        }
+        if (decodeGeometry && decodedSize > 0)
+            model.decodedSections = std::make_unique_for_overwrite<std::byte[]>(decodedSize + BAKED_SECTION_ALIGNMENT);
+
+        std::span<const std::byte> sections[BakedSectionCount];
+        std::byte* decoded = model.decodedSections.get();
+        if (decoded != nullptr)
+            decoded += alignSection(reinterpret_cast<uintptr_t>(decoded)) - reinterpret_cast<uintptr_t>(decoded);
+        for (uint32_t i = 0; i < BakedSectionCount; i++)
+        {
+            const BakedSection& section = header.sections[i];
+            if (section.encoding == BakedRawEncoding)
+            {
+                if (section.size != section.storedSize)
+                    throw std::runtime_error("Corrupted baked model section");
+                sections[i] = std::span<const std::byte>(file.data() + section.offset, section.size);
             }
+            else if (decodeGeometry)
+            {
+                CompressionTools::decode(file.data() + section.offset, section.storedSize, decoded, section.size);
+                sections[i] = std::span<const std::byte>(decoded, section.size);
+                decoded += alignSection(section.size);
+            }
+        }
+
+        model.sources = asSpan<BakedSource>(sections[BakedSourcesSection]);
+        model.meshes = asSpan<BakedMesh>(sections[BakedMeshesSection]);
+        model.materials = asSpan<BakedMaterial>(sections[BakedMaterialsSection]);
+        model.instances = asSpan<BakedInstance>(sections[BakedInstancesSection]);
+        model.meshlets = asSpan<MeshletIndexingInfo>(sections[BakedMeshletsSection]);
+        model.triangles = asSpan<Meshlet::Triangle>(sections[BakedTrianglesSection]);
+        model.indices = asSpan<uint32_t>(sections[BakedIndicesSection]);
+        model.vertices = sections[BakedVerticesSection];
+        model.positions = sections[BakedPositionsSection];
+        model.vertexCount = static_cast<uint32_t>(header.sections[BakedVerticesSection].size / VERTEX_BUFFER_STRIDE);
+        model.bakeParameters = header.bakeParameters;
+
+        if (model.meshes.size() != header.meshCount || header.sections[BakedPositionsSection].size != size_t(model.vertexCount) * POSITION_BUFFER_STRIDE)
+            throw std::runtime_error("Corrupted baked model.");
+        for (const BakedInstance& instance : model.instances)
+        {
+            if (size_t(instance.firstMesh) + instance.meshCount > model.meshes.size())
+                throw std::runtime_error("Corrupted baked model instance.");
         }
+        for (const BakedMesh& bakedMesh : model.meshes)
+        {
+            if (bakedMesh.materialIndex >= std::max<size_t>(model.materials.size(), 1))
+                throw std::runtime_error("Corrupted baked model mesh material.");
+        }
+
+        return model;
+    }
+
+    void writeBakedModel(const std::filesystem::path& path, const std::vector<Mesh>& meshes, const std::vector<uint64_t>& meshInputHashes, const ModelDescription& description, const GeometryTools::BakeParameters& parameters)
+    {
+        assert(meshInputHashes.size() == meshes.size() && description.meshMaterials.size() == meshes.size());
+
+        std::vector<BakedSource> sources;
+        for (const std::filesystem::path& sourceFile : description.sourceFiles)
+            sources.push_back(makeBakedSource(path.parent_path(), sourceFile));
 
-        for (Mesh& mesh : meshes) {
-            for (Vertex& v : mesh.vertices) {
-                // Read vertex data
-                file.read(reinterpret_cast<char*>(&v.pos.x), sizeof(float));
-                file.read(reinterpret_cast<char*>(&v.pos.y), sizeof(float));
-                file.read(reinterpret_cast<char*>(&v.pos.z), sizeof(float));
-                file.read(reinterpret_cast<char*>(&v.normal.x), sizeof(float));
-                file.read(reinterpret_cast<char*>(&v.normal.y), sizeof(float));
-                file.read(reinterpret_cast<char*>(&v.normal.z), sizeof(float));
-                file.read(reinterpret_cast<char*>(&v.texCoord.x), sizeof(float));
-                file.read(reinterpret_cast<char*>(&v.texCoord.y), sizeof(float));
-                file.read(reinterpret_cast<char*>(&v.tangent.x), sizeof(float));
-                file.read(reinterpret_cast<char*>(&v.tangent.y), sizeof(float));
-                file.read(reinterpret_cast<char*>(&v.tangent.z), sizeof(float));
-                file.read(reinterpret_cast<char*>(&v.tangent.w), sizeof(float));
+        std::vector<BakedMesh> bakedMeshes;
+        std::vector<MeshletIndexingInfo> meshletInfos;
+        std::vector<Meshlet::Triangle> triangles;
+        std::vector<uint32_t> indices;
+        std::vector<Vertex> vertices;
+        std::vector<QuantizedVertex> quantizedVertices;
+        std::vector<QuantizedPosition> quantizedPositions;
+        std::vector<glm::vec4> positions;
+
+        //Flattens the meshes in the layouts of the scene buffers, only the model offsets are added when uploading
+        for (const Mesh& mesh : meshes)
+        {
+            BakedMesh bakedMesh{};
+            bakedMesh.meshInfo = GeometryTools::computeQuantizationBounds(mesh.vertices);
+            bakedMesh.firstMeshlet = static_cast<uint32_t>(meshletInfos.size());
+            bakedMesh.meshletCount = static_cast<uint32_t>(mesh.meshlets.size());
+            bakedMesh.firstVertex = static_cast<uint32_t>(vertices.size() + quantizedVertices.size());
+            bakedMesh.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+            bakedMesh.inputHash = meshInputHashes[bakedMeshes.size()];
+            bakedMesh.materialIndex = description.meshMaterials[bakedMeshes.size()];
+
+            for (const Meshlet& meshlet : mesh.meshlets)
+            {
+                MeshletIndexingInfo meshletInfo = meshlet.meshletInfo;
+                meshletInfo.vertexCount = static_cast<uint32_t>(meshlet.uniqueVertexIndices.size());
+                meshletInfo.vertexOffset = static_cast<uint32_t>(indices.size());
+                meshletInfo.primitiveCount = static_cast<uint32_t>(meshlet.primitiveIndices.size());
+                meshletInfo.primitiveOffset = static_cast<uint32_t>(triangles.size());
+                meshletInfo.meshletId = static_cast<uint32_t>(meshletInfos.size());
+                meshletInfo.meshId = static_cast<uint32_t>(bakedMeshes.size());
+                meshletInfos.push_back(meshletInfo);
+
+                triangles.insert(triangles.end(), meshlet.primitiveIndices.begin(), meshlet.primitiveIndices.end());
+                for (uint32_t index : meshlet.uniqueVertexIndices)
+                    indices.push_back(bakedMesh.firstVertex + index);
             }
 
-            for (Meshlet& m : mesh.meshlets) {
-                for (Meshlet::Triangle& p : m.primitiveIndices) {
-                    // Read primitiveIndices data
-                    file.read(reinterpret_cast<char*>(&p.i0), sizeof(uint32_t));
-                    file.read(reinterpret_cast<char*>(&p.i1), sizeof(uint32_t));
-                    file.read(reinterpret_cast<char*>(&p.i2), sizeof(uint32_t));
+            if (ENABLE_VERTEX_QUANTIZATION)
+            {
+                std::vector<QuantizedVertex> meshQuantizedVertices;
+                meshQuantizedVertices.reserve(mesh.vertices.size());
+                for (const Vertex& vertex : mesh.vertices)
+                {
+                    QuantizedVertex quantized = GeometryTools::quantizeVertex(vertex, bakedMesh.meshInfo);
+                    meshQuantizedVertices.push_back(quantized);
+                    quantizedPositions.push_back({ .pos = {quantized.pos[0], quantized.pos[1], quantized.pos[2]} });
                 }
 
-                for (uint32_t& i : m.uniqueVertexIndices) {
-                    // Read uniqueVertexIndices data
-                    file.read(reinterpret_cast<char*>(&i), sizeof(uint32_t));
+                //Tolerance check against the float vertices, done once at bake time
+                GeometryTools::QuantizationError error = GeometryTools::measureQuantizationError(mesh.vertices, meshQuantizedVertices, bakedMesh.meshInfo);
+                if (!GeometryTools::isWithinQuantizationTolerance(error))
+                {
+                    std::cout << "Vertex quantization above tolerance for " << path << " mesh " << bakedMeshes.size() << ": position " << error.position << ", uv " << error.texCoord << ", normal " << error.normal << " deg, tangent " << error.tangent << " deg, handedness mismatches " << error.handednessMismatches << std::endl;
                 }
+                quantizedVertices.insert(quantizedVertices.end(), meshQuantizedVertices.begin(), meshQuantizedVertices.end());
             }
+            else
+            {
+                vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+                std::transform(mesh.vertices.begin(), mesh.vertices.end(), std::back_inserter(positions), [](const Vertex& vertex){return glm::vec4(vertex.pos, 1.0f);});
+            }
+
+            bakedMeshes.push_back(bakedMesh);
         }
 
-    }
+        const void* sectionData[BakedSectionCount] = {};
+        BakedModelHeader header{};
+        header.vertexStride = static_cast<uint32_t>(VERTEX_BUFFER_STRIDE);
+        header.positionStride = static_cast<uint32_t>(POSITION_BUFFER_STRIDE);
+        header.meshCount = static_cast<uint32_t>(bakedMeshes.size());
+        header.bakeParameters = parameters;
 
-    void writeBakedModel(const std::filesystem::path& path, std::vector<Mesh>& meshes)
-    {
-        std::filesystem::path bakedModelPath = BAKED_ASSETS_PATH;
-        bakedModelPath += path;
-        std::filesystem::create_directories(bakedModelPath.parent_path());
-        std::ofstream file(bakedModelPath, std::ios::binary);
-
-        /*
-        MESHES COUNT
-            MESH 0 VERTICES COUNT
-            MESH 0 MESHLETS COUNT
-                MESHLET 0 TRIANGLE COUNT
-                MESHLET 0 INDEX COUNT
-                MESHLET 0 BOUNDING SPHERE
-            MESH 1 VERTICES COUNT
-            ....
-        */
-        uint32_t numMeshes = meshes.size();
-        file.write(reinterpret_cast<char*>(&numMeshes), sizeof(uint32_t));
-
-    for (const Mesh& mesh : meshes) {
-        // Write the size of vertices and meshlets
-        uint32_t numVertices = mesh.vertices.size();
-        uint32_t numMeshlets = mesh.meshlets.size();
-        file.write(reinterpret_cast<char*>(&numVertices), sizeof(uint32_t));
-        file.write(reinterpret_cast<char*>(&numMeshlets), sizeof(uint32_t));
-
-        for (const Meshlet& meshlet : mesh.meshlets) {
-            // Write the size of primitiveIndices and uniqueVertexIndices
-            uint32_t numPrimitives = meshlet.primitiveIndices.size();
-            uint32_t numUniqueVertices = meshlet.uniqueVertexIndices.size();
-            file.write(reinterpret_cast<char*>(&numPrimitives), sizeof(uint32_t));
-            file.write(reinterpret_cast<char*>(&numUniqueVertices), sizeof(uint32_t));
-        }
-    }
-
-    for ( Mesh& mesh : meshes) {
-        for ( Vertex& v : mesh.vertices) {
-            // Write vertex data
-            file.write(reinterpret_cast<char*>(&v.pos.x), sizeof(float));
-            file.write(reinterpret_cast<char*>(&v.pos.y), sizeof(float));
-            file.write(reinterpret_cast<char*>(&v.pos.z), sizeof(float));
-            file.write(reinterpret_cast<char*>(&v.normal.x), sizeof(float));
-            file.write(reinterpret_cast<char*>(&v.normal.y), sizeof(float));
-            file.write(reinterpret_cast<char*>(&v.normal.z), sizeof(float));
-            file.write(reinterpret_cast<char*>(&v.texCoord.x), sizeof(float));
-            file.write(reinterpret_cast<char*>(&v.texCoord.y), sizeof(float));
-            file.write(reinterpret_cast<char*>(&v.tangent.x), sizeof(float));
-            file.write(reinterpret_cast<char*>(&v.tangent.y), sizeof(float));
-            file.write(reinterpret_cast<char*>(&v.tangent.z), sizeof(float));
-            file.write(reinterpret_cast<char*>(&v.tangent.w), sizeof(float));
-        }
-
-        for ( Meshlet& m : mesh.meshlets) {
-            for ( Meshlet::Triangle& p : m.primitiveIndices) {
-                // Write primitiveIndices data
-                file.write(reinterpret_cast<char*>(&p.i0), sizeof(uint32_t));
-                file.write(reinterpret_cast<char*>(&p.i1), sizeof(uint32_t));
-                file.write(reinterpret_cast<char*>(&p.i2), sizeof(uint32_t));
+        //laneSize 0 keeps a section raw, otherwise it is the width of the delta coded integers (see CompressionTools)
+        std::vector<std::byte> encodedSections[BakedSectionCount];
+        auto setSection = [&](BakedSectionId id, const void* data, uint64_t size, uint32_t elementSize, uint32_t laneSize){
+            sectionData[id] = data;
+            header.sections[id].size = size;
+            header.sections[id].storedSize = size;
+            if (!ENABLE_BAKED_MODEL_COMPRESSION || laneSize == 0 || size == 0)
+                return;
+
+            CompressionTools::encode(data, size, elementSize, laneSize, encodedSections[id]);
+            if (encodedSections[id].size() < size)
+            {
+                sectionData[id] = encodedSections[id].data();
+                header.sections[id].storedSize = encodedSections[id].size();
+                header.sections[id].encoding = BakedCodecEncoding;
             }
+        };
+        setSection(BakedSourcesSection, sources.data(), sources.size() * sizeof(BakedSource), sizeof(BakedSource), 0);
+        setSection(BakedMeshesSection, bakedMeshes.data(), bakedMeshes.size() * sizeof(BakedMesh), sizeof(BakedMesh), 0);
+        setSection(BakedMaterialsSection, description.materials.data(), description.materials.size() * sizeof(BakedMaterial), sizeof(BakedMaterial), 0);
+        setSection(BakedInstancesSection, description.instances.data(), description.instances.size() * sizeof(BakedInstance), sizeof(BakedInstance), 0);
+        setSection(BakedMeshletsSection, meshletInfos.data(), meshletInfos.size() * sizeof(MeshletIndexingInfo), sizeof(MeshletIndexingInfo), 4);
+        setSection(BakedTrianglesSection, triangles.data(), triangles.size() * sizeof(Meshlet::Triangle), sizeof(Meshlet::Triangle), 1);
+        setSection(BakedIndicesSection, indices.data(), indices.size() * sizeof(uint32_t), sizeof(uint32_t), 4);
+        if (ENABLE_VERTEX_QUANTIZATION)
+        {
+            setSection(BakedVerticesSection, quantizedVertices.data(), quantizedVertices.size() * sizeof(QuantizedVertex), sizeof(QuantizedVertex), 2);
+            setSection(BakedPositionsSection, quantizedPositions.data(), quantizedPositions.size() * sizeof(QuantizedPosition), sizeof(QuantizedPosition), 2);
+        }
+        else
+        {
+            setSection(BakedVerticesSection, vertices.data(), vertices.size() * sizeof(Vertex), sizeof(Vertex), 4);
+            setSection(BakedPositionsSection, positions.data(), positions.size() * sizeof(glm::vec4), sizeof(glm::vec4), 4);
+        }
 
-            for (uint32_t i : m.uniqueVertexIndices) {
-                // Write uniqueVertexIndices data
-                file.write(reinterpret_cast<char*>(&i), sizeof(uint32_t));
+        uint64_t offset = sizeof(BakedModelHeader);
+        for (BakedSection& section : header.sections)
+        {
+            section.offset = alignSection(offset);
+            offset = section.offset + section.storedSize;
+        }
+        header.fileSize = offset;
+
+        //Written next to the final file and renamed, a crash or a concurrent reader never sees a partial model
+        std::filesystem::path bakedPath = bakedModelPath(path);
+        std::filesystem::path temporaryPath = bakedPath;
+        temporaryPath += ".tmp";
+        std::filesystem::create_directories(bakedPath.parent_path());
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+                throw std::runtime_error("Failed to open " + temporaryPath.string() + " for writing.");
+
+            file.write(reinterpret_cast<const char*>(&header), sizeof(BakedModelHeader));
+            uint64_t written = sizeof(BakedModelHeader);
+            const char padding[BAKED_SECTION_ALIGNMENT] = {};
+            for (uint32_t i = 0; i < BakedSectionCount; i++)
+            {
+                file.write(padding, header.sections[i].offset - written);
+                file.write(static_cast<const char*>(sectionData[i]), header.sections[i].storedSize);
+                written = header.sections[i].offset + header.sections[i].storedSize;
             }
+
+            if (!file.good())
+                throw std::runtime_error("Failed to write " + temporaryPath.string());
+        }
+        std::filesystem::rename(temporaryPath, bakedPath);
+    }
+
+    //Rebuilds the meshlets of a previously baked mesh, the vertices are the (identical) input ones since the file may only hold quantized vertices
+    void unpackBakedMesh(const BakedModel& model, const BakedMesh& bakedMesh, const std::vector<Vertex>& vertices, Mesh& outMesh)
+    {
+        outMesh.vertices = vertices;
+        outMesh.meshlets.resize(bakedMesh.meshletCount);
+        for (uint32_t i = 0; i < bakedMesh.meshletCount; i++)
+        {
+            const MeshletIndexingInfo& meshletInfo = model.meshlets[bakedMesh.firstMeshlet + i];
+            Meshlet& meshlet = outMesh.meshlets[i];
+            meshlet.meshletInfo = meshletInfo;
+
+            auto triangles = model.triangles.subspan(meshletInfo.primitiveOffset, meshletInfo.primitiveCount);
+            meshlet.primitiveIndices.assign(triangles.begin(), triangles.end());
+
+            auto indices = model.indices.subspan(meshletInfo.vertexOffset, meshletInfo.vertexCount);
+            meshlet.uniqueVertexIndices.resize(indices.size());
+            std::transform(indices.begin(), indices.end(), meshlet.uniqueVertexIndices.begin(), [&bakedMesh](uint32_t index){return index - bakedMesh.firstVertex;});
         }
     }
-        file.close();
-    }    
-}
\ No newline at end of file
+
+    //Bakes and writes a model, the meshes of an existing bake made with the same parameters are kept when their geometry did not change
+    GeometryTools::BakeStatistics bakeModel(const std::filesystem::path& path, const std::vector<GeometryTools::MeshletBakeInput>& meshes, const ModelDescription& description, const GeometryTools::BakeParameters& parameters, uint32_t threadCount)
+    {
+        std::vector<uint64_t> meshInputHashes(meshes.size());
+        GeometryTools::runParallel(static_cast<uint32_t>(meshes.size()), threadCount, [&](uint32_t i){
+            meshInputHashes[i] = GeometryTools::hashMeshInput(meshes[i]);
+        });
+
+        std::vector<Mesh> bakedMeshes(meshes.size());
+        std::vector<GeometryTools::MeshletBakeInput> bakeInputs = meshes;
+        size_t reusedMeshCount = 0;
+
+        //The previous file is released before being replaced
+        try {
+            BakedModel previousModel = mapBakedModel(path);
+            if (previousModel.bakeParameters == parameters)
+            {
+                std::unordered_map<uint64_t, const BakedMesh*> previousMeshes;
+                for (const BakedMesh& bakedMesh : previousModel.meshes)
+                    previousMeshes.emplace(bakedMesh.inputHash, &bakedMesh);
+
+                for (size_t i = 0; i < meshes.size(); i++)
+                {
+                    auto previousMesh = previousMeshes.find(meshInputHashes[i]);
+                    if (meshes[i].indexCount == 0 || previousMesh == previousMeshes.end() || previousMesh->second->vertexCount != meshes[i].vertices->size())
+                        continue;
+
+                    unpackBakedMesh(previousModel, *previousMesh->second, *meshes[i].vertices, bakedMeshes[i]);
+                    bakeInputs[i].indexCount = 0;
+                    reusedMeshCount++;
+                }
+            }
+        }
+        catch (const std::exception&)
+        {
+            //No usable previous bake, everything is baked
+        }
+
+        std::vector<Mesh> newMeshes;
+        GeometryTools::BakeStatistics statistics = GeometryTools::bakeMeshes(parameters.maxPrimitives, parameters.maxVertices, bakeInputs, newMeshes, threadCount);
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            if (bakeInputs[i].indexCount > 0)
+                bakedMeshes[i] = std::move(newMeshes[i]);
+        }
+        statistics.reusedMeshCount = reusedMeshCount;
+
+        writeBakedModel(path, bakedMeshes, meshInputHashes, description, parameters);
+        return statistics;
+    }
+}
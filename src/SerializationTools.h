@@ -1,11 +1,175 @@
+#pragma once
 #include "Defs.h"
 #include "GeometryTools.h"
 #include <fstream>
+#include <memory>
+#include <span>
 
 
 namespace SerializationTools {
 
+    /*
+    Baked model file, every array is stored in the layout of the scene geometry buffers so it can be copied to staging memory as is
+    HEADER (magic, version, vertex streams strides, bake parameters, section table)
+    SECTIONS, each aligned to BAKED_SECTION_ALIGNMENT, raw or encoded with CompressionTools (ENABLE_BAKED_MODEL_COMPRESSION)
+        SOURCES     BakedSource[], files the model was baked from
+        MESHES      BakedMesh[meshCount]
+        MATERIALS   BakedMaterial[], parameters and texture references of the glTF materials
+        INSTANCES   BakedInstance[], meshes drawn with their transform relative to the model
+        MESHLETS    MeshletIndexingInfo[], offsets, meshletId and meshId are local to the model
+        TRIANGLES   Meshlet::Triangle[]
+        INDICES     uint32_t[], vertex indices local to the model
+        VERTICES    QuantizedVertex[] or Vertex[] (VERTEX_BUFFER_STRIDE)
+        POSITIONS   QuantizedPosition[] or vec4[] (POSITION_BUFFER_STRIDE)
+    */
+    constexpr uint32_t BAKED_MODEL_MAGIC = 0x42525950; //"PYRB"
+    constexpr uint64_t BAKED_SECTION_ALIGNMENT = 64;
+    constexpr size_t BAKED_PATH_LENGTH = 232;
+
+    enum BakedSectionId {
+        BakedSourcesSection,
+        BakedMeshesSection,
+        BakedMaterialsSection,
+        BakedInstancesSection,
+        BakedMeshletsSection,
+        BakedTrianglesSection,
+        BakedIndicesSection,
+        BakedVerticesSection,
+        BakedPositionsSection,
+        BakedSectionCount
+    };
+
+    enum BakedSectionEncoding : uint32_t {
+        BakedRawEncoding, //Mapped as is
+        BakedCodecEncoding, //Decoded at load time
+    };
+
+    struct BakedSection {
+        uint64_t offset = 0; //From the start of the file
+        uint64_t size = 0; //Decoded bytes
+        uint64_t storedSize = 0; //Bytes in the file
+        uint32_t encoding = BakedRawEncoding;
+        uint32_t padding = 0;
+    };
+
+    struct BakedModelHeader {
+        uint32_t magic = BAKED_MODEL_MAGIC;
+        uint32_t version = BAKED_MODEL_VERSION;
+        uint32_t vertexStride = 0;
+        uint32_t positionStride = 0;
+        uint32_t meshCount = 0;
+        uint32_t sectionCount = BakedSectionCount;
+        uint64_t fileSize = 0;
+        GeometryTools::BakeParameters bakeParameters;
+        uint32_t padding = 0;
+        BakedSection sections[BakedSectionCount];
+    };
+
+    //Source file of a baked model, a bake is stale as soon as one of them changes
+    struct BakedSource {
+        char path[BAKED_PATH_LENGTH] = {}; //Relative to the model directory, null terminated
+        uint64_t size = 0;
+        int64_t writeTime = 0; //Skips hashing when the file was not touched since the bake
+        uint64_t hash = 0;
+    };
+
+    //Ranges of a mesh inside the model arrays
+    struct BakedMesh {
+        MeshInfo meshInfo;
+        uint32_t firstMeshlet = 0;
+        uint32_t meshletCount = 0;
+        uint32_t firstVertex = 0;
+        uint32_t vertexCount = 0;
+        uint64_t inputHash = 0; //GeometryTools::hashMeshInput of the mesh geometry, unchanged meshes are not baked again
+        uint32_t materialIndex = 0;
+        uint32_t padding = 0;
+    };
+
+    //Placement of a range of meshes, meshes shared by several glTF nodes are stored once and drawn by several instances
+    struct BakedInstance {
+        glm::mat4 transform = glm::mat4(1.f);
+        uint32_t firstMesh = 0;
+        uint32_t meshCount = 0;
+        uint32_t padding[2] = {};
+    };
+
+    enum BakedTextureSlot {
+        BakedAlbedoTexture,
+        BakedNormalTexture,
+        BakedMetallicRoughnessTexture,
+        BakedEmissiveTexture,
+        BakedTextureSlotCount
+    };
+
+    //Encoded image (png, jpg...) of a texture, either a whole file or a range of a glTF buffer for embedded images
+    struct BakedTexture {
+        char path[BAKED_PATH_LENGTH] = {}; //Relative to the model directory, empty when the slot has no texture
+        uint64_t offset = 0;
+        uint64_t size = 0; //0 for the whole file
+    };
+
+    //glTF material, enough to create the Material of a mesh without parsing the glTF again
+    struct BakedMaterial {
+        glm::vec4 baseColorFactor = glm::vec4(1.f);
+        glm::vec4 emissiveFactor = glm::vec4(0.f, 0.f, 0.f, 1.f);
+        float metallicFactor = 1.f;
+        float roughnessFactor = 1.f;
+        float alphaCutoff = 0.5f;
+        uint32_t alphaMode = OpaqueAlphaMode;
+        BakedTexture textures[BakedTextureSlotCount];
+    };
+
+    void setBakedPath(char (&bakedPath)[BAKED_PATH_LENGTH], const std::string& path);
+
+    //Everything a baked model stores besides the geometry
+    struct ModelDescription {
+        std::vector<std::filesystem::path> sourceFiles;
+        std::vector<BakedMaterial> materials;
+        std::vector<uint32_t> meshMaterials; //Material of each mesh
+        std::vector<BakedInstance> instances;
+    };
+
+    //Read only memory mapping of a whole file
+    class MappedFile {
+    private:
+        const std::byte* m_data = nullptr;
+        size_t m_size = 0;
+#ifdef _WIN32
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+#else
+        int m_file = -1;
+#endif
+    public:
+        MappedFile(const std::filesystem::path& path);
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        [[nodiscard]]const std::byte* data() const;
+        [[nodiscard]]size_t size() const;
+    };
+
+    //Baked model mapped in memory, the spans point straight into the file (or into the decoded copy of the encoded sections) and stay valid as long as the BakedModel lives
+    struct BakedModel {
+        std::unique_ptr<MappedFile> file;
+        std::unique_ptr<std::byte[]> decodedSections;
+        BakedModelHeader header;
+        std::span<const BakedSource> sources;
+        std::span<const BakedMesh> meshes;
+        std::span<const BakedMaterial> materials;
+        std::span<const BakedInstance> instances;
+        std::span<const MeshletIndexingInfo> meshlets;
+        std::span<const Meshlet::Triangle> triangles;
+        std::span<const uint32_t> indices;
+        std::span<const std::byte> vertices; //VERTEX_BUFFER_STRIDE per vertex
+        std::span<const std::byte> positions; //POSITION_BUFFER_STRIDE per vertex
+        uint32_t vertexCount = 0;
+        GeometryTools::BakeParameters bakeParameters;
+    };
+
+    [[nodiscard]]std::filesystem::path bakedModelPath(const std::filesystem::path& path);
     [[nodiscard]]bool isModelBaked(const std::filesystem::path& path);
-    void writeBakedModel(const std::filesystem::path& path, std::vector<Mesh>& meshes);
-    void loadBakedModel(const std::filesystem::path& path, std::vector<Mesh>& meshes);
-}
\ No newline at end of file
+    void writeBakedModel(const std::filesystem::path& path, const std::vector<Mesh>& meshes, const std::vector<uint64_t>& meshInputHashes, const ModelDescription& description, const GeometryTools::BakeParameters& parameters);
+    GeometryTools::BakeStatistics bakeModel(const std::filesystem::path& path, const std::vector<GeometryTools::MeshletBakeInput>& meshes, const ModelDescription& description, const GeometryTools::BakeParameters& parameters = {}, uint32_t threadCount = 0);
+    [[nodiscard]]BakedModel mapBakedModel(const std::filesystem::path& path, bool decodeGeometry = true);
+}
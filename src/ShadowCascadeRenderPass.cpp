@@ -87,7 +87,7 @@ void ShadowCascadeRenderPass::createDescriptorSetLayout()
         .binding = 0,
         .descriptorType = vk::DescriptorType::eUniformBuffer,
         .descriptorCount = 1,
-        .stageFlags = vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eFragment,
+        .stageFlags = vk::ShaderStageFlagBits::eTaskEXT | vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eFragment,
     };
 
 
@@ -249,7 +249,8 @@ void ShadowCascadeRenderPass::drawRenderPass(vk::CommandBuffer commandBuffer, ui
         renderPassInfo.framebuffer = m_framebuffers[i];
 
         ModelPushConstant pushConstant{
-            .cascadeId = i
+            .cascadeId = i,
+            .lodPixelScale = 0.5f * getRenderPassExtent().width / LOD_PIXEL_ERROR,
         };
 
         commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
@@ -0,0 +1,283 @@
+#include "TextureRegistry.h"
+#include "SerializationTools.h"
+#include "TextureTools.h"
+#include "UploadManager.h"
+#include "GeometryTools.h"
+
+#include <unordered_set>
+
+std::mutex TextureRegistry::s_mutex;
+std::condition_variable TextureRegistry::s_jobAvailable;
+std::deque<std::packaged_task<VulkanImage*()>> TextureRegistry::s_jobs;
+std::vector<std::jthread> TextureRegistry::s_workers;
+bool TextureRegistry::s_stopping = false;
+std::unordered_map<std::string, std::shared_future<VulkanImage*>> TextureRegistry::s_textures;
+std::unordered_map<uint64_t, std::shared_future<VulkanImage*>> TextureRegistry::s_contents;
+std::unordered_map<const VulkanImage*, StreamingSource> TextureRegistry::s_streamingSources;
+size_t TextureRegistry::s_requestCount = 0;
+size_t TextureRegistry::s_sharedContentCount = 0;
+
+//Starts one worker per hardware thread the first time a job is queued, call with the lock held
+void TextureRegistry::startWorkers()
+{
+	if (!s_workers.empty())
+		return;
+	const uint32_t workerCount = std::max(1u, std::thread::hardware_concurrency());
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		s_workers.emplace_back(workerLoop);
+	}
+}
+
+//Runs texture jobs until the registry is cleaned, the queue is drained before leaving
+void TextureRegistry::workerLoop()
+{
+	while (true)
+	{
+		std::packaged_task<VulkanImage*()> job;
+		{
+			std::unique_lock lock(s_mutex);
+			s_jobAvailable.wait(lock, [] { return s_stopping || !s_jobs.empty(); });
+			if (s_jobs.empty())
+				return;
+			job = std::move(s_jobs.front());
+			s_jobs.pop_front();
+		}
+		job();
+	}
+}
+
+//Hash of the encoded image and of the format it is created with, nullopt when it can't be read (its load reports the error)
+std::optional<uint64_t> TextureRegistry::hashContent(const TextureRequest& request)
+{
+	try {
+		SerializationTools::MappedFile file(request.path);
+		const uint64_t size = request.size == 0 ? file.size() : request.size;
+		if (request.offset + size > file.size())
+			return std::nullopt;
+		return GeometryTools::hashBytes(file.data() + request.offset, size, static_cast<uint64_t>(request.format));
+	}
+	catch (const std::exception&)
+	{
+		return std::nullopt;
+	}
+}
+
+//Loads a texture, or waits for the image of an identical content loaded by another worker
+VulkanImage* TextureRegistry::loadTexture(VulkanContext* context, const TextureRequest& request)
+{
+	std::optional<uint64_t> contentHash = hashContent(request);
+	if (!contentHash.has_value())
+		return createTexture(context, request);
+
+	//The first worker to reach a content loads it, it never waits on another job
+	std::promise<VulkanImage*> promise;
+	std::shared_future<VulkanImage*> sharedImage;
+	{
+		std::lock_guard lock(s_mutex);
+		auto [content, isNew] = s_contents.try_emplace(*contentHash);
+		if (isNew)
+		{
+			content->second = promise.get_future().share();
+		}
+		else
+		{
+			sharedImage = content->second;
+			s_sharedContentCount++;
+		}
+	}
+	if (sharedImage.valid())
+		return sharedImage.get();
+
+	VulkanImage* image = createTexture(context, request);
+	promise.set_value(image);
+	return image;
+}
+
+//Decodes and uploads a texture, embedded images are decoded straight from the mapped glTF buffer, baked KTX2 files are uploaded as is
+VulkanImage* TextureRegistry::createTexture(VulkanContext* context, const TextureRequest& request)
+{
+	VulkanImageParams imageParams
+	{
+		.numSamples = vk::SampleCountFlagBits::e1,
+		.format = request.format,
+		.tiling = vk::ImageTiling::eOptimal,
+		.usage = vk::ImageUsageFlagBits::eSampled,
+	};
+	VulkanImageViewParams imageViewParams{
+		.aspectFlags = vk::ImageAspectFlagBits::eColor,
+	};
+
+	VulkanImage* image = nullptr;
+	if (request.path.extension() == ".ktx2")
+	{
+		//Baked textures carry their own block format, the requested one only tells the usage apart
+		try {
+			SerializationTools::MappedFile file(request.path);
+			TextureTools::BlockTexture texture = TextureTools::readKtx2(std::span<const std::byte>(file.data(), file.size()));
+
+			//Streamed textures start with the mips up to TEXTURE_STREAMING_TAIL_SIZE, the whole chain has to be in the file
+			uint32_t tailMip = 0;
+			if (ENABLE_TEXTURE_STREAMING && texture.levels.size() == TextureTools::mipLevelCount(texture.width, texture.height))
+			{
+				while (tailMip + 1 < texture.levels.size() && std::max(texture.width >> tailMip, texture.height >> tailMip) > TEXTURE_STREAMING_TAIL_SIZE)
+					tailMip++;
+			}
+			image = new VulkanImage(context, imageParams, imageViewParams, TextureTools::mipChainFrom(texture, tailMip), request.path.string());
+			if (tailMip > 0 && !image->hasLoadingFailed())
+			{
+				StreamingSource source{ .path = request.path, .tailMip = tailMip };
+				for (const auto& level : texture.levels)
+				{
+					source.levelSizes.push_back(level.size());
+				}
+				std::lock_guard lock(s_mutex);
+				s_streamingSources.emplace(image, std::move(source));
+			}
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "Baked texture " << request.path << " was not loaded: " << e.what() << std::endl;
+			return nullptr;
+		}
+	}
+	else if (request.size == 0)
+	{
+		image = new VulkanImage(context, imageParams, imageViewParams, request.path.string());
+	}
+	else
+	{
+		try {
+			SerializationTools::MappedFile file(request.path);
+			if (request.offset + request.size > file.size())
+				throw std::runtime_error("Embedded image out of the buffer range");
+			image = new VulkanImage(context, imageParams, imageViewParams, std::span<const std::byte>(file.data() + request.offset, request.size), request.path.string() + "@" + std::to_string(request.offset));
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "Embedded image of " << request.path << " was not loaded: " << e.what() << std::endl;
+			return nullptr;
+		}
+	}
+
+	if (image->hasLoadingFailed())
+	{
+		delete image;
+		return nullptr;
+	}
+	return image;
+}
+
+//Returns the texture of an image, queuing its loading the first time the image is requested
+std::shared_future<VulkanImage*> TextureRegistry::requestTexture(VulkanContext* context, const TextureRequest& request)
+{
+	//Different relative paths to the same file end up on the same key
+	std::error_code error;
+	std::filesystem::path resolvedPath = std::filesystem::weakly_canonical(request.path, error);
+	if (error)
+		resolvedPath = request.path;
+	std::string key = resolvedPath.generic_string() + "@" + std::to_string(request.offset) + "#" + std::to_string(static_cast<uint32_t>(request.format));
+
+	std::lock_guard lock(s_mutex);
+	s_requestCount++;
+	auto texture = s_textures.find(key);
+	if (texture != s_textures.end())
+		return texture->second;
+
+	startWorkers();
+	std::packaged_task<VulkanImage*()> job([context, request]() { return loadTexture(context, request); });
+	std::shared_future<VulkanImage*> future = job.get_future().share();
+	s_textures.emplace(key, future);
+	s_jobs.push_back(std::move(job));
+	s_jobAvailable.notify_one();
+	return future;
+}
+
+std::shared_future<VulkanImage*> TextureRegistry::requestMips(VulkanContext* context, const std::filesystem::path& path, uint32_t firstMip)
+{
+	std::packaged_task<VulkanImage*()> job([context, path, firstMip]() -> VulkanImage* {
+		VulkanImageParams imageParams
+		{
+			.numSamples = vk::SampleCountFlagBits::e1,
+			.tiling = vk::ImageTiling::eOptimal,
+			.usage = vk::ImageUsageFlagBits::eSampled,
+		};
+		VulkanImageViewParams imageViewParams{
+			.aspectFlags = vk::ImageAspectFlagBits::eColor,
+		};
+		try {
+			SerializationTools::MappedFile file(path);
+			TextureTools::BlockTexture texture = TextureTools::readKtx2(std::span<const std::byte>(file.data(), file.size()));
+			VulkanImage* image = new VulkanImage(context, imageParams, imageViewParams, TextureTools::mipChainFrom(texture, firstMip), path.string() + "#mip" + std::to_string(firstMip));
+			if (image->hasLoadingFailed())
+			{
+				delete image;
+				return nullptr;
+			}
+			return image;
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "Mips of " << path << " were not streamed: " << e.what() << std::endl;
+			return nullptr;
+		}
+	});
+
+	std::lock_guard lock(s_mutex);
+	startWorkers();
+	std::shared_future<VulkanImage*> future = job.get_future().share();
+	s_jobs.push_back(std::move(job));
+	s_jobAvailable.notify_one();
+	return future;
+}
+
+std::optional<StreamingSource> TextureRegistry::getStreamingSource(const VulkanImage* texture)
+{
+	std::lock_guard lock(s_mutex);
+	auto source = s_streamingSources.find(texture);
+	if (source == s_streamingSources.end())
+		return std::nullopt;
+	return source->second;
+}
+
+//Number of distinct images loaded or being loaded, identical contents are counted once
+size_t TextureRegistry::getTextureCount()
+{
+	std::lock_guard lock(s_mutex);
+	return s_textures.size() - s_sharedContentCount;
+}
+
+//Number of texture requests, textures shared by several materials are counted once per request
+size_t TextureRegistry::getRequestCount()
+{
+	std::lock_guard lock(s_mutex);
+	return s_requestCount;
+}
+
+void TextureRegistry::cleanTextures(VulkanContext* context)
+{
+	{
+		std::lock_guard lock(s_mutex);
+		s_stopping = true;
+	}
+	s_jobAvailable.notify_all();
+	s_workers.clear(); //Joins the workers once every queued texture is loaded
+	context->getUploadManager()->waitIdle();
+
+	//Images of identical contents are shared by several keys
+	std::unordered_set<VulkanImage*> images;
+	for (auto& [key, texture] : s_textures)
+	{
+		images.insert(texture.get());
+	}
+	for (VulkanImage* image : images)
+	{
+		delete image;
+	}
+	s_textures.clear();
+	s_contents.clear();
+	s_streamingSources.clear();
+	s_requestCount = 0;
+	s_sharedContentCount = 0;
+	s_stopping = false;
+}
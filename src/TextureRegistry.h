@@ -0,0 +1,63 @@
+/*
+author: Pyrrha Tocquet
+date: 17/10/26
+desc: Loads every texture image once, shared by all the materials of all the models
+Textures are decoded and uploaded by a pool of worker threads, requests for an image already known return the same VulkanImage
+Images are also keyed by a hash of their content: the same picture at different paths or glTF ranges is only uploaded once
+*/
+
+#pragma once
+#include "Defs.h"
+#include "VulkanImage.h"
+#include "VulkanContext.h"
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+#include <optional>
+
+struct TextureRequest {
+	std::filesystem::path path;
+	uint64_t offset = 0; //Range of an image embedded in a glTF buffer
+	uint64_t size = 0; //0 for the whole file
+	vk::Format format = vk::Format::eR8G8B8A8Srgb;
+};
+
+//Baked texture loaded with its mip tail only, the finer mips are streamed from its file (see TextureStreamer)
+struct StreamingSource {
+	std::filesystem::path path;
+	uint32_t tailMip = 0; //Mip of the whole chain stored in the first level of the tail image
+	std::vector<vk::DeviceSize> levelSizes; //Of the whole chain
+};
+
+class TextureRegistry {
+private:
+	static std::mutex s_mutex;
+	static std::condition_variable s_jobAvailable;
+	static std::deque<std::packaged_task<VulkanImage*()>> s_jobs;
+	static std::vector<std::jthread> s_workers;
+	static bool s_stopping;
+	static std::unordered_map<std::string, std::shared_future<VulkanImage*>> s_textures; //Keyed by resolved path, image range and format
+	static std::unordered_map<uint64_t, std::shared_future<VulkanImage*>> s_contents; //Keyed by content hash, the first load of a content
+	static std::unordered_map<const VulkanImage*, StreamingSource> s_streamingSources;
+	static size_t s_requestCount;
+	static size_t s_sharedContentCount; //Loads that reused the image of an identical content
+
+	static void startWorkers();
+	static void workerLoop();
+	[[nodiscard]] static std::optional<uint64_t> hashContent(const TextureRequest& request);
+	static VulkanImage* loadTexture(VulkanContext* context, const TextureRequest& request);
+	static VulkanImage* createTexture(VulkanContext* context, const TextureRequest& request);
+public:
+	//The future holds nullptr when the image can't be loaded
+	[[nodiscard]] static std::shared_future<VulkanImage*> requestTexture(VulkanContext* context, const TextureRequest& request);
+	//Loads the mips of a baked texture from firstMip on, on the worker threads. Not shared: the caller owns the image
+	[[nodiscard]] static std::shared_future<VulkanImage*> requestMips(VulkanContext* context, const std::filesystem::path& path, uint32_t firstMip);
+	//Set when the texture was loaded with its mip tail only
+	[[nodiscard]] static std::optional<StreamingSource> getStreamingSource(const VulkanImage* texture);
+	[[nodiscard]] static size_t getTextureCount();
+	[[nodiscard]] static size_t getRequestCount();
+	static void cleanTextures(VulkanContext* context); //Waits for pending loads and uploads, then destroys every texture
+};
@@ -0,0 +1,295 @@
+#include "TextureStreamer.h"
+#include "VulkanContext.h"
+#include "UploadManager.h"
+
+#include <algorithm>
+#include <chrono>
+
+TextureStreamer::TextureStreamer(VulkanContext* context, BindlessTextureTable* textureTable)
+{
+	m_context = context;
+	m_allocator = context->getAllocator();
+	m_textureTable = textureTable;
+	m_feedbackBuffer = context->createBuffer(sizeof(int32_t) * MAX_TEXTURE_COUNT * MAX_FRAMES_IN_FLIGHT, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer, vma::MemoryUsage::eGpuToCpu, "Texture Feedback Buffer");
+
+	//The first frames read their slot before any frame wrote it
+	int32_t* feedback = static_cast<int32_t*>(m_allocator->mapMemory(m_feedbackBuffer.m_Allocation));
+	std::fill_n(feedback, MAX_TEXTURE_COUNT * MAX_FRAMES_IN_FLIGHT, TEXTURE_FEEDBACK_CLEAR_VALUE);
+	m_allocator->flushAllocation(m_feedbackBuffer.m_Allocation, 0, VK_WHOLE_SIZE);
+	m_allocator->unmapMemory(m_feedbackBuffer.m_Allocation);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	//Loads still running are finished by the registry workers, then their uploads
+	std::vector<VulkanImage*> images;
+	for (StreamedTexture& texture : m_textures)
+	{
+		if (texture.pendingLoad.valid())
+			images.push_back(texture.pendingLoad.get());
+		images.push_back(texture.resident);
+	}
+	for (const RetiredImage& retiredImage : m_retiredImages)
+	{
+		images.push_back(retiredImage.image);
+	}
+	m_context->getUploadManager()->waitIdle();
+	for (VulkanImage* image : images)
+	{
+		delete image;
+	}
+	m_allocator->destroyBuffer(m_feedbackBuffer.m_Buffer, m_feedbackBuffer.m_Allocation);
+}
+
+void TextureStreamer::addTexture(uint32_t textureId, const VulkanImage* image)
+{
+	//Textures sampled with several samplers are streamed once
+	auto textureIndex = m_textureIndices.find(image);
+	if (textureIndex == m_textureIndices.end())
+	{
+		std::optional<StreamingSource> source = TextureRegistry::getStreamingSource(image);
+		if (!source.has_value())
+			return;
+		StreamedTexture& texture = m_textures.emplace_back();
+		texture.tail = image;
+		texture.residentMip = texture.desiredMip = source->tailMip;
+		texture.source = std::move(*source);
+		m_viewMips.emplace(static_cast<VkImageView>(image->m_imageView), texture.source.tailMip);
+		textureIndex = m_textureIndices.emplace(image, static_cast<uint32_t>(m_textures.size() - 1)).first;
+	}
+
+	StreamedTexture& texture = m_textures[textureIndex->second];
+	if (std::find(texture.textureIds.begin(), texture.textureIds.end(), textureId) == texture.textureIds.end())
+		texture.textureIds.push_back(textureId);
+	bindResidentMips(texture);
+}
+
+//A texture no element samples anymore goes back to its tail, it is streamed again if it is added back
+void TextureStreamer::removeTexture(uint32_t textureId)
+{
+	for (StreamedTexture& texture : m_textures)
+	{
+		if (std::erase(texture.textureIds, textureId) > 0 && texture.textureIds.empty())
+			retire(texture);
+	}
+}
+
+//Clears this frame's feedback before the fragment shaders run
+void TextureStreamer::recordFeedbackReset(vk::CommandBuffer commandBuffer, uint32_t currentFrame)
+{
+	commandBuffer.fillBuffer(m_feedbackBuffer.m_Buffer, sizeof(int32_t) * MAX_TEXTURE_COUNT * currentFrame, sizeof(int32_t) * MAX_TEXTURE_COUNT, static_cast<uint32_t>(TEXTURE_FEEDBACK_CLEAR_VALUE));
+
+	vk::MemoryBarrier2 memoryBarrier{
+		.srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+		.srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+		.dstStageMask = vk::PipelineStageFlagBits2::eFragmentShader,
+		.dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+	};
+
+	vk::DependencyInfo dependencyInfo = {
+		.memoryBarrierCount = 1,
+		.pMemoryBarriers = &memoryBarrier,
+	};
+
+	commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+
+//Makes the feedback visible to the host once the frame fence is signaled
+void TextureStreamer::recordFeedbackReadback(vk::CommandBuffer commandBuffer)
+{
+	vk::MemoryBarrier2 memoryBarrier{
+		.srcStageMask = vk::PipelineStageFlagBits2::eFragmentShader,
+		.srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+		.dstStageMask = vk::PipelineStageFlagBits2::eHost,
+		.dstAccessMask = vk::AccessFlagBits2::eHostRead,
+	};
+
+	vk::DependencyInfo dependencyInfo = {
+		.memoryBarrierCount = 1,
+		.pMemoryBarriers = &memoryBarrier,
+	};
+
+	commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+
+//Memory of the mips of the whole chain from firstMip on
+vk::DeviceSize TextureStreamer::getMipsSize(const StreamedTexture& texture, uint32_t firstMip) const
+{
+	vk::DeviceSize size = 0;
+	for (uint32_t mip = firstMip; mip < texture.source.levelSizes.size(); mip++)
+	{
+		size += texture.source.levelSizes[mip];
+	}
+	return size;
+}
+
+//Points the texture array elements of the texture to its finest resident mips
+void TextureStreamer::bindResidentMips(const StreamedTexture& texture)
+{
+	const VulkanImage* image = texture.resident != nullptr ? texture.resident : texture.tail;
+	for (uint32_t textureId : texture.textureIds)
+	{
+		m_textureTable->setImageView(textureId, image->m_imageView);
+	}
+}
+
+//The shaders wrote mips relative to the image written in this frame's descriptor sets when it was recorded, they still hold it
+void TextureStreamer::readFeedback(uint32_t currentFrame)
+{
+	m_allocator->invalidateAllocation(m_feedbackBuffer.m_Allocation, 0, VK_WHOLE_SIZE);
+	const int32_t* feedback = static_cast<const int32_t*>(m_allocator->mapMemory(m_feedbackBuffer.m_Allocation)) + MAX_TEXTURE_COUNT * currentFrame;
+	for (StreamedTexture& texture : m_textures)
+	{
+		for (uint32_t textureId : texture.textureIds)
+		{
+			if (feedback[textureId] == TEXTURE_FEEDBACK_CLEAR_VALUE)
+				continue;
+			auto boundMip = m_viewMips.find(static_cast<VkImageView>(m_textureTable->getWrittenView(currentFrame, textureId)));
+			if (boundMip == m_viewMips.end())
+				continue;
+
+			const uint32_t desiredMip = static_cast<uint32_t>(std::clamp(static_cast<int32_t>(boundMip->second) + feedback[textureId], 0, static_cast<int32_t>(texture.source.tailMip)));
+			if (texture.lastUsedFrame != m_frameNumber)
+			{
+				texture.desiredMip = desiredMip;
+				texture.lastUsedFrame = m_frameNumber;
+			}
+			else
+			{
+				texture.desiredMip = std::min(texture.desiredMip, desiredMip);
+			}
+		}
+	}
+	m_allocator->unmapMemory(m_feedbackBuffer.m_Allocation);
+}
+
+//Makes the loaded mips resident once their upload ran
+void TextureStreamer::completeLoads()
+{
+	UploadManager* uploadManager = m_context->getUploadManager();
+	for (StreamedTexture& texture : m_textures)
+	{
+		if (!texture.pendingLoad.valid() || texture.pendingLoad.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			continue;
+		VulkanImage* image = texture.pendingLoad.get();
+		if (image != nullptr && !uploadManager->isComplete(image->getUploadValue()))
+			continue;
+
+		texture.pendingLoad = {};
+		m_loadingSize -= getMipsSize(texture, texture.pendingMip);
+		m_loadingCount--;
+		if (image == nullptr)
+		{
+			texture.hasFailed = true;
+			continue;
+		}
+		retire(texture);
+		texture.resident = image;
+		texture.residentMip = texture.pendingMip;
+		m_viewMips.emplace(static_cast<VkImageView>(image->m_imageView), texture.residentMip);
+		bindResidentMips(texture);
+		m_residentSize += getMipsSize(texture, texture.residentMip);
+		m_uploadValue = std::max(m_uploadValue, image->getUploadValue());
+	}
+}
+
+//Sends the texture back to its tail, the streamed image is destroyed once no frame in flight samples it
+void TextureStreamer::retire(StreamedTexture& texture)
+{
+	if (texture.resident == nullptr)
+		return;
+	m_retiredImages.push_back(RetiredImage{ texture.resident, m_frameNumber });
+	m_residentSize -= getMipsSize(texture, texture.residentMip);
+	texture.resident = nullptr;
+	texture.residentMip = texture.source.tailMip;
+	bindResidentMips(texture);
+}
+
+//Evicts the least recently used textures until size more bytes fit in the budget, textures sampled by the last frame are kept
+bool TextureStreamer::evict(vk::DeviceSize size)
+{
+	while (m_residentSize + m_loadingSize + size > TEXTURE_STREAMING_BUDGET)
+	{
+		StreamedTexture* leastRecentlyUsed = nullptr;
+		for (StreamedTexture& texture : m_textures)
+		{
+			if (texture.resident != nullptr && texture.lastUsedFrame < m_frameNumber && (leastRecentlyUsed == nullptr || texture.lastUsedFrame < leastRecentlyUsed->lastUsedFrame))
+				leastRecentlyUsed = &texture;
+		}
+		if (leastRecentlyUsed == nullptr)
+			return false;
+		retire(*leastRecentlyUsed);
+	}
+	return true;
+}
+
+//Loads finer mips for the sampled textures, the ones missing the most mips first
+void TextureStreamer::startLoads()
+{
+	std::vector<StreamedTexture*> candidates;
+	for (StreamedTexture& texture : m_textures)
+	{
+		if (!texture.hasFailed && !texture.pendingLoad.valid() && texture.lastUsedFrame == m_frameNumber && texture.desiredMip < texture.residentMip)
+			candidates.push_back(&texture);
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const StreamedTexture* a, const StreamedTexture* b) {
+		return a->residentMip - a->desiredMip > b->residentMip - b->desiredMip;
+	});
+
+	for (StreamedTexture* texture : candidates)
+	{
+		if (m_loadingCount >= TEXTURE_STREAMING_MAX_LOADS)
+			break;
+		//The image holds the whole chain from the desired mip, the resident one is only replaced when it is loaded
+		vk::DeviceSize size = getMipsSize(*texture, texture->desiredMip);
+		if (!evict(size))
+			continue;
+		texture->pendingLoad = TextureRegistry::requestMips(m_context, texture->source.path, texture->desiredMip);
+		texture->pendingMip = texture->desiredMip;
+		m_loadingSize += size;
+		m_loadingCount++;
+	}
+}
+
+void TextureStreamer::update(uint32_t currentFrame)
+{
+	m_frameNumber++;
+	readFeedback(currentFrame);
+	completeLoads();
+	startLoads();
+
+	//The other frames in flight have written their descriptors since the image was retired, and their fences were waited on
+	std::erase_if(m_retiredImages, [this](const RetiredImage& retiredImage) {
+		if (retiredImage.frame + MAX_FRAMES_IN_FLIGHT > m_frameNumber)
+			return false;
+		m_viewMips.erase(static_cast<VkImageView>(retiredImage.image->m_imageView));
+		delete retiredImage.image;
+		return true;
+	});
+}
+
+vk::Buffer TextureStreamer::getFeedbackBuffer() const
+{
+	return m_feedbackBuffer.m_Buffer;
+}
+
+//Frames wait on it: the images in the descriptors were uploaded, waiting makes their texels visible
+uint64_t TextureStreamer::getUploadValue() const
+{
+	return m_uploadValue;
+}
+
+vk::DeviceSize TextureStreamer::getResidentSize() const
+{
+	return m_residentSize;
+}
+
+size_t TextureStreamer::getStreamedTextureCount() const
+{
+	return m_textures.size();
+}
+
+uint32_t TextureStreamer::getLoadingCount() const
+{
+	return m_loadingCount;
+}
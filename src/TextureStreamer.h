@@ -0,0 +1,82 @@
+/*
+author: Pyrrha Tocquet
+date: 17/10/26
+desc: Streams the mips of the baked textures of a scene: only their mip tail is loaded with the scene, finer mips come once the fragment shaders need them
+The main pass writes, per texture, the finest mip it samples in a feedback buffer. Textures are reloaded with more mips by priority, the least recently used go back to their tail over the memory budget
+Streamed images replace the tails at their indices of the scene BindlessTextureTable
+*/
+
+#pragma once
+#include "Defs.h"
+#include "VulkanImage.h"
+#include "TextureRegistry.h"
+#include "BindlessTextureTable.h"
+#include <future>
+#include <unordered_map>
+
+class VulkanContext;
+
+constexpr int32_t TEXTURE_FEEDBACK_CLEAR_VALUE = INT32_MAX; //Texture not sampled during the frame
+
+class TextureStreamer
+{
+private:
+	struct StreamedTexture {
+		const VulkanImage* tail = nullptr; //Owned by the TextureRegistry, always resident
+		StreamingSource source;
+		std::vector<uint32_t> textureIds; //Texture array elements sampling it, one per sampler
+		VulkanImage* resident = nullptr; //Finer mips, owned by the streamer, nullptr when only the tail is resident
+		uint32_t residentMip = 0; //First mip of the whole chain that can be sampled
+		uint32_t desiredMip = 0;
+		uint64_t lastUsedFrame = 0;
+		std::shared_future<VulkanImage*> pendingLoad;
+		uint32_t pendingMip = 0;
+		bool hasFailed = false; //Loading finer mips failed once, the texture stays on its tail
+	};
+	struct RetiredImage {
+		VulkanImage* image;
+		uint64_t frame; //Destroyed once every frame in flight has stopped sampling it
+	};
+
+	VulkanContext* m_context;
+	vma::Allocator* m_allocator;
+	BindlessTextureTable* m_textureTable;
+	VulkanBuffer m_feedbackBuffer; //MAX_TEXTURE_COUNT desired mips per frame in flight, relative to the sampled image, written by the fragment shaders
+
+	std::vector<StreamedTexture> m_textures;
+	std::unordered_map<const VulkanImage*, uint32_t> m_textureIndices; //Keyed by tail
+	std::unordered_map<VkImageView, uint32_t> m_viewMips; //Mip of the whole chain in the first level of the views of tails and streamed images
+	std::vector<RetiredImage> m_retiredImages;
+
+	uint64_t m_frameNumber = 0;
+	uint64_t m_uploadValue = 0; //Latest upload of the images written in the descriptors
+	vk::DeviceSize m_residentSize = 0;
+	vk::DeviceSize m_loadingSize = 0;
+	uint32_t m_loadingCount = 0;
+
+	[[nodiscard]] vk::DeviceSize getMipsSize(const StreamedTexture& texture, uint32_t firstMip) const;
+	void bindResidentMips(const StreamedTexture& texture);
+	void readFeedback(uint32_t currentFrame);
+	void completeLoads();
+	void retire(StreamedTexture& texture);
+	[[nodiscard]] bool evict(vk::DeviceSize size);
+	void startLoads();
+public:
+	TextureStreamer(VulkanContext* context, BindlessTextureTable* textureTable);
+	~TextureStreamer();
+
+	//Streams the image sampled at this texture array element if it is a baked texture tail
+	void addTexture(uint32_t textureId, const VulkanImage* image);
+	//Stops streaming at a released texture array element
+	void removeTexture(uint32_t textureId);
+	void recordFeedbackReset(vk::CommandBuffer commandBuffer, uint32_t currentFrame);
+	void recordFeedbackReadback(vk::CommandBuffer commandBuffer);
+	//Call once the frame in flight fence is signaled, before taking the table updates: reads its feedback and swaps the streamed images in the table
+	void update(uint32_t currentFrame);
+
+	[[nodiscard]] vk::Buffer getFeedbackBuffer() const;
+	[[nodiscard]] uint64_t getUploadValue() const;
+	[[nodiscard]] vk::DeviceSize getResidentSize() const;
+	[[nodiscard]] size_t getStreamedTextureCount() const;
+	[[nodiscard]] uint32_t getLoadingCount() const;
+};
@@ -0,0 +1,804 @@
+#include "TextureTools.h"
+#include "GeometryTools.h"
+#include <stb_image.h>
+#include <fstream>
+#include <cstring>
+#include <chrono>
+#include <unordered_map>
+
+namespace TextureTools {
+
+    constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    struct Ktx2Header {
+        uint8_t identifier[12] = {};
+        uint32_t vkFormat = 0;
+        uint32_t typeSize = 1; //1 for block compressed formats
+        uint32_t pixelWidth = 0;
+        uint32_t pixelHeight = 0;
+        uint32_t pixelDepth = 0;
+        uint32_t layerCount = 0;
+        uint32_t faceCount = 1;
+        uint32_t levelCount = 0;
+        uint32_t supercompressionScheme = 0;
+        uint32_t dfdByteOffset = 0;
+        uint32_t dfdByteLength = 0;
+        uint32_t kvdByteOffset = 0;
+        uint32_t kvdByteLength = 0;
+        uint64_t sgdByteOffset = 0;
+        uint64_t sgdByteLength = 0;
+    };
+    static_assert(sizeof(Ktx2Header) == 80);
+
+    struct Ktx2Level {
+        uint64_t byteOffset = 0;
+        uint64_t byteLength = 0;
+        uint64_t uncompressedByteLength = 0;
+    };
+
+    //Khronos data format descriptor values used by the basic descriptor block
+    constexpr uint32_t KHR_DF_MODEL_BC4 = 131;
+    constexpr uint32_t KHR_DF_MODEL_BC5 = 132;
+    constexpr uint32_t KHR_DF_MODEL_BC7 = 134;
+    constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+    constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+    constexpr uint32_t KHR_DF_TRANSFER_SRGB = 2;
+
+    uint32_t blockSize(vk::Format format)
+    {
+        switch (format)
+        {
+        case vk::Format::eBc4UnormBlock:
+            return 8;
+        case vk::Format::eBc5UnormBlock:
+        case vk::Format::eBc7UnormBlock:
+        case vk::Format::eBc7SrgbBlock:
+            return 16;
+        default:
+            return 0;
+        }
+    }
+
+    uint32_t mipLevelCount(uint32_t width, uint32_t height)
+    {
+        return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+    }
+
+    static size_t levelSize(vk::Format format, uint32_t width, uint32_t height)
+    {
+        return size_t((width + 3) / 4) * ((height + 3) / 4) * blockSize(format);
+    }
+
+#ifdef _MSC_VER
+#pragma region MIPS
+#endif
+    static float srgbToLinear(float value)
+    {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    static float linearToSrgb(float value)
+    {
+        return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    static uint8_t toUnorm8(float value)
+    {
+        return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    //Mip levels are filtered in a space where averaging is meaningful: premultiplied linear color, unit vectors, raw values
+    static glm::vec4 decodeTexel(const uint8_t* texel, TextureUsage usage)
+    {
+        static const auto srgbTable = []() {
+            std::array<float, 256> table;
+            for (uint32_t i = 0; i < 256; i++)
+                table[i] = srgbToLinear(i / 255.0f);
+            return table;
+        }();
+
+        switch (usage)
+        {
+        case ColorTextureUsage:
+        {
+            float alpha = texel[3] / 255.0f;
+            return glm::vec4(srgbTable[texel[0]] * alpha, srgbTable[texel[1]] * alpha, srgbTable[texel[2]] * alpha, alpha);
+        }
+        case NormalTextureUsage:
+            return glm::vec4(glm::vec3(texel[0], texel[1], texel[2]) / 127.5f - 1.0f, 1.0f);
+        default:
+            return glm::vec4(texel[0], texel[1], texel[2], texel[3]) / 255.0f;
+        }
+    }
+
+    static void encodeTexel(glm::vec4 value, TextureUsage usage, uint8_t* outTexel)
+    {
+        switch (usage)
+        {
+        case ColorTextureUsage:
+        {
+            glm::vec3 color = value.a > 0.0f ? glm::vec3(value) / value.a : glm::vec3(0.0f);
+            outTexel[0] = toUnorm8(linearToSrgb(color.r));
+            outTexel[1] = toUnorm8(linearToSrgb(color.g));
+            outTexel[2] = toUnorm8(linearToSrgb(color.b));
+            outTexel[3] = toUnorm8(value.a);
+            return;
+        }
+        case NormalTextureUsage:
+        {
+            glm::vec3 normal = glm::length(glm::vec3(value)) > FLT_EPSILON ? glm::normalize(glm::vec3(value)) : glm::vec3(0.0f, 0.0f, 1.0f);
+            outTexel[0] = toUnorm8(normal.x * 0.5f + 0.5f);
+            outTexel[1] = toUnorm8(normal.y * 0.5f + 0.5f);
+            outTexel[2] = toUnorm8(normal.z * 0.5f + 0.5f);
+            outTexel[3] = 255;
+            return;
+        }
+        default:
+            for (uint32_t c = 0; c < 4; c++)
+                outTexel[c] = toUnorm8(value[c]);
+        }
+    }
+
+    //Box filter taps of one axis: each destination texel averages the source texels it covers, weighted by coverage, so odd sizes are filtered correctly
+    struct FilterTap {
+        uint32_t source;
+        float weight;
+    };
+
+    static std::vector<std::vector<FilterTap>> boxFilterTaps(uint32_t sourceSize, uint32_t destinationSize)
+    {
+        std::vector<std::vector<FilterTap>> taps(destinationSize);
+        const float scale = static_cast<float>(sourceSize) / destinationSize;
+        for (uint32_t d = 0; d < destinationSize; d++)
+        {
+            const float begin = d * scale;
+            const float end = begin + scale;
+            for (uint32_t s = static_cast<uint32_t>(begin); s < std::min(sourceSize, static_cast<uint32_t>(std::ceil(end))); s++)
+            {
+                float coverage = std::min(end, s + 1.0f) - std::max(begin, static_cast<float>(s));
+                if (coverage > 0.0f)
+                    taps[d].push_back({ s, coverage / scale });
+            }
+        }
+        return taps;
+    }
+
+    static std::vector<glm::vec4> downsample(const std::vector<glm::vec4>& source, uint32_t width, uint32_t height, uint32_t destinationWidth, uint32_t destinationHeight)
+    {
+        const auto tapsX = boxFilterTaps(width, destinationWidth);
+        const auto tapsY = boxFilterTaps(height, destinationHeight);
+        std::vector<glm::vec4> destination(size_t(destinationWidth) * destinationHeight);
+        GeometryTools::runParallel(destinationHeight, 0, [&](uint32_t y) {
+            for (uint32_t x = 0; x < destinationWidth; x++)
+            {
+                glm::vec4 sum(0.0f);
+                for (const FilterTap& tapY : tapsY[y])
+                {
+                    const glm::vec4* row = source.data() + size_t(tapY.source) * width;
+                    for (const FilterTap& tapX : tapsX[x])
+                        sum += row[tapX.source] * (tapX.weight * tapY.weight);
+                }
+                destination[size_t(y) * destinationWidth + x] = sum;
+            }
+        });
+        return destination;
+    }
+#ifdef _MSC_VER
+#pragma endregion
+#endif
+
+#ifdef _MSC_VER
+#pragma region BLOCK_ENCODING
+#endif
+    //Writes fields LSB first, as laid out by the BC formats
+    struct BitWriter {
+        uint8_t* bytes;
+        uint32_t position = 0;
+
+        void write(uint32_t value, uint32_t bitCount)
+        {
+            for (uint32_t i = 0; i < bitCount; i++, position++)
+            {
+                if ((value >> i) & 1)
+                    bytes[position >> 3] |= static_cast<uint8_t>(1u << (position & 7));
+            }
+        }
+    };
+
+    //BC4: one channel, 8 interpolated values between the block extremes
+    static void encodeBC4Block(const uint8_t values[16], uint8_t* outBlock)
+    {
+        uint8_t low = 255;
+        uint8_t high = 0;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            low = std::min(low, values[i]);
+            high = std::max(high, values[i]);
+        }
+
+        std::memset(outBlock, 0, 8);
+        outBlock[0] = high;
+        outBlock[1] = low;
+        if (high == low)
+            return; //Every index 0 reads the first endpoint
+
+        //Code 0 is high, 1 is low, codes 2 to 7 go from high to low
+        uint64_t indices = 0;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            uint32_t step = static_cast<uint32_t>(std::lround((values[i] - low) * 7.0f / (high - low)));
+            uint64_t code = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+            indices |= code << (3 * i);
+        }
+        for (uint32_t i = 0; i < 6; i++)
+            outBlock[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+    }
+
+    constexpr int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    //BC7 mode 6 endpoints: 7 bits per channel and a shared lowest bit per endpoint
+    struct BC7Endpoints {
+        uint8_t quantized[2][4];
+        uint8_t pBits[2];
+        int values[2][4]; //Dequantized, 0 to 255
+    };
+
+    static BC7Endpoints quantizeBC7Endpoints(const glm::vec4& first, const glm::vec4& second, uint32_t pBit0, uint32_t pBit1)
+    {
+        BC7Endpoints endpoints{};
+        endpoints.pBits[0] = static_cast<uint8_t>(pBit0);
+        endpoints.pBits[1] = static_cast<uint8_t>(pBit1);
+        for (uint32_t e = 0; e < 2; e++)
+        {
+            const glm::vec4& endpoint = e == 0 ? first : second;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                int quantized = std::clamp(static_cast<int>(std::lround((endpoint[c] - endpoints.pBits[e]) * 0.5f)), 0, 127);
+                endpoints.quantized[e][c] = static_cast<uint8_t>(quantized);
+                endpoints.values[e][c] = (quantized << 1) | endpoints.pBits[e];
+            }
+        }
+        return endpoints;
+    }
+
+    //Picks the closest palette entry of each pixel around its projection on the endpoint segment, returns the squared error
+    static uint32_t selectBC7Indices(const uint8_t pixels[16][4], const BC7Endpoints& endpoints, uint8_t outIndices[16])
+    {
+        int palette[16][4];
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            for (uint32_t c = 0; c < 4; c++)
+                palette[i][c] = ((64 - BC7_WEIGHTS4[i]) * endpoints.values[0][c] + BC7_WEIGHTS4[i] * endpoints.values[1][c] + 32) >> 6;
+        }
+
+        float axis[4];
+        float axisLength = 0.0f;
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            axis[c] = static_cast<float>(endpoints.values[1][c] - endpoints.values[0][c]);
+            axisLength += axis[c] * axis[c];
+        }
+
+        uint32_t totalError = 0;
+        for (uint32_t p = 0; p < 16; p++)
+        {
+            int guess = 0;
+            if (axisLength > 0.0f)
+            {
+                float t = 0.0f;
+                for (uint32_t c = 0; c < 4; c++)
+                    t += (pixels[p][c] - endpoints.values[0][c]) * axis[c];
+                guess = std::clamp(static_cast<int>(std::lround(t / axisLength * 15.0f)), 0, 15);
+            }
+
+            uint32_t bestError = UINT32_MAX;
+            for (int i = std::max(guess - 1, 0); i <= std::min(guess + 1, 15); i++)
+            {
+                uint32_t error = 0;
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    int delta = pixels[p][c] - palette[i][c];
+                    error += delta * delta;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    outIndices[p] = static_cast<uint8_t>(i);
+                }
+            }
+            totalError += bestError;
+        }
+        return totalError;
+    }
+
+    //Least squares endpoints for fixed indices, false when every pixel uses the same weight
+    static bool fitBC7Endpoints(const uint8_t pixels[16][4], const uint8_t indices[16], glm::vec4& outFirst, glm::vec4& outSecond)
+    {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        glm::vec4 ap(0.0f), bp(0.0f);
+        for (uint32_t p = 0; p < 16; p++)
+        {
+            float b = BC7_WEIGHTS4[indices[p]] / 64.0f;
+            float a = 1.0f - b;
+            glm::vec4 pixel(pixels[p][0], pixels[p][1], pixels[p][2], pixels[p][3]);
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            ap += a * pixel;
+            bp += b * pixel;
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f)
+            return false;
+        outFirst = glm::clamp((ap * bb - bp * ab) / determinant, 0.0f, 255.0f);
+        outSecond = glm::clamp((bp * aa - ap * ab) / determinant, 0.0f, 255.0f);
+        return true;
+    }
+
+    //BC7 mode 6 only: one RGBA segment per block, 16 interpolation steps
+    //Endpoints come from the principal axis of the block, every p-bit combination is tried, then the best one is refined once by least squares
+    static void encodeBC7Block(const uint8_t pixels[16][4], uint8_t* outBlock)
+    {
+        glm::vec4 mean(0.0f);
+        for (uint32_t p = 0; p < 16; p++)
+            mean += glm::vec4(pixels[p][0], pixels[p][1], pixels[p][2], pixels[p][3]);
+        mean /= 16.0f;
+
+        glm::mat4 covariance(0.0f);
+        for (uint32_t p = 0; p < 16; p++)
+        {
+            glm::vec4 d = glm::vec4(pixels[p][0], pixels[p][1], pixels[p][2], pixels[p][3]) - mean;
+            covariance += glm::outerProduct(d, d);
+        }
+
+        glm::vec4 axis(1.0f, 1.0f, 1.0f, 0.0f);
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            axis = covariance * axis;
+            float length = glm::length(axis);
+            if (length < FLT_EPSILON)
+                break;
+            axis /= length;
+        }
+
+        float low = FLT_MAX;
+        float high = -FLT_MAX;
+        for (uint32_t p = 0; p < 16; p++)
+        {
+            float t = glm::dot(glm::vec4(pixels[p][0], pixels[p][1], pixels[p][2], pixels[p][3]) - mean, axis);
+            low = std::min(low, t);
+            high = std::max(high, t);
+        }
+        glm::vec4 first = glm::clamp(mean + axis * low, 0.0f, 255.0f);
+        glm::vec4 second = glm::clamp(mean + axis * high, 0.0f, 255.0f);
+
+        BC7Endpoints best{};
+        uint8_t bestIndices[16] = {};
+        uint32_t bestError = UINT32_MAX;
+        auto tryEndpoints = [&](const glm::vec4& a, const glm::vec4& b) {
+            for (uint32_t pBits = 0; pBits < 4; pBits++)
+            {
+                BC7Endpoints endpoints = quantizeBC7Endpoints(a, b, pBits & 1, pBits >> 1);
+                uint8_t indices[16];
+                uint32_t error = selectBC7Indices(pixels, endpoints, indices);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = endpoints;
+                    std::memcpy(bestIndices, indices, sizeof(indices));
+                }
+            }
+        };
+        tryEndpoints(first, second);
+        if (bestError > 0 && fitBC7Endpoints(pixels, bestIndices, first, second))
+            tryEndpoints(first, second);
+
+        //The first index is stored without its highest bit, which must be 0
+        if (bestIndices[0] & 8)
+        {
+            std::swap(best.quantized[0], best.quantized[1]);
+            std::swap(best.pBits[0], best.pBits[1]);
+            for (uint8_t& index : bestIndices)
+                index = 15 - index;
+        }
+
+        std::memset(outBlock, 0, 16);
+        BitWriter writer{ outBlock };
+        writer.write(1 << 6, 7); //Mode 6
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            writer.write(best.quantized[0][c], 7);
+            writer.write(best.quantized[1][c], 7);
+        }
+        writer.write(best.pBits[0], 1);
+        writer.write(best.pBits[1], 1);
+        writer.write(bestIndices[0], 3);
+        for (uint32_t p = 1; p < 16; p++)
+            writer.write(bestIndices[p], 4);
+    }
+
+    //Encodes an RGBA8 level, edge blocks repeat the last row and column
+    static void encodeLevel(const uint8_t* rgbaPixels, uint32_t width, uint32_t height, vk::Format format, const uint32_t channels[2], std::byte* outBlocks)
+    {
+        const uint32_t blocksX = (width + 3) / 4;
+        const uint32_t blocksY = (height + 3) / 4;
+        const uint32_t bytesPerBlock = blockSize(format);
+        GeometryTools::runParallel(blocksY, 0, [&](uint32_t by) {
+            for (uint32_t bx = 0; bx < blocksX; bx++)
+            {
+                uint8_t pixels[16][4];
+                for (uint32_t p = 0; p < 16; p++)
+                {
+                    uint32_t x = std::min(bx * 4 + p % 4, width - 1);
+                    uint32_t y = std::min(by * 4 + p / 4, height - 1);
+                    std::memcpy(pixels[p], rgbaPixels + (size_t(y) * width + x) * 4, 4);
+                }
+
+                uint8_t* block = reinterpret_cast<uint8_t*>(outBlocks) + (size_t(by) * blocksX + bx) * bytesPerBlock;
+                if (format == vk::Format::eBc7SrgbBlock || format == vk::Format::eBc7UnormBlock)
+                {
+                    encodeBC7Block(pixels, block);
+                    continue;
+                }
+
+                const uint32_t channelCount = format == vk::Format::eBc5UnormBlock ? 2 : 1;
+                for (uint32_t c = 0; c < channelCount; c++)
+                {
+                    uint8_t values[16];
+                    for (uint32_t p = 0; p < 16; p++)
+                        values[p] = pixels[p][channels[c]];
+                    encodeBC4Block(values, block + 8 * c);
+                }
+            }
+        });
+    }
+#ifdef _MSC_VER
+#pragma endregion
+#endif
+
+    //Builds the whole mip chain on the CPU and block compresses every level
+    BlockTexture compressTexture(const uint8_t* rgbaPixels, uint32_t width, uint32_t height, TextureUsage usage)
+    {
+        BlockTexture texture{};
+        texture.width = width;
+        texture.height = height;
+        uint32_t channels[2] = { 0, 1 };
+
+        switch (usage)
+        {
+        case ColorTextureUsage:
+            texture.format = vk::Format::eBc7SrgbBlock;
+            break;
+        case NormalTextureUsage:
+            texture.format = vk::Format::eBc5UnormBlock;
+            std::memcpy(texture.swizzle, "rg01", 4);
+            break;
+        case MetallicRoughnessTextureUsage:
+        {
+            //Metallic is often 0 or 1 everywhere, the image view then supplies it and only roughness is stored
+            const size_t texelCount = size_t(width) * height;
+            bool constantMetallic = true;
+            for (size_t i = 1; i < texelCount && constantMetallic; i++)
+                constantMetallic = rgbaPixels[i * 4 + 2] == rgbaPixels[2];
+            constantMetallic = constantMetallic && (rgbaPixels[2] == 0 || rgbaPixels[2] == 255);
+
+            channels[0] = 1;
+            channels[1] = 2;
+            texture.format = constantMetallic ? vk::Format::eBc4UnormBlock : vk::Format::eBc5UnormBlock;
+            std::memcpy(texture.swizzle, constantMetallic ? (rgbaPixels[2] == 0 ? "0r01" : "0r11") : "0rg1", 4);
+            break;
+        }
+        }
+
+        const uint32_t levelCount = mipLevelCount(width, height);
+        std::vector<size_t> levelOffsets(levelCount);
+        size_t totalSize = 0;
+        for (uint32_t level = 0; level < levelCount; level++)
+        {
+            levelOffsets[level] = totalSize;
+            totalSize += levelSize(texture.format, std::max(width >> level, 1u), std::max(height >> level, 1u));
+        }
+        texture.data.resize(totalSize);
+
+        //Level 0 is encoded from the source texels, the others from the filtered previous level
+        encodeLevel(rgbaPixels, width, height, texture.format, channels, texture.data.data());
+
+        std::vector<glm::vec4> filtered(size_t(width) * height);
+        for (size_t i = 0; i < filtered.size(); i++)
+            filtered[i] = decodeTexel(rgbaPixels + i * 4, usage);
+
+        std::vector<uint8_t> levelPixels;
+        uint32_t levelWidth = width;
+        uint32_t levelHeight = height;
+        for (uint32_t level = 1; level < levelCount; level++)
+        {
+            uint32_t nextWidth = std::max(levelWidth / 2, 1u);
+            uint32_t nextHeight = std::max(levelHeight / 2, 1u);
+            filtered = downsample(filtered, levelWidth, levelHeight, nextWidth, nextHeight);
+            levelWidth = nextWidth;
+            levelHeight = nextHeight;
+
+            levelPixels.resize(filtered.size() * 4);
+            for (size_t i = 0; i < filtered.size(); i++)
+                encodeTexel(filtered[i], usage, levelPixels.data() + i * 4);
+            encodeLevel(levelPixels.data(), levelWidth, levelHeight, texture.format, channels, texture.data.data() + levelOffsets[level]);
+        }
+
+        for (uint32_t level = 0; level < levelCount; level++)
+        {
+            size_t end = level + 1 < levelCount ? levelOffsets[level + 1] : totalSize;
+            texture.levels.emplace_back(texture.data.data() + levelOffsets[level], end - levelOffsets[level]);
+        }
+        return texture;
+    }
+
+#ifdef _MSC_VER
+#pragma region KTX2
+#endif
+    //Basic data format descriptor, required by KTX2 readers (the renderer only reads vkFormat)
+    static std::vector<uint32_t> dataFormatDescriptor(vk::Format format)
+    {
+        uint32_t model = KHR_DF_MODEL_BC7;
+        uint32_t sampleCount = 1;
+        if (format == vk::Format::eBc4UnormBlock)
+            model = KHR_DF_MODEL_BC4;
+        else if (format == vk::Format::eBc5UnormBlock)
+        {
+            model = KHR_DF_MODEL_BC5;
+            sampleCount = 2;
+        }
+        const uint32_t transfer = format == vk::Format::eBc7SrgbBlock ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+        const uint32_t blockBits = blockSize(format) * 8 / sampleCount;
+        const uint32_t descriptorSize = 24 + 16 * sampleCount;
+
+        std::vector<uint32_t> words = {
+            4 + descriptorSize, //dfdTotalSize
+            0, //vendorId, descriptorType
+            2 | (descriptorSize << 16), //versionNumber, descriptorBlockSize
+            model | (KHR_DF_PRIMARIES_BT709 << 8) | (transfer << 16), //flags 0: straight alpha
+            3 | (3 << 8), //4x4 texel blocks
+            blockSize(format), //bytesPlane0
+            0,
+        };
+        for (uint32_t s = 0; s < sampleCount; s++)
+        {
+            words.push_back((s * blockBits) | ((blockBits - 1) << 16) | (s << 24)); //bitOffset, bitLength, channel (red, green)
+            words.push_back(0); //samplePosition
+            words.push_back(0); //sampleLower
+            words.push_back(UINT32_MAX); //sampleUpper
+        }
+        return words;
+    }
+
+    static void appendKeyValue(std::vector<uint8_t>& data, const std::string& key, const std::string& value)
+    {
+        uint32_t length = static_cast<uint32_t>(key.size() + 1 + value.size() + 1);
+        data.insert(data.end(), reinterpret_cast<const uint8_t*>(&length), reinterpret_cast<const uint8_t*>(&length) + sizeof(length));
+        data.insert(data.end(), key.c_str(), key.c_str() + key.size() + 1);
+        data.insert(data.end(), value.c_str(), value.c_str() + value.size() + 1);
+        data.resize((data.size() + 3) & ~size_t(3), 0);
+    }
+
+    //Levels are stored from the smallest to the largest, as the KTX2 layout requires
+    void writeKtx2(const std::filesystem::path& path, const BlockTexture& texture)
+    {
+        const uint32_t levelCount = static_cast<uint32_t>(texture.levels.size());
+        const std::vector<uint32_t> dfd = dataFormatDescriptor(texture.format);
+
+        std::vector<uint8_t> kvd;
+        if (std::memcmp(texture.swizzle, "rgba", 4) != 0)
+            appendKeyValue(kvd, "KTXswizzle", std::string(texture.swizzle, 4));
+        appendKeyValue(kvd, "KTXwriter", "pyrrha-bake");
+
+        Ktx2Header header{};
+        std::memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+        header.vkFormat = static_cast<uint32_t>(texture.format);
+        header.pixelWidth = texture.width;
+        header.pixelHeight = texture.height;
+        header.levelCount = levelCount;
+        header.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2Header) + levelCount * sizeof(Ktx2Level));
+        header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+        header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+        header.kvdByteLength = static_cast<uint32_t>(kvd.size());
+
+        std::vector<Ktx2Level> levels(levelCount);
+        uint64_t offset = header.kvdByteOffset + header.kvdByteLength;
+        for (uint32_t level = levelCount; level-- > 0;)
+        {
+            offset = (offset + KTX2_ALIGNMENT - 1) & ~uint64_t(KTX2_ALIGNMENT - 1);
+            levels[level] = { offset, texture.levels[level].size(), texture.levels[level].size() };
+            offset += texture.levels[level].size();
+        }
+
+        std::vector<uint8_t> file(offset, 0);
+        std::memcpy(file.data(), &header, sizeof(header));
+        std::memcpy(file.data() + sizeof(header), levels.data(), levels.size() * sizeof(Ktx2Level));
+        std::memcpy(file.data() + header.dfdByteOffset, dfd.data(), header.dfdByteLength);
+        std::memcpy(file.data() + header.kvdByteOffset, kvd.data(), kvd.size());
+        for (uint32_t level = 0; level < levelCount; level++)
+            std::memcpy(file.data() + levels[level].byteOffset, texture.levels[level].data(), texture.levels[level].size());
+
+        //Written next to the final file then renamed, a reader never sees a partial texture
+        std::filesystem::path temporaryPath = path;
+        temporaryPath += ".tmp";
+        std::filesystem::create_directories(path.parent_path());
+        {
+            std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!out.write(reinterpret_cast<const char*>(file.data()), file.size()))
+                throw std::runtime_error("Could not write " + temporaryPath.string());
+        }
+        std::filesystem::rename(temporaryPath, path);
+    }
+
+    //Validates a KTX2 file written by writeKtx2, the levels point into the file memory
+    BlockTexture readKtx2(std::span<const std::byte> file)
+    {
+        Ktx2Header header{};
+        if (file.size() < sizeof(header))
+            throw std::runtime_error("Truncated KTX2 file");
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+            throw std::runtime_error("Not a KTX2 file");
+
+        BlockTexture texture{};
+        texture.format = static_cast<vk::Format>(header.vkFormat);
+        texture.width = header.pixelWidth;
+        texture.height = header.pixelHeight;
+        if (blockSize(texture.format) == 0 || header.supercompressionScheme != 0 || header.pixelDepth != 0 || header.layerCount > 1 || header.faceCount != 1)
+            throw std::runtime_error("Unsupported KTX2 texture layout");
+        if (texture.width == 0 || texture.height == 0 || header.levelCount == 0 || header.levelCount > mipLevelCount(texture.width, texture.height))
+            throw std::runtime_error("Invalid KTX2 texture size");
+        if (sizeof(header) + header.levelCount * sizeof(Ktx2Level) > file.size())
+            throw std::runtime_error("Truncated KTX2 level index");
+
+        for (uint32_t level = 0; level < header.levelCount; level++)
+        {
+            Ktx2Level levelInfo{};
+            std::memcpy(&levelInfo, file.data() + sizeof(header) + level * sizeof(Ktx2Level), sizeof(levelInfo));
+            const size_t expectedSize = levelSize(texture.format, std::max(texture.width >> level, 1u), std::max(texture.height >> level, 1u));
+            if (levelInfo.byteLength < expectedSize || levelInfo.byteOffset > file.size() || levelInfo.byteLength > file.size() - levelInfo.byteOffset)
+                throw std::runtime_error("KTX2 level out of the file range");
+            texture.levels.push_back(file.subspan(levelInfo.byteOffset, expectedSize));
+        }
+
+        //Key/value pairs, only the swizzle matters
+        if (uint64_t(header.kvdByteOffset) + header.kvdByteLength <= file.size())
+        {
+            const std::byte* kvd = file.data() + header.kvdByteOffset;
+            for (uint32_t offset = 0; offset + sizeof(uint32_t) <= header.kvdByteLength;)
+            {
+                uint32_t length = 0;
+                std::memcpy(&length, kvd + offset, sizeof(length));
+                offset += sizeof(length);
+                if (length > header.kvdByteLength - offset)
+                    break;
+                std::string_view entry(reinterpret_cast<const char*>(kvd + offset), length);
+                if (entry.starts_with(std::string_view("KTXswizzle\0", 11)) && entry.size() >= 15)
+                    std::memcpy(texture.swizzle, entry.data() + 11, 4);
+                offset = (offset + length + 3) & ~3u;
+            }
+        }
+        return texture;
+    }
+
+    //The levels from firstLevel on, as a texture whose level 0 is firstLevel. The levels still point into the source memory
+    BlockTexture mipChainFrom(const BlockTexture& texture, uint32_t firstLevel)
+    {
+        if (firstLevel >= texture.levels.size())
+            throw std::out_of_range("Mip chain starts after the last level");
+        BlockTexture chain{};
+        chain.format = texture.format;
+        chain.width = std::max(texture.width >> firstLevel, 1u);
+        chain.height = std::max(texture.height >> firstLevel, 1u);
+        std::memcpy(chain.swizzle, texture.swizzle, sizeof(chain.swizzle));
+        chain.levels.assign(texture.levels.begin() + firstLevel, texture.levels.end());
+        return chain;
+    }
+#ifdef _MSC_VER
+#pragma endregion
+#endif
+
+    //Decodes an image file, or an image embedded in a range of a file, and writes its compressed mip chain
+    bool bakeTexture(const std::filesystem::path& imagePath, uint64_t offset, uint64_t size, TextureUsage usage, const std::filesystem::path& outPath)
+    {
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        stbi_uc* pixels = nullptr;
+        try {
+            SerializationTools::MappedFile file(imagePath);
+            if (size == 0)
+                size = file.size() - std::min<uint64_t>(offset, file.size());
+            if (offset + size > file.size())
+                return false;
+            pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.data() + offset), static_cast<int>(size), &width, &height, &channels, STBI_rgb_alpha);
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+        if (pixels == nullptr)
+            return false;
+
+        BlockTexture texture = compressTexture(pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height), usage);
+        stbi_image_free(pixels);
+        writeKtx2(outPath, texture);
+        return true;
+    }
+
+    //Transcodes the textures of the materials to KTX2 files in baked_assets/, the materials are changed to reference them
+    //Images that can't be decoded keep their reference and are loaded uncompressed at runtime, external images are added to the model sources
+    TextureBakeStatistics bakeMaterialTextures(const std::filesystem::path& modelPath, std::vector<SerializationTools::BakedMaterial>& materials, std::vector<std::filesystem::path>& outSourceFiles)
+    {
+        static const TextureUsage SLOT_USAGES[SerializationTools::BakedTextureSlotCount] = {
+            ColorTextureUsage, //Albedo
+            NormalTextureUsage, //Normal
+            MetallicRoughnessTextureUsage, //Metallic roughness
+            ColorTextureUsage, //Emissive
+        };
+        static const char* USAGE_SUFFIXES[] = { ".color.ktx2", ".normal.ktx2", ".mr.ktx2" };
+
+        auto start = std::chrono::high_resolution_clock::now();
+        TextureBakeStatistics statistics{};
+        const std::filesystem::path modelDirectory = modelPath.parent_path();
+        const std::filesystem::path bakedDirectory = SerializationTools::bakedModelPath(modelPath).parent_path();
+        std::unordered_map<std::string, std::string> bakedTextures; //Source image and usage to the KTX2 path, empty when the image can't be compressed
+
+        for (auto& material : materials)
+        {
+            for (uint32_t slot = 0; slot < SerializationTools::BakedTextureSlotCount; slot++)
+            {
+                SerializationTools::BakedTexture& texture = material.textures[slot];
+                if (texture.path[0] == '\0')
+                    continue;
+                const std::filesystem::path source = modelDirectory / texture.path;
+                if (source.extension() == ".ktx2")
+                    continue;
+
+                const TextureUsage usage = SLOT_USAGES[slot];
+                std::string key = source.generic_string() + "@" + std::to_string(texture.offset) + "#" + std::to_string(usage);
+                auto baked = bakedTextures.find(key);
+                if (baked == bakedTextures.end())
+                {
+                    std::string name = source.filename().string() + (texture.size != 0 ? "." + std::to_string(texture.offset) : "") + USAGE_SUFFIXES[usage];
+                    std::filesystem::path outPath = bakedDirectory / name;
+                    std::string relativePath = std::filesystem::relative(outPath, modelDirectory).generic_string();
+
+                    std::error_code error;
+                    bool isReused = std::filesystem::exists(outPath, error) && std::filesystem::last_write_time(outPath, error) >= std::filesystem::last_write_time(source, error) && !error;
+                    bool isBaked = relativePath.size() < SerializationTools::BAKED_PATH_LENGTH && (isReused || bakeTexture(source, texture.offset, texture.size, usage, outPath));
+                    if (isBaked)
+                    {
+                        SerializationTools::MappedFile file(outPath);
+                        BlockTexture compressed = readKtx2(std::span<const std::byte>(file.data(), file.size()));
+                        for (uint32_t level = 0; level < compressed.levels.size(); level++)
+                            statistics.uncompressedSize += uint64_t(std::max(compressed.width >> level, 1u)) * std::max(compressed.height >> level, 1u) * 4;
+                        statistics.compressedSize += file.size();
+                        statistics.textureCount++;
+                        statistics.reusedCount += isReused;
+                    }
+                    else
+                    {
+                        std::cerr << "Texture " << source << " was not compressed, it will be loaded as RGBA8" << std::endl;
+                        statistics.failedCount++;
+                    }
+                    baked = bakedTextures.emplace(key, isBaked ? relativePath : std::string()).first;
+                }
+
+                //Edits of external images have to trigger a new bake, embedded ones are already covered by their buffer file
+                std::error_code error;
+                if (texture.size == 0 && std::filesystem::exists(source, error) && std::find(outSourceFiles.begin(), outSourceFiles.end(), source) == outSourceFiles.end())
+                    outSourceFiles.push_back(source);
+
+                if (!baked->second.empty())
+                {
+                    SerializationTools::setBakedPath(texture.path, baked->second);
+                    texture.offset = 0;
+                    texture.size = 0;
+                }
+            }
+        }
+        statistics.seconds = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+        return statistics;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "Defs.h"
+#include "SerializationTools.h"
+#include <span>
+
+//Offline texture baking: CPU mip chains, BC4/BC5/BC7 block compression and KTX2 files, nothing here touches Vulkan objects
+//Baked textures are uploaded as is by VulkanImage, without any decoding or runtime mip generation
+namespace TextureTools {
+    //What a texture holds, decides its block format and how its mips are filtered
+    enum TextureUsage : uint32_t {
+        ColorTextureUsage, //sRGB color with alpha: BC7
+        NormalTextureUsage, //Tangent space normal: BC5 xy, z is rebuilt by the shaders
+        MetallicRoughnessTextureUsage, //glTF G: roughness, B: metallic: BC5, or BC4 roughness when metallic is constant 0 or 1
+    };
+
+    constexpr uint32_t KTX2_ALIGNMENT = 16; //Level data alignment, a multiple of every block size
+
+    //Block compressed mip chain, level 0 is the largest
+    struct BlockTexture {
+        vk::Format format = vk::Format::eUndefined;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        char swizzle[4] = { 'r', 'g', 'b', 'a' }; //KTXswizzle: source of each sampled component, one of rgba01
+        std::vector<std::span<const std::byte>> levels; //Point into data, or into the file the texture was read from
+        std::vector<std::byte> data;
+    };
+
+    //Textures transcoded by bakeMaterialTextures
+    struct TextureBakeStatistics {
+        size_t textureCount = 0;
+        size_t reusedCount = 0; //KTX2 files newer than their source image
+        size_t failedCount = 0; //Left uncompressed, loaded as RGBA8 at runtime
+        uint64_t uncompressedSize = 0; //RGBA8 with a full mip chain
+        uint64_t compressedSize = 0;
+        float seconds = 0.0f;
+    };
+
+    [[nodiscard]]uint32_t blockSize(vk::Format format);
+    [[nodiscard]]uint32_t mipLevelCount(uint32_t width, uint32_t height);
+    [[nodiscard]]BlockTexture compressTexture(const uint8_t* rgbaPixels, uint32_t width, uint32_t height, TextureUsage usage);
+    void writeKtx2(const std::filesystem::path& path, const BlockTexture& texture);
+    [[nodiscard]]BlockTexture readKtx2(std::span<const std::byte> file);
+    [[nodiscard]]BlockTexture mipChainFrom(const BlockTexture& texture, uint32_t firstLevel);
+    bool bakeTexture(const std::filesystem::path& imagePath, uint64_t offset, uint64_t size, TextureUsage usage, const std::filesystem::path& outPath);
+    TextureBakeStatistics bakeMaterialTextures(const std::filesystem::path& modelPath, std::vector<SerializationTools::BakedMaterial>& materials, std::vector<std::filesystem::path>& outSourceFiles);
+}
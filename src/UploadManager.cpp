@@ -0,0 +1,335 @@
+#include "UploadManager.h"
+#include "VulkanContext.h"
+
+#include <exception>
+
+UploadManager::UploadManager(VulkanContext* context)
+{
+	m_context = context;
+	m_device = context->getDevice();
+	m_allocator = context->getAllocator();
+	QueueFamilyIndices queueIndices = context->getQueueFamilyIndices();
+	m_transferFamily = queueIndices.transferFamily.value();
+	m_graphicsFamily = queueIndices.graphicsFamily.value();
+	m_transferCommandPool = context->createCommandPool(m_transferFamily);
+	m_graphicsCommandPool = m_transferFamily != m_graphicsFamily ? context->createCommandPool(m_graphicsFamily) : m_transferCommandPool;
+
+	vk::SemaphoreTypeCreateInfo timelineInfo{
+		.semaphoreType = vk::SemaphoreType::eTimeline,
+		.initialValue = 0,
+	};
+	m_timeline = m_device.createSemaphore(vk::SemaphoreCreateInfo{ .pNext = &timelineInfo });
+	m_transferTimeline = m_device.createSemaphore(vk::SemaphoreCreateInfo{ .pNext = &timelineInfo });
+
+	//Mapped once, loader threads write their data straight into it
+	m_stagingBuffer = context->createBuffer(UPLOAD_STAGING_SIZE, vk::BufferUsageFlagBits::eTransferSrc, vma::MemoryUsage::eCpuToGpu, "Upload staging ring");
+	m_stagingData = static_cast<std::byte*>(m_allocator->mapMemory(m_stagingBuffer.m_Allocation));
+}
+
+UploadManager::~UploadManager()
+{
+	waitIdle();
+	m_allocator->unmapMemory(m_stagingBuffer.m_Allocation);
+	m_allocator->destroyBuffer(m_stagingBuffer.m_Buffer, m_stagingBuffer.m_Allocation);
+	m_device.destroySemaphore(m_transferTimeline);
+	m_device.destroySemaphore(m_timeline);
+	if (m_graphicsCommandPool != m_transferCommandPool)
+		m_device.destroyCommandPool(m_graphicsCommandPool);
+	m_device.destroyCommandPool(m_transferCommandPool);
+}
+
+//Returns the batch uploads are recorded into, starting a new one when the last was closed
+UploadManager::UploadBatch& UploadManager::openBatch()
+{
+	if (!m_batches.empty() && !m_batches.back().isClosed)
+		return m_batches.back();
+
+	vk::CommandBufferAllocateInfo allocInfo{
+		.commandPool = m_transferCommandPool,
+		.level = vk::CommandBufferLevel::ePrimary,
+		.commandBufferCount = 1,
+	};
+	UploadBatch& batch = m_batches.emplace_back();
+	batch.commands.transferFamily = m_transferFamily;
+	batch.commands.graphicsFamily = m_graphicsFamily;
+	batch.commands.transfer = m_device.allocateCommandBuffers(allocInfo)[0];
+	batch.commands.transfer.begin(vk::CommandBufferBeginInfo{ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+	batch.commands.graphics = batch.commands.transfer;
+	if (batch.commands.transfersOwnership())
+	{
+		allocInfo.commandPool = m_graphicsCommandPool;
+		batch.commands.graphics = m_device.allocateCommandBuffers(allocInfo)[0];
+		batch.commands.graphics.begin(vk::CommandBufferBeginInfo{ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+	}
+	batch.timelineValue = ++m_lastTimelineValue;
+	batch.stagingEnd = m_stagingHead;
+	return batch;
+}
+
+//Submits, in order, every batch up to timelineValue once their data is written
+void UploadManager::submitBatches(std::unique_lock<std::mutex>& lock, uint64_t timelineValue)
+{
+	if (!m_batches.empty() && m_batches.back().timelineValue <= timelineValue)
+		m_batches.back().isClosed = true;
+
+	while (m_lastSubmittedValue < std::min(timelineValue, m_lastTimelineValue))
+	{
+		//Batches are never retired before being submitted, the next one to submit is still in the queue
+		auto batch = std::find_if(m_batches.begin(), m_batches.end(), [](const UploadBatch& batch) { return !batch.isSubmitted; });
+		if (batch->pendingWrites > 0)
+		{
+			m_writesDone.wait(lock);
+			continue;
+		}
+
+		std::vector<vk::Semaphore> waitSemaphores;
+		std::vector<uint64_t> waitValues;
+		std::vector<vk::PipelineStageFlags> waitStages;
+		batch->commands.transfer.end();
+		if (batch->commands.transfersOwnership())
+		{
+			//The copies signal the transfer timeline, the acquires wait for it on the graphics queue
+			vk::TimelineSemaphoreSubmitInfo transferTimelineInfo{
+				.signalSemaphoreValueCount = 1,
+				.pSignalSemaphoreValues = &batch->timelineValue,
+			};
+			vk::SubmitInfo transferSubmitInfo{
+				.pNext = &transferTimelineInfo,
+				.commandBufferCount = 1,
+				.pCommandBuffers = &batch->commands.transfer,
+				.signalSemaphoreCount = 1,
+				.pSignalSemaphores = &m_transferTimeline,
+			};
+			m_context->submitToTransferQueue(transferSubmitInfo);
+			batch->commands.graphics.end();
+			waitSemaphores.push_back(m_transferTimeline);
+			waitValues.push_back(batch->timelineValue);
+			waitStages.push_back(vk::PipelineStageFlagBits::eAllCommands);
+		}
+
+		vk::TimelineSemaphoreSubmitInfo timelineInfo{
+			.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size()),
+			.pWaitSemaphoreValues = waitValues.data(),
+			.signalSemaphoreValueCount = 1,
+			.pSignalSemaphoreValues = &batch->timelineValue,
+		};
+		vk::SubmitInfo submitInfo{
+			.pNext = &timelineInfo,
+			.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size()),
+			.pWaitSemaphores = waitSemaphores.data(),
+			.pWaitDstStageMask = waitStages.data(),
+			.commandBufferCount = 1,
+			.pCommandBuffers = &batch->commands.graphics,
+			.signalSemaphoreCount = 1,
+			.pSignalSemaphores = &m_timeline,
+		};
+		m_context->submitToGraphicsQueue(submitInfo);
+		batch->isSubmitted = true;
+		m_lastSubmittedValue = batch->timelineValue;
+		m_submitCount++;
+	}
+}
+
+//Frees the command buffers and the staging memory of the batches the GPU is done with
+void UploadManager::retireBatches()
+{
+	const uint64_t completedValue = m_device.getSemaphoreCounterValue(m_timeline);
+	while (!m_batches.empty() && m_batches.front().isSubmitted && m_batches.front().timelineValue <= completedValue)
+	{
+		UploadBatch& batch = m_batches.front();
+		m_device.freeCommandBuffers(m_transferCommandPool, batch.commands.transfer);
+		if (batch.commands.transfersOwnership())
+			m_device.freeCommandBuffers(m_graphicsCommandPool, batch.commands.graphics);
+		for (const VulkanBuffer& buffer : batch.dedicatedBuffers)
+		{
+			m_allocator->destroyBuffer(buffer.m_Buffer, buffer.m_Allocation);
+		}
+		m_stagingTail = std::max(m_stagingTail, batch.stagingEnd);
+		m_batches.pop_front();
+	}
+}
+
+//Submits what is needed and blocks until the GPU reached timelineValue, other threads keep recording meanwhile
+void UploadManager::waitForValue(std::unique_lock<std::mutex>& lock, uint64_t timelineValue)
+{
+	submitBatches(lock, timelineValue);
+	lock.unlock();
+	vk::SemaphoreWaitInfo waitInfo{
+		.semaphoreCount = 1,
+		.pSemaphores = &m_timeline,
+		.pValues = &timelineValue,
+	};
+	if (m_device.waitSemaphores(waitInfo, UINT64_MAX) != vk::Result::eSuccess)
+		throw std::runtime_error("failed to wait for uploads!");
+	lock.lock();
+	retireBatches();
+}
+
+//Reserves size bytes of staging memory, lets fill write the data without holding the lock then records the upload commands
+uint64_t UploadManager::stage(vk::DeviceSize size, const FillFunction& fill, const std::function<void(const UploadCommands& commands, vk::Buffer stagingBuffer, vk::DeviceSize stagingOffset)>& record)
+{
+	std::unique_lock lock(m_mutex);
+	VulkanBuffer dedicatedBuffer{};
+	vk::Buffer stagingBuffer = m_stagingBuffer.m_Buffer;
+	vk::DeviceSize stagingOffset = 0;
+	if (size > UPLOAD_DEDICATED_SIZE)
+	{
+		//Too large for the ring, the upload gets its own staging buffer, released with its batch
+		dedicatedBuffer = m_context->createBuffer(size, vk::BufferUsageFlagBits::eTransferSrc, vma::MemoryUsage::eCpuToGpu, "Upload staging buffer");
+		stagingBuffer = dedicatedBuffer.m_Buffer;
+	}
+	else
+	{
+		//Waits for the oldest batches to free enough of the ring, a range never wraps around the end of the buffer
+		vk::DeviceSize position = 0;
+		while (true)
+		{
+			retireBatches();
+			position = (m_stagingHead + UPLOAD_STAGING_ALIGNMENT - 1) & ~(UPLOAD_STAGING_ALIGNMENT - 1);
+			if (position % UPLOAD_STAGING_SIZE + size > UPLOAD_STAGING_SIZE)
+				position += UPLOAD_STAGING_SIZE - position % UPLOAD_STAGING_SIZE;
+			//Nothing in flight, the whole ring is free: the padding skipped at its end is not counted against the upload
+			if (m_batches.empty())
+				m_stagingTail = position;
+			if (position + size - m_stagingTail <= UPLOAD_STAGING_SIZE)
+				break;
+			assert(!m_batches.empty());
+			waitForValue(lock, m_batches.front().timelineValue);
+		}
+		m_stagingHead = position + size;
+		stagingOffset = position % UPLOAD_STAGING_SIZE;
+	}
+
+	//The batch is only submitted once every upload reserved in it is written and recorded
+	UploadBatch& batch = openBatch();
+	batch.size += size;
+	batch.pendingWrites++;
+	if (!dedicatedBuffer.m_Buffer)
+		batch.stagingEnd = m_stagingHead;
+	const uint64_t timelineValue = batch.timelineValue;
+	lock.unlock();
+
+	std::byte* stagingData = dedicatedBuffer.m_Buffer ? static_cast<std::byte*>(m_allocator->mapMemory(dedicatedBuffer.m_Allocation)) : m_stagingData + stagingOffset;
+	std::exception_ptr fillException;
+	try {
+		fill(stagingData);
+	}
+	catch (...)
+	{
+		fillException = std::current_exception();
+	}
+	if (dedicatedBuffer.m_Buffer)
+		m_allocator->unmapMemory(dedicatedBuffer.m_Allocation);
+
+	lock.lock();
+	//The batch can't be submitted nor retired while it has pending writes, the reference is still valid
+	//Commands are recorded once the data is written: an upload whose fill threw copies nothing, its ring range is just freed with the batch
+	if (!fillException)
+	{
+		record(batch.commands, stagingBuffer, stagingOffset);
+		if (dedicatedBuffer.m_Buffer)
+			batch.dedicatedBuffers.push_back(dedicatedBuffer);
+	}
+	else if (dedicatedBuffer.m_Buffer)
+	{
+		m_allocator->destroyBuffer(dedicatedBuffer.m_Buffer, dedicatedBuffer.m_Allocation);
+	}
+	batch.pendingWrites--;
+	m_writesDone.notify_all();
+	if (fillException)
+		std::rethrow_exception(fillException);
+
+	if (batch.size >= UPLOAD_BATCH_SIZE && !batch.isClosed)
+		submitBatches(lock, timelineValue);
+	return timelineValue;
+}
+
+uint64_t UploadManager::upload(const std::vector<std::span<const std::byte>>& ranges, const RecordFunction& record)
+{
+	std::vector<vk::DeviceSize> offsets;
+	vk::DeviceSize size = 0;
+	for (const auto& range : ranges)
+	{
+		size = (size + UPLOAD_STAGING_ALIGNMENT - 1) & ~(UPLOAD_STAGING_ALIGNMENT - 1);
+		offsets.push_back(size);
+		size += range.size();
+	}
+
+	return stage(size, [&](std::byte* data) {
+		for (size_t i = 0; i < ranges.size(); i++)
+		{
+			memcpy(data + offsets[i], ranges[i].data(), ranges[i].size());
+		}
+	}, [&](const UploadCommands& commands, vk::Buffer stagingBuffer, vk::DeviceSize stagingOffset) {
+		std::vector<vk::DeviceSize> bufferOffsets = offsets;
+		for (vk::DeviceSize& offset : bufferOffsets)
+		{
+			offset += stagingOffset;
+		}
+		record(commands, stagingBuffer, bufferOffsets);
+	});
+}
+
+uint64_t UploadManager::uploadBuffer(vk::Buffer buffer, vk::DeviceSize size, const FillFunction& fill)
+{
+	return stage(size, fill, [&](const UploadCommands& commands, vk::Buffer stagingBuffer, vk::DeviceSize stagingOffset) {
+		commands.transfer.copyBuffer(stagingBuffer, buffer, vk::BufferCopy{ .srcOffset = stagingOffset, .dstOffset = 0, .size = size });
+
+		//On a single queue family, the timeline wait of the frames already makes the copy visible
+		if (commands.transfersOwnership())
+		{
+			vk::BufferMemoryBarrier barrier{
+				.srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+				.dstAccessMask = {}, //Ignored by the release
+				.srcQueueFamilyIndex = commands.transferFamily,
+				.dstQueueFamilyIndex = commands.graphicsFamily,
+				.buffer = buffer,
+				.offset = 0,
+				.size = VK_WHOLE_SIZE,
+			};
+			commands.transfer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr, barrier, nullptr);
+			barrier.srcAccessMask = {}; //Ignored by the acquire
+			barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+			commands.graphics.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eAllCommands, {}, nullptr, barrier, nullptr);
+		}
+	});
+}
+
+uint64_t UploadManager::flush()
+{
+	std::unique_lock lock(m_mutex);
+	submitBatches(lock, m_lastTimelineValue);
+	retireBatches();
+	return m_lastSubmittedValue;
+}
+
+//Non blocking, streaming code polls this before using what it uploaded
+bool UploadManager::isComplete(uint64_t timelineValue)
+{
+	return m_device.getSemaphoreCounterValue(m_timeline) >= timelineValue;
+}
+
+void UploadManager::wait(uint64_t timelineValue)
+{
+	std::unique_lock lock(m_mutex);
+	waitForValue(lock, timelineValue);
+}
+
+//Waits for every upload, before destroying the resources they write
+void UploadManager::waitIdle()
+{
+	std::unique_lock lock(m_mutex);
+	waitForValue(lock, m_lastTimelineValue);
+}
+
+vk::Semaphore UploadManager::getTimelineSemaphore() const
+{
+	return m_timeline;
+}
+
+//Number of batch submissions done for every upload so far
+size_t UploadManager::getSubmitCount()
+{
+	std::lock_guard lock(m_mutex);
+	return m_submitCount;
+}
@@ -0,0 +1,98 @@
+/*
+author: Pyrrha Tocquet
+date: 17/10/26
+desc: Batches the uploads of textures and buffers: data is copied to a shared staging ring and the copies of many resources are recorded into one command buffer
+The copies run on the transfer queue when the device has one, the resources are then released to the graphics queue which acquires them (and generates the mips)
+Batches signal a timeline semaphore, uploads return the value to wait on: loader threads only block when the staging ring is full and frames wait on the GPU
+*/
+
+#pragma once
+#include "Defs.h"
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <span>
+
+class VulkanContext;
+
+constexpr vk::DeviceSize UPLOAD_STAGING_SIZE = 64 << 20; //Staging ring shared by every upload
+constexpr vk::DeviceSize UPLOAD_BATCH_SIZE = UPLOAD_STAGING_SIZE / 4; //Batches are submitted once they hold that much, so that the GPU starts early
+constexpr vk::DeviceSize UPLOAD_DEDICATED_SIZE = UPLOAD_STAGING_SIZE / 2; //Larger uploads get their own staging buffer: they might not fit next to the padding skipped at the end of the ring
+constexpr vk::DeviceSize UPLOAD_STAGING_ALIGNMENT = 16; //Buffer offsets of image copies are multiples of the texel block size
+
+//Command buffers an upload is recorded into
+struct UploadCommands {
+	vk::CommandBuffer transfer = VK_NULL_HANDLE; //Copies from the staging memory, runs on the transfer queue
+	vk::CommandBuffer graphics = VK_NULL_HANDLE; //Ownership acquires and blits, runs on the graphics queue after the transfer buffer. Same buffer when both queues are the same family
+	uint32_t transferFamily = 0;
+	uint32_t graphicsFamily = 0;
+
+	//The resources have to be released by the transfer queue and acquired by the graphics queue
+	[[nodiscard]] bool transfersOwnership() const { return transferFamily != graphicsFamily; }
+};
+
+class UploadManager
+{
+public:
+	//Records the commands of an upload: the staging buffer and the offset of each range in it
+	using RecordFunction = std::function<void(const UploadCommands& commands, vk::Buffer stagingBuffer, const std::vector<vk::DeviceSize>& offsets)>;
+	//Writes the data of an upload straight into the staging memory
+	using FillFunction = std::function<void(std::byte* data)>;
+private:
+	struct UploadBatch {
+		UploadCommands commands;
+		uint64_t timelineValue = 0; //Signaled once the batch ran on the GPU
+		vk::DeviceSize stagingEnd = 0; //Staging ring position freed when the batch is retired
+		vk::DeviceSize size = 0;
+		uint32_t pendingWrites = 0; //Uploads still copying their data to the staging memory
+		bool isClosed = false; //No more uploads are recorded, waiting for its writes to be submitted
+		bool isSubmitted = false;
+		std::vector<VulkanBuffer> dedicatedBuffers; //Staging of the uploads larger than UPLOAD_DEDICATED_SIZE
+	};
+
+	VulkanContext* m_context;
+	vk::Device m_device;
+	vma::Allocator* m_allocator;
+	uint32_t m_transferFamily;
+	uint32_t m_graphicsFamily;
+
+	std::mutex m_mutex; //Guards the batches, the ring positions and the command pools
+	std::condition_variable m_writesDone;
+	vk::CommandPool m_transferCommandPool = VK_NULL_HANDLE;
+	vk::CommandPool m_graphicsCommandPool = VK_NULL_HANDLE; //Same pool as the transfer one when the families are the same
+	vk::Semaphore m_transferTimeline = VK_NULL_HANDLE; //Signaled by the copies, waited by the acquires
+	vk::Semaphore m_timeline = VK_NULL_HANDLE; //Signaled once the resources can be used by the graphics queue
+	std::deque<UploadBatch> m_batches; //Not retired yet, in submission order
+	uint64_t m_lastTimelineValue = 0;
+	uint64_t m_lastSubmittedValue = 0;
+	size_t m_submitCount = 0;
+
+	VulkanBuffer m_stagingBuffer;
+	std::byte* m_stagingData = nullptr;
+	vk::DeviceSize m_stagingHead = 0; //Ring positions grow forever, the buffer offset is the position modulo UPLOAD_STAGING_SIZE
+	vk::DeviceSize m_stagingTail = 0;
+
+	UploadBatch& openBatch();
+	void submitBatches(std::unique_lock<std::mutex>& lock, uint64_t timelineValue);
+	void retireBatches();
+	void waitForValue(std::unique_lock<std::mutex>& lock, uint64_t timelineValue);
+	uint64_t stage(vk::DeviceSize size, const FillFunction& fill, const std::function<void(const UploadCommands& commands, vk::Buffer stagingBuffer, vk::DeviceSize stagingOffset)>& record);
+public:
+	UploadManager(VulkanContext* context);
+	~UploadManager();
+	UploadManager(const UploadManager&) = delete;
+	UploadManager& operator=(const UploadManager&) = delete;
+
+	//Copies the ranges to staging memory and records their commands in the current batch, returns the timeline value signaled once they ran
+	uint64_t upload(const std::vector<std::span<const std::byte>>& ranges, const RecordFunction& record);
+	//Fills the whole buffer from the staging memory, returns the timeline value signaled once it can be read by shaders
+	uint64_t uploadBuffer(vk::Buffer buffer, vk::DeviceSize size, const FillFunction& fill);
+	//Submits every recorded upload, returns the timeline value signaled once they all ran
+	uint64_t flush();
+	[[nodiscard]] bool isComplete(uint64_t timelineValue);
+	void wait(uint64_t timelineValue);
+	void waitIdle();
+	[[nodiscard]] vk::Semaphore getTimelineSemaphore() const;
+	[[nodiscard]] size_t getSubmitCount();
+};
@@ -1,4 +1,5 @@
 #include "VulkanContext.h"
+#include "UploadManager.h"
 #include <set>
 
 
@@ -34,6 +35,7 @@ VulkanContext::VulkanContext()
 
 VulkanContext::~VulkanContext()
 {
+	delete m_uploadManager;
 
 	for (auto& imageView : m_swapchainImageViews) {
 		m_device.destroyImageView(imageView);
@@ -73,6 +75,7 @@ void VulkanContext::init()
 	pfnCmdDebugMarkerInsert = (PFN_vkCmdDebugMarkerInsertEXT)vkGetDeviceProcAddr(m_device, "vkCmdDebugMarkerInsertEXT");
 	m_commandPool = createCommandPool();
 	createAllocator();
+	m_uploadManager = new UploadManager(this);
 	createSwapchain();
 }
 
@@ -252,16 +255,19 @@ bool VulkanContext::isDeviceSuitable(const vk::PhysicalDevice &device)
 
 	bool extensionsSupported = checkDeviceExtensionsSupport(device, requiredExtensions);
 	bool swapchainAdequate = false;
+	bool nullDescriptorSupported = false;
 	QueueFamilyIndices indices = findQueueFamilies(device);
 
 	if (extensionsSupported)
 	{
 		SwapchainSupportDetails swapchainSupport = querySwapchainSupport(device);
 		swapchainAdequate = !swapchainSupport.formats.empty() && !swapchainSupport.presentModes.empty();
+		auto features = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceRobustness2FeaturesEXT>();
+		nullDescriptorSupported = features.get<vk::PhysicalDeviceRobustness2FeaturesEXT>().nullDescriptor;
 	}
 
 	//TODO Better physical device features management ( physicalDeviceFeatures.samplerAnisotropy; alone)
-	return indices.isComplete() && extensionsSupported && swapchainAdequate && physicalDeviceFeatures.samplerAnisotropy && physicalDeviceFeatures.shaderSampledImageArrayDynamicIndexing && physicalDeviceFeatures.fillModeNonSolid;
+	return indices.isComplete() && extensionsSupported && swapchainAdequate && nullDescriptorSupported && physicalDeviceFeatures.samplerAnisotropy && physicalDeviceFeatures.textureCompressionBC && physicalDeviceFeatures.shaderSampledImageArrayDynamicIndexing && physicalDeviceFeatures.fillModeNonSolid && physicalDeviceFeatures.fragmentStoresAndAtomics;
 
 }
 
@@ -369,6 +375,27 @@ void VulkanContext::pickPhysicalDevice() {
 #pragma endregion
 
 #pragma region QUEUES
+//Finds a family made for transfers only (usually the DMA engines), copies there run alongside rendering
+static std::optional<uint32_t> findTransferFamily(const std::vector<vk::QueueFamilyProperties>& queueFamilies)
+{
+	std::optional<uint32_t> transferFamily;
+	for (uint32_t i = 0; i < queueFamilies.size(); i++)
+	{
+		const vk::QueueFamilyProperties& queueFamily = queueFamilies[i];
+		//Image copies of any extent need a 1x1x1 granularity
+		const vk::Extent3D& granularity = queueFamily.minImageTransferGranularity;
+		if (queueFamily.queueCount == 0 || !(queueFamily.queueFlags & vk::QueueFlagBits::eTransfer) || (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics)
+			|| granularity.width != 1 || granularity.height != 1 || granularity.depth != 1)
+			continue;
+		//Async compute families are only used when there is no pure transfer one
+		if (!(queueFamily.queueFlags & vk::QueueFlagBits::eCompute))
+			return i;
+		if (!transferFamily.has_value())
+			transferFamily = i;
+	}
+	return transferFamily;
+}
+
 //Finds queue families for the physical device passed as arguments
 QueueFamilyIndices VulkanContext::findQueueFamilies(const vk::PhysicalDevice& physicalDevice) const{
 	QueueFamilyIndices indices;
@@ -391,6 +418,9 @@ QueueFamilyIndices VulkanContext::findQueueFamilies(const vk::PhysicalDevice& ph
 		i++;
 		
 	}
+	indices.transferFamily = findTransferFamily(queueFamilies);
+	if (!indices.transferFamily.has_value())
+		indices.transferFamily = indices.graphicsFamily;
 	return indices;
 }
 
@@ -416,6 +446,9 @@ QueueFamilyIndices VulkanContext::findQueueFamilies() const {
 		i++;
 
 	}
+	indices.transferFamily = findTransferFamily(queueFamilies);
+	if (!indices.transferFamily.has_value())
+		indices.transferFamily = indices.graphicsFamily;
 	return indices;
 }
 
@@ -427,6 +460,36 @@ vk::Queue VulkanContext::getPresentQueue() {
 	return m_presentQueue;
 }
 
+QueueFamilyIndices VulkanContext::getQueueFamilyIndices() const {
+	return m_queueIndices;
+}
+
+void VulkanContext::submitToGraphicsQueue(const vk::SubmitInfo& submitInfo, vk::Fence fence)
+{
+	std::lock_guard<std::mutex> lock(m_graphicsQueueMutex);
+	m_graphicsQueue.submit(submitInfo, fence);
+}
+
+//Falls back to the graphics queue, and its lock, when the device has no transfer family
+void VulkanContext::submitToTransferQueue(const vk::SubmitInfo& submitInfo)
+{
+	if (m_queueIndices.transferFamily == m_queueIndices.graphicsFamily)
+	{
+		submitToGraphicsQueue(submitInfo);
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_transferQueueMutex);
+	m_transferQueue.submit(submitInfo);
+}
+
+//The present queue is often the graphics queue, it is locked the same way
+vk::Result VulkanContext::presentToQueue(const vk::PresentInfoKHR& presentInfo)
+{
+	std::lock_guard<std::mutex> lock(m_graphicsQueueMutex);
+	//Vulkan Hpp crashes for eErrorOutOfDateKHR
+	return static_cast<vk::Result>(vkQueuePresentKHR(static_cast<VkQueue>(m_presentQueue), reinterpret_cast<const VkPresentInfoKHR*>(&presentInfo)));
+}
+
 #pragma endregion
 
 #pragma region SURFACE
@@ -723,7 +786,7 @@ void VulkanContext::createLogicalDevice()
 	QueueFamilyIndices indices = findQueueFamilies(m_physicalDevice);
 
 	std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
-	std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+	std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value(), indices.transferFamily.value() };
 
 	float queuePriority = 1.0f;
 	for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -739,12 +802,18 @@ void VulkanContext::createLogicalDevice()
 
 	//TODO Better Device Features management
 
-	vk::PhysicalDeviceMeshShaderFeaturesEXT meshShaderFeature{.taskShader = VK_TRUE, .meshShader = VK_TRUE, };
+	vk::PhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeature{ .timelineSemaphore = VK_TRUE, }; //Texture upload batches
+
+	vk::PhysicalDeviceRobustness2FeaturesEXT robustness2Feature{ .pNext = &timelineSemaphoreFeature, .nullDescriptor = VK_TRUE, }; //Released texture array elements
+
+	vk::PhysicalDeviceMeshShaderFeaturesEXT meshShaderFeature{.pNext = &robustness2Feature, .taskShader = VK_TRUE, .meshShader = VK_TRUE, };
 
 	vk::PhysicalDeviceFeatures deviceFeatures{
 		.sampleRateShading = VK_TRUE,
 		.fillModeNonSolid = VK_TRUE,
 		.samplerAnisotropy = VK_TRUE,
+		.textureCompressionBC = VK_TRUE, //Baked textures
+		.fragmentStoresAndAtomics = VK_TRUE, //Texture streaming feedback
 	};
 
 	vk::PhysicalDeviceSynchronization2Features synchronization2Feature{
@@ -755,6 +824,8 @@ void VulkanContext::createLogicalDevice()
 	vk::PhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures{
 		.pNext = &synchronization2Feature,
 		.shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
+		.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE, //Textures added or streamed are written in the bound texture arrays
+		.descriptorBindingUpdateUnusedWhilePending = VK_TRUE,
 		.descriptorBindingPartiallyBound = VK_TRUE,
 		.descriptorBindingVariableDescriptorCount = VK_TRUE,
 		.runtimeDescriptorArray = VK_TRUE,
@@ -787,6 +858,8 @@ void VulkanContext::createLogicalDevice()
 
 	m_device.getQueue(indices.graphicsFamily.value(), 0, &m_graphicsQueue);
 	m_device.getQueue(indices.presentFamily.value(), 0, &m_presentQueue);
+	m_device.getQueue(indices.transferFamily.value(), 0, &m_transferQueue);
+	m_queueIndices = indices;
 }
 
 #pragma endregion
@@ -895,46 +968,6 @@ VulkanBuffer VulkanContext::createBuffer(vk::DeviceSize size, vk::BufferUsageFla
 	return VulkanBuffer{ret.first, ret.second};
 }
 
-//Copies a srcBuffer to a dstBuffer (GPU execution)
-void VulkanContext::copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size) {
-	vk::CommandBuffer commandBuffer = beginSingleTimeCommands(m_commandPool);
-
-	vk::BufferCopy copyRegion{
-		.size = size,
-	};
-	commandBuffer.copyBuffer(srcBuffer, dstBuffer, copyRegion);
-	endSingleTimeCommands(commandBuffer, m_commandPool);
-}
-
-//Copies buffer data to an imageData
-void VulkanContext::copyBufferToImage(vk::Buffer buffer, vk::Image image, vk::CommandPool commandPool, uint32_t width, uint32_t height) {
-
-	vk::CommandBuffer commandBuffer = beginSingleTimeCommands(commandPool);
-
-	vk::BufferImageCopy region{
-		.bufferOffset = 0,
-		.bufferRowLength = 0,
-		.bufferImageHeight = 0, //0 : Simply tightly packed
-		.imageSubresource = {
-			.aspectMask = vk::ImageAspectFlagBits::eColor,
-			.mipLevel = 0,
-			.baseArrayLayer = 0,
-			.layerCount = 1,
-		},
-		.imageOffset = {0, 0, 0},
-		.imageExtent = {
-			.width = width,
-			.height = height,
-			.depth = 1,
-		}
-	};
-
-	commandBuffer.copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, region); 
-
-	endSingleTimeCommands(commandBuffer, commandPool);
-
-}
-
 //Finds a memory type that have the inputed properties
 uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
 	VkPhysicalDeviceMemoryProperties memProperties;
@@ -1005,14 +1038,18 @@ vk::FormatProperties VulkanContext::getFormatProperties(vk::Format format) const
 #pragma endregion
 
 #pragma region COMMAND_POOL
-//returns a new commandPool
+//returns a new commandPool for the graphics queue
 vk::CommandPool VulkanContext::createCommandPool()
 {
-	QueueFamilyIndices queueFamilyIndices = findQueueFamilies();
+	return createCommandPool(findQueueFamilies().graphicsFamily.value());
+}
 
+//returns a new commandPool for the queues of the family
+vk::CommandPool VulkanContext::createCommandPool(uint32_t queueFamilyIndex)
+{
 	vk::CommandPoolCreateInfo poolInfo{
 		.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer, //Hint that command buffers are rerecorded with new commands very often (VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT : Allow command buffers to be rerecorded individually, without this flag they all have to be reset together)
-		.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value()
+		.queueFamilyIndex = queueFamilyIndex
 	};
 
 	try {
@@ -1030,6 +1067,14 @@ vk::CommandPool VulkanContext::getCommandPool() {
 }
 #pragma endregion
 
+#pragma region UPLOADS
+//Texture and buffer uploads of every loader thread are batched by this manager
+UploadManager* VulkanContext::getUploadManager()
+{
+	return m_uploadManager;
+}
+#pragma endregion
+
 #pragma region IMGUI
 //IMGUI necessary Vulkan objects creation. Returns populated InitInfo
 ImGui_ImplVulkan_InitInfo VulkanContext::getImGuiInitInfo() {
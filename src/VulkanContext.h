@@ -22,10 +22,13 @@ desc: Manages Vulkan device, queues, swapchain, window and useful globals(time)
 #include <mutex>
 
 
+class UploadManager;
+
 /* STRUCTS */
 struct QueueFamilyIndices {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	std::optional<uint32_t> transferFamily; //Transfer only family when the device has one, the graphics family otherwise
 
 	bool isComplete() {
 		return graphicsFamily.has_value() && presentFamily.has_value();
@@ -47,7 +50,8 @@ const std::vector<const char*> validationLayers = {
 const std::vector<const char*> requiredExtensions = {
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME,
 	VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
-	VK_EXT_MESH_SHADER_EXTENSION_NAME
+	VK_EXT_MESH_SHADER_EXTENSION_NAME,
+	VK_EXT_ROBUSTNESS_2_EXTENSION_NAME //Null descriptors in the released texture array elements
 };
 
 /* CONSTANTS */
@@ -76,7 +80,8 @@ private:
 
 	std::mutex m_graphicsQueueMutex;
 	vk::Queue m_graphicsQueue = VK_NULL_HANDLE;
-
+	std::mutex m_transferQueueMutex;
+	vk::Queue m_transferQueue = VK_NULL_HANDLE;
 
 	vk::Queue m_presentQueue = VK_NULL_HANDLE;
 	vk::CommandPool m_commandPool = VK_NULL_HANDLE;
@@ -95,6 +100,8 @@ private:
 	
 	vk::DescriptorPool m_imGUIDescriptorPool = VK_NULL_HANDLE;
 
+	UploadManager* m_uploadManager = nullptr;
+
 	//TIME
 	Time m_time;
 
@@ -127,6 +134,11 @@ public:
 	[[nodiscard]] QueueFamilyIndices findQueueFamilies() const;
 	[[nodiscard]] vk::Queue getGraphicsQueue();
 	[[nodiscard]] vk::Queue getPresentQueue();
+	[[nodiscard]] QueueFamilyIndices getQueueFamilyIndices() const;
+	//The queues are shared with the upload batches, submissions from any thread go through these
+	void submitToGraphicsQueue(const vk::SubmitInfo& submitInfo, vk::Fence fence = VK_NULL_HANDLE);
+	void submitToTransferQueue(const vk::SubmitInfo& submitInfo);
+	[[nodiscard]] vk::Result presentToQueue(const vk::PresentInfoKHR& presentInfo);
 
 	//COMMAND POOL
 	[[nodiscard]] vk::CommandPool getCommandPool();
@@ -142,13 +154,15 @@ public:
 
 	//BUFFERS
 	[[nodiscard("Release the allocation when the buffer is no longer used")]] VulkanBuffer createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vma::MemoryUsage memoryUsage, std::string name);
-	void copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size);
-	void copyBufferToImage(vk::Buffer buffer, vk::Image image, vk::CommandPool commandPool, uint32_t width, uint32_t height);
 
 	//COMMAND BUFFERS
 	[[nodiscard("Call endSingleTimeCommands(returnValue) to end and submit the buffer")]] vk::CommandBuffer beginSingleTimeCommands(vk::CommandPool commandPool);
 	void endSingleTimeCommands(vk::CommandBuffer commandBuffer, vk::CommandPool commandPool);
 	[[nodiscard("Creation of unused command pools !")]] vk::CommandPool createCommandPool();
+	[[nodiscard("Creation of unused command pools !")]] vk::CommandPool createCommandPool(uint32_t queueFamilyIndex);
+
+	//UPLOADS
+	[[nodiscard]] UploadManager* getUploadManager();
 
 
 	//PROPERTIES
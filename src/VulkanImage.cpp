@@ -1,4 +1,6 @@
 #include "VulkanImage.h"
+#include "TextureTools.h"
+#include "UploadManager.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
@@ -41,6 +43,7 @@ void VulkanImage::constructVkImageView(VulkanContext* context, VulkanImageParams
 		.image = m_image,
 		.viewType = imageViewParams.type,
 		.format = imageParams.format,
+		.components = imageViewParams.components,
 		.subresourceRange {
 			.aspectMask = imageViewParams.aspectFlags,
 			.baseMipLevel = 0,
@@ -65,7 +68,6 @@ VulkanImage::VulkanImage(VulkanContext* context, VulkanImageParams imageParams,
 {
 	m_allocator = context->getAllocator();
 	m_device = context->getDevice();
-	m_commandPool = context->createCommandPool();
 	constructVkImage(context, imageParams);
 	constructVkImageView(context, imageParams, imageViewParams);
 }
@@ -73,32 +75,39 @@ VulkanImage::VulkanImage(VulkanContext* context, VulkanImageParams imageParams,
 //Constructor for textures
 VulkanImage::VulkanImage(VulkanContext* context, VulkanImageParams imageParams, VulkanImageViewParams imageViewParams, std::string path)
 {
-	m_allocator = context->getAllocator();
-	m_device = context->getDevice();
 	//Texture file read
 	int texWidth, texHeight, texChannels;
 	stbi_uc* pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha); //Forces the image to be loaded with an alpha channel for consistency
+	constructTexture(context, imageParams, imageViewParams, pixels, texWidth, texHeight, path);
+}
+
+//Constructor for textures already in memory as an encoded file (images embedded in glTF buffers)
+VulkanImage::VulkanImage(VulkanContext* context, VulkanImageParams imageParams, VulkanImageViewParams imageViewParams, std::span<const std::byte> encodedImage, std::string name)
+{
+	int texWidth, texHeight, texChannels;
+	stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(encodedImage.data()), static_cast<int>(encodedImage.size()), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+	constructTexture(context, imageParams, imageViewParams, pixels, texWidth, texHeight, name);
+}
+
+//Uploads decoded RGBA pixels and generates the mip chain, takes ownership of the pixels
+void VulkanImage::constructTexture(VulkanContext* context, VulkanImageParams imageParams, VulkanImageViewParams imageViewParams, stbi_uc* pixels, int texWidth, int texHeight, const std::string& name)
+{
+	m_allocator = context->getAllocator();
+	m_device = context->getDevice();
 	if (!pixels) {
-		std::cerr << "Image file " << path << " was not loaded" << std::endl;
+		std::cerr << "Image file " << name << " was not loaded" << std::endl;
 		m_loadingFailed = true;
 		return;
 	}
-	m_commandPool = context->createCommandPool();
 	//Highest number possible of miplevels
 	uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
 
-	//Staging buffer (CPU visible)
-	VulkanBuffer stagingBuffer;
-	vk::DeviceSize imageSize = texWidth * texHeight * 4;
-	stagingBuffer = context->createBuffer(imageSize, vk::BufferUsageFlagBits::eTransferSrc, vma::MemoryUsage::eCpuToGpu, "Vulkan Image Staging Buffer");
-
-	//Copy the pixel values to the buffer
-	void* data = context->getAllocator()->mapMemory(stagingBuffer.m_Allocation);
-	memcpy(data, pixels, static_cast<size_t>(imageSize));
-	context->getAllocator()->unmapMemory(stagingBuffer.m_Allocation);
-
-	//Remember to free !
-	stbi_image_free(pixels);
+	//Required for blitting the mips
+	if (!(context->getFormatProperties(imageParams.format).optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear))
+	{
+		stbi_image_free(pixels);
+		throw std::runtime_error("texture image format does not support linear blitting!");
+	}
 
 	//VkImage
 	imageParams.height = texHeight;
@@ -107,44 +116,122 @@ VulkanImage::VulkanImage(VulkanContext* context, VulkanImageParams imageParams,
 	imageParams.usage |= vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc;
 	constructVkImage(context, imageParams);
 
-	//Copy the staging buffer to the texture image
-	transitionImageLayout( context, imageParams.format, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, imageParams.mipLevels); 
-	context->copyBufferToImage(stagingBuffer.m_Buffer, m_image, m_commandPool, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-	m_allocator->destroyBuffer(stagingBuffer.m_Buffer, stagingBuffer.m_Allocation);
+	//The pixels go through the shared staging ring, the copy and the mips are recorded in the current upload batch
+	vk::DeviceSize imageSize = vk::DeviceSize(texWidth) * texHeight * 4;
+	m_uploadValue = context->getUploadManager()->upload({ std::span<const std::byte>(reinterpret_cast<const std::byte*>(pixels), imageSize) }, [&](const UploadCommands& commands, vk::Buffer stagingBuffer, const std::vector<vk::DeviceSize>& offsets) {
+		transitionImageLayout(commands.transfer, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, mipLevels);
+
+		vk::BufferImageCopy region{
+			.bufferOffset = offsets[0],
+			.bufferRowLength = 0,
+			.bufferImageHeight = 0, //0 : Simply tightly packed
+			.imageSubresource = {
+				.aspectMask = vk::ImageAspectFlagBits::eColor,
+				.mipLevel = 0,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			},
+			.imageOffset = {0, 0, 0},
+			.imageExtent = {
+				.width = static_cast<uint32_t>(texWidth),
+				.height = static_cast<uint32_t>(texHeight),
+				.depth = 1,
+			}
+		};
+		commands.transfer.copyBufferToImage(stagingBuffer, m_image, vk::ImageLayout::eTransferDstOptimal, region);
 
+		//Blits need a graphics queue: the image moves there to generate the mip maps, which transitions it to shader reading layout
+		transferOwnership(commands, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferDstOptimal, mipLevels);
+		generateMipmaps(commands.graphics, texWidth, texHeight, mipLevels);
+	});
 
-	//Generating the mip maps transitions the image to shader reading layout
-	generateMipmaps(context, m_image, imageParams.format, imageParams.width, imageParams.height, imageParams.mipLevels);
+	//Remember to free !
+	stbi_image_free(pixels);
 
 	//Image View
 	constructVkImageView(context, imageParams, imageViewParams);
-	m_allocator->setAllocationName(m_allocation, path.c_str());
+	m_allocator->setAllocationName(m_allocation, name.c_str());
 }
 
-
-VulkanImage::~VulkanImage()
+//KTXswizzle characters to the image view component swizzles
+static vk::ComponentSwizzle componentSwizzle(char swizzle)
 {
-	if (!m_loadingFailed)
+	switch (swizzle)
 	{
-		m_device.destroyCommandPool(m_commandPool);
-		m_allocator->destroyImage(m_image, m_allocation);
-		m_device.destroyImageView(m_imageView);
+	case 'r': return vk::ComponentSwizzle::eR;
+	case 'g': return vk::ComponentSwizzle::eG;
+	case 'b': return vk::ComponentSwizzle::eB;
+	case 'a': return vk::ComponentSwizzle::eA;
+	case '0': return vk::ComponentSwizzle::eZero;
+	case '1': return vk::ComponentSwizzle::eOne;
+	default: return vk::ComponentSwizzle::eIdentity;
 	}
 }
 
+//Constructor for baked textures: every level is copied in a single region list, the format and mips come from the file
+VulkanImage::VulkanImage(VulkanContext* context, VulkanImageParams imageParams, VulkanImageViewParams imageViewParams, const TextureTools::BlockTexture& texture, std::string name)
+{
+	m_allocator = context->getAllocator();
+	m_device = context->getDevice();
+	if (!(context->getFormatProperties(texture.format).optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage))
+	{
+		std::cerr << "Image file " << name << " uses a block format the device can't sample" << std::endl;
+		m_loadingFailed = true;
+		return;
+	}
+	imageParams.width = texture.width;
+	imageParams.height = texture.height;
+	imageParams.mipLevels = static_cast<uint32_t>(texture.levels.size());
+	imageParams.format = texture.format;
+	imageParams.usage |= vk::ImageUsageFlagBits::eTransferDst;
+	constructVkImage(context, imageParams);
 
-//Generates mipmaps for an image and converts it to shader read layout
-void VulkanImage::generateMipmaps(VulkanContext* context, vk::Image image, vk::Format imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {
-	vk::FormatProperties formatProperties = context->getFormatProperties(imageFormat);
+	//Every level goes through the shared staging ring, one copy region per level
+	m_uploadValue = context->getUploadManager()->upload(texture.levels, [&](const UploadCommands& commands, vk::Buffer stagingBuffer, const std::vector<vk::DeviceSize>& offsets) {
+		std::vector<vk::BufferImageCopy> regions;
+		for (uint32_t level = 0; level < imageParams.mipLevels; level++)
+		{
+			regions.push_back(vk::BufferImageCopy{
+				.bufferOffset = offsets[level],
+				.bufferRowLength = 0,
+				.bufferImageHeight = 0,
+				.imageSubresource = {
+					.aspectMask = vk::ImageAspectFlagBits::eColor,
+					.mipLevel = level,
+					.baseArrayLayer = 0,
+					.layerCount = 1,
+				},
+				.imageOffset = { 0, 0, 0 },
+				.imageExtent = { std::max(texture.width >> level, 1u), std::max(texture.height >> level, 1u), 1 },
+			});
+		}
+		transitionImageLayout(commands.transfer, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, imageParams.mipLevels);
+		commands.transfer.copyBufferToImage(stagingBuffer, m_image, vk::ImageLayout::eTransferDstOptimal, regions);
+		transferOwnership(commands, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, imageParams.mipLevels);
+	});
+
+	imageViewParams.components = vk::ComponentMapping{
+		.r = componentSwizzle(texture.swizzle[0]),
+		.g = componentSwizzle(texture.swizzle[1]),
+		.b = componentSwizzle(texture.swizzle[2]),
+		.a = componentSwizzle(texture.swizzle[3]),
+	};
+	constructVkImageView(context, imageParams, imageViewParams);
+	m_allocator->setAllocationName(m_allocation, name.c_str());
+}
 
-	//Required for blitting
-	if (!(formatProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear))
+VulkanImage::~VulkanImage()
+{
+	if (!m_loadingFailed)
 	{
-		throw std::runtime_error("texture image format does not support linear blitting!");
+		m_allocator->destroyImage(m_image, m_allocation);
+		m_device.destroyImageView(m_imageView);
 	}
+}
 
-	vk::CommandBuffer commandBuffer = context->beginSingleTimeCommands(m_commandPool);
 
+//Records the mipmaps generation of the image, converts it to shader read layout
+void VulkanImage::generateMipmaps(vk::CommandBuffer commandBuffer, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {
 	vk::ImageMemoryBarrier barrier{
 		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
 		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
@@ -212,8 +299,6 @@ void VulkanImage::generateMipmaps(VulkanContext* context, vk::Image image, vk::F
 	barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
 
 	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, nullptr, nullptr, barrier);
-
-	context->endSingleTimeCommands(commandBuffer, m_commandPool);
 }
 
 bool VulkanImage::hasLoadingFailed()
@@ -221,17 +306,20 @@ bool VulkanImage::hasLoadingFailed()
 	return m_loadingFailed;
 }
 
+//Upload timeline value signaled once the texels can be sampled, see UploadManager
+uint64_t VulkanImage::getUploadValue()
+{
+	return m_uploadValue;
+}
+
 void VulkanImage::setVMADebugName(std::string name)
 {
 	m_allocator->setAllocationName(m_allocation, name.c_str());
 }
 
-//Transition the image from the oldLayout to a newLayout
-void VulkanImage::transitionImageLayout(VulkanContext* context, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t mipLevels) 
+//Records the transition of the image from the oldLayout to a newLayout
+void VulkanImage::transitionImageLayout(vk::CommandBuffer commandBuffer, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t mipLevels) 
 {
-	vk::CommandBuffer commandBuffer = context->beginSingleTimeCommands(m_commandPool);
-
-
 	vk::ImageMemoryBarrier barrier{
 		.oldLayout = oldLayout,
 		.newLayout = newLayout,
@@ -271,6 +359,50 @@ void VulkanImage::transitionImageLayout(VulkanContext* context, vk::Format forma
 	}
 
 	commandBuffer.pipelineBarrier(sourceStage, destinationStage, {}, nullptr, nullptr, barrier);
+}
+
+//Records the release of the image by the transfer queue and its acquire by the graphics queue, both with the same layout transition
+//On a single queue family, only the layout transition is recorded
+void VulkanImage::transferOwnership(const UploadCommands& commands, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t mipLevels)
+{
+	if (!commands.transfersOwnership())
+	{
+		if (oldLayout != newLayout)
+			transitionImageLayout(commands.transfer, oldLayout, newLayout, mipLevels);
+		return;
+	}
 
-	context->endSingleTimeCommands(commandBuffer, m_commandPool);
+	vk::ImageMemoryBarrier barrier{
+		.srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+		.dstAccessMask = {}, //Ignored by the release
+		.oldLayout = oldLayout,
+		.newLayout = newLayout,
+		.srcQueueFamilyIndex = commands.transferFamily,
+		.dstQueueFamilyIndex = commands.graphicsFamily,
+		.image = m_image,
+		.subresourceRange = {
+			.aspectMask = vk::ImageAspectFlagBits::eColor,
+			.baseMipLevel = 0,
+			.levelCount = mipLevels,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+	};
+	commands.transfer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr, nullptr, barrier);
+
+	// The acquire waits for nothing (the semaphore between the submissions does), it only makes the image visible to its next users
+	vk::PipelineStageFlags destinationStage;
+	barrier.srcAccessMask = {};
+	if (newLayout == vk::ImageLayout::eTransferDstOptimal) {
+		barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite;
+		destinationStage = vk::PipelineStageFlagBits::eTransfer;
+	}
+	else if (newLayout == vk::ImageLayout::eShaderReadOnlyOptimal) {
+		barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+		destinationStage = vk::PipelineStageFlagBits::eFragmentShader;
+	}
+	else {
+		throw std::invalid_argument("unsupported ownership transfer layout!");
+	}
+	commands.graphics.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, destinationStage, {}, nullptr, nullptr, barrier);
 }
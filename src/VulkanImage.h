@@ -2,7 +2,7 @@
 author: Pyrrha Tocquet
 date: 22/05/23
 desc: Abstraction of an image that wraps around vk::Image and vk::ImageView. Manages textures loading and image creation.
-It has a unique command pool for multithreading
+Texture uploads are recorded into the shared batches of the context UploadManager
 */
 #pragma once
 
@@ -13,6 +13,7 @@ It has a unique command pool for multithreading
 #include "VulkanContext.h"
 #include "VulkanTools.h"
 #include "glm/glm.hpp"
+#include <span>
 
 class VulkanContext;
 struct VulkanImageParams {
@@ -30,19 +31,26 @@ struct VulkanImageParams {
 struct VulkanImageViewParams {
 	vk::ImageAspectFlags aspectFlags;
 	vk::ImageViewType type = vk::ImageViewType::e2D;
+	vk::ComponentMapping components{}; //Identity by default, baked textures route their channels with it
 };
 
+namespace TextureTools {
+	struct BlockTexture;
+}
+struct UploadCommands;
+
 class VulkanImage
 {
 public:
 	vk::Image m_image = VK_NULL_HANDLE;
 	vk::ImageView m_imageView = VK_NULL_HANDLE;
-	vk::CommandPool m_commandPool = VK_NULL_HANDLE;
 private:
 	void constructVkImage(VulkanContext* context, VulkanImageParams imageParams);
 	void constructVkImageView(VulkanContext* context, VulkanImageParams imageParams, VulkanImageViewParams imageViewParams);
+	void constructTexture(VulkanContext* context, VulkanImageParams imageParams, VulkanImageViewParams imageViewParams, unsigned char* pixels, int texWidth, int texHeight, const std::string& name);
 	vk::Device m_device;
 	bool m_loadingFailed = false;
+	uint64_t m_uploadValue = 0; //0 for images that are not uploaded
 
 private:
 	vma::Allocator* m_allocator;
@@ -53,11 +61,17 @@ public:
 
 	//General texture Image constructor
 	VulkanImage(VulkanContext* context, VulkanImageParams imageParams, VulkanImageViewParams imageViewParams, std::string path);
+	VulkanImage(VulkanContext* context, VulkanImageParams imageParams, VulkanImageViewParams imageViewParams, std::span<const std::byte> encodedImage, std::string name);
+	//Block compressed texture with its whole mip chain (baked KTX2 files), uploaded without any runtime mip generation
+	VulkanImage(VulkanContext* context, VulkanImageParams imageParams, VulkanImageViewParams imageViewParams, const TextureTools::BlockTexture& texture, std::string name);
 	~VulkanImage();
 
-	void transitionImageLayout(VulkanContext* context, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t mipLevels);
-	void generateMipmaps(VulkanContext* context, vk::Image image, vk::Format imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
+	//Record into an upload batch command buffer, see UploadManager
+	void transitionImageLayout(vk::CommandBuffer commandBuffer, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t mipLevels);
+	void generateMipmaps(vk::CommandBuffer commandBuffer, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
+	void transferOwnership(const UploadCommands& commands, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t mipLevels);
 	[[nodiscard]]bool hasLoadingFailed();
+	[[nodiscard]]uint64_t getUploadValue();
 	void setVMADebugName(std::string name);
 };
 
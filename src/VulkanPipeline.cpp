@@ -52,12 +52,27 @@ void VulkanPipeline::recreatePipeline(vk::Extent2D extent)
     auto meshShaderModule = createShaderModule(meshShaderCode);
     auto fragShaderModule = createShaderModule(fragShaderCode);
 
+    //Constant 0: vertex buffer layout (QuantizedVertex or Vertex)
+    const vk::Bool32 quantizedVertices = ENABLE_VERTEX_QUANTIZATION ? VK_TRUE : VK_FALSE;
+    vk::SpecializationMapEntry quantizedVerticesEntry{
+        .constantID = 0,
+        .offset = 0,
+        .size = sizeof(vk::Bool32),
+    };
+    vk::SpecializationInfo meshSpecializationInfo{
+        .mapEntryCount = 1,
+        .pMapEntries = &quantizedVerticesEntry,
+        .dataSize = sizeof(vk::Bool32),
+        .pData = &quantizedVertices,
+    };
+
     std::vector<vk::PipelineShaderStageCreateInfo> shaderStages = {
         {
             .flags = vk::PipelineShaderStageCreateFlags(),
             .stage = vk::ShaderStageFlagBits::eMeshEXT,
             .module = static_cast<VkShaderModule>(meshShaderModule),
-            .pName = meshShaderModuleInfo.GetEntryPointName()
+            .pName = meshShaderModuleInfo.GetEntryPointName(),
+            .pSpecializationInfo = &meshSpecializationInfo,
         },
         {
             .flags = vk::PipelineShaderStageCreateFlags(),
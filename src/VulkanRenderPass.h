@@ -48,6 +48,7 @@ public :
 	virtual vk::Extent2D getRenderPassExtent() = 0;
 	virtual void drawRenderPass(vk::CommandBuffer commandBuffer, uint32_t swapchainImageIndex, uint32_t m_currentFrame, std::vector<VulkanScene*> scenes) = 0;
 	virtual void updateDescriptorSets() {};
+	virtual void updateTextureDescriptors(uint32_t currentFrame, const std::vector<TextureDescriptorUpdate>& updates) {};
 	[[nodiscard]]vk::RenderPass getRenderPass();
 	[[nodiscard]]vk::Framebuffer getFramebuffer(uint32_t index);
 	void cleanFramebuffer();
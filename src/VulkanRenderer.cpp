@@ -1,4 +1,6 @@
 #include "VulkanRenderer.h"
+#include "TextureRegistry.h"
+#include "UploadManager.h"
 
 
 #pragma region CONSTRUCTORS_DESTRUCTORS
@@ -71,6 +73,7 @@ VulkanRenderer::~VulkanRenderer()
     }
 
     Material::cleanSamplers(m_context);
+    TextureRegistry::cleanTextures(m_context);
     m_device.freeCommandBuffers(m_context->getCommandPool(), m_commandBuffers);
     delete m_camera;
     
@@ -159,9 +162,19 @@ void VulkanRenderer::recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32
 {
     vk::CommandBufferBeginInfo beginInfo{};
     commandBuffer.begin(beginInfo); //TODO Revirtualise it well
+    for (auto& scene : m_scenes)
+    {
+        scene->recordCullingStatsReset(commandBuffer, m_currentFrame);
+        scene->getTextureStreamer()->recordFeedbackReset(commandBuffer, m_currentFrame);
+    }
     m_renderPasses[RenderPassesId::ShadowMappingPassId]->drawRenderPass(commandBuffer, swapchainImageIndex, m_currentFrame, m_scenes);
     m_renderPasses[RenderPassesId::DepthPrePassId]->drawRenderPass(commandBuffer, swapchainImageIndex, m_currentFrame, m_scenes);
     m_renderPasses[RenderPassesId::MainRenderPassId]->drawRenderPass(commandBuffer, swapchainImageIndex, m_currentFrame, m_scenes); // this is indeed very ugly
+    for (auto& scene : m_scenes)
+    {
+        scene->recordCullingStatsReadback(commandBuffer);
+        scene->getTextureStreamer()->recordFeedbackReadback(commandBuffer);
+    }
     commandBuffer.end();
 }
 #pragma endregion
@@ -215,6 +228,21 @@ void VulkanRenderer::drawFrame() {
     m_device.waitForFences(1, &m_inFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);//Wait for one or all fences (VK_TRUE), uint64_max disables the timeout
     uint32_t imageIndex = m_context->acquireNextSwapchainImage(m_imageAvailableSemaphores[m_currentFrame]);
      m_device.resetFences(m_inFlightFences[m_currentFrame]); //Always reset fences (after being sure we are going to submit work
+    
+    for (auto& scene : m_scenes)
+    {
+        scene->readCullingStats(m_currentFrame);
+
+        //Added textures and streamed mips are written in this frame's descriptor sets, no frame in flight uses them anymore
+        std::vector<TextureDescriptorUpdate> textureUpdates = scene->updateTextures(m_currentFrame);
+        if (!textureUpdates.empty())
+        {
+            for (auto& renderPass : m_renderPasses)
+            {
+                renderPass->updateTextureDescriptors(m_currentFrame, textureUpdates);
+            }
+        }
+    }
     m_commandBuffers[imageIndex].reset(); //Reset to record the command buffer
     
     for (auto& scene : m_scenes)
@@ -228,12 +256,26 @@ void VulkanRenderer::drawFrame() {
     }
     recordCommandBuffer(m_commandBuffers[imageIndex], imageIndex);
   
-    //Submitting the command buffer
-    vk::Semaphore waitSemaphores[] = { m_imageAvailableSemaphores[m_currentFrame] };
-    vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
+    //Submitting the command buffer, after the uploads of the scenes (waited on the GPU, the CPU never blocks on uploads)
+    //Uploads done while rendering are only submitted, the frame does not wait for them
+    UploadManager* uploadManager = m_context->getUploadManager();
+    uploadManager->flush();
+    uint64_t uploadValue = m_sceneUploadValue;
+    for (auto& scene : m_scenes)
+    {
+        uploadValue = std::max(uploadValue, scene->getTextureStreamer()->getUploadValue());
+    }
+    uint64_t waitValues[] = { 0, uploadValue }; //Binary semaphores ignore their value
+    vk::Semaphore waitSemaphores[] = { m_imageAvailableSemaphores[m_currentFrame], uploadManager->getTimelineSemaphore() };
+    vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTaskShaderEXT }; //Geometry is first read by the task shaders
     vk::Semaphore signalSemaphores[] = { m_renderFinishedSemaphores[m_currentFrame] };
+    vk::TimelineSemaphoreSubmitInfo timelineInfo{
+        .waitSemaphoreValueCount = 2,
+        .pWaitSemaphoreValues = waitValues,
+    };
     vk::SubmitInfo submitInfo{
-        .waitSemaphoreCount = 1, //Specifies which semaphores to wait on before executions begin and on which stage to wait.
+        .pNext = &timelineInfo,
+        .waitSemaphoreCount = 2, //Specifies which semaphores to wait on before executions begin and on which stage to wait.
         .pWaitSemaphores = waitSemaphores,
         .pWaitDstStageMask = waitStages, //Stages can be ran while the image is not yet available. (Stages are linked to waitSemaphores indexes)
         .commandBufferCount = 1, //Command buffers to submit for execution
@@ -244,7 +286,7 @@ void VulkanRenderer::drawFrame() {
 
     //inFlightFence will be signaled when the command buffers finished executing
     try {
-        m_context->getGraphicsQueue().submit(submitInfo, m_inFlightFences[m_currentFrame]);
+        m_context->submitToGraphicsQueue(submitInfo, m_inFlightFences[m_currentFrame]);
     }
     catch (vk::SystemError err) {
         throw std::runtime_error("failed to submit draw command buffer!");
@@ -277,8 +319,7 @@ bool VulkanRenderer::present(vk::Semaphore *signalSemaphores, uint32_t imageInde
         .pImageIndices = &imageIndex,
         .pResults = &cResult,
     };
-    //Vulkan Hpp crashes for eErrorOutOfDateKHR
-    vkQueuePresentKHR(static_cast<VkQueue>(m_context->getPresentQueue()), reinterpret_cast<VkPresentInfoKHR*>(&presentInfo));
+    (void)m_context->presentToQueue(presentInfo);
     
     vk::Result result = reinterpret_cast<vk::Result>(cResult);
     if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || m_context->isFramebufferResized())
@@ -302,9 +343,13 @@ void VulkanRenderer::addScene(VulkanScene* vulkanScene) {
     vulkanScene->loadModels();
     vulkanScene->createGeometryBuffers();
     vulkanScene->createGeometryDescriptorSet(m_geometryDescriptorSetLayout);
-    // Gorefix: the generateTextureImageInfo needs to generate the textureIds before the MaterialUBO is created and sent to the GPU
-    std::vector<vk::DescriptorImageInfo> textureImageInfos = vulkanScene->generateTextureImageInfo();
+    //The texture ids have to be set before the MaterialUBO is created and sent to the GPU
+    vulkanScene->acquireMaterialTextures();
     vulkanScene->createUniformBuffers();
+    //The textures and the geometry of the scene are used by every frame from now on
+    m_sceneUploadValue = std::max(m_sceneUploadValue, m_context->getUploadManager()->flush());
+    //Texture arrays are allocated for MAX_TEXTURE_COUNT elements, textures added later are written in place
+    std::vector<vk::DescriptorImageInfo> textureImageInfos = vulkanScene->getTextureTable()->getImageInfos();
     for (auto& renderPass : m_renderPasses)
     {
         renderPass->createDescriptorSets(vulkanScene, textureImageInfos);
@@ -348,6 +393,10 @@ void VulkanRenderer::createGeometryDescriptorSetLayout()
 	1: Primitives
 	2: Indices
 	3: Vertices
+	4: Meshlet culling statistics
+	5: Mesh infos (vertex dequantization)
+	6: Positions only (shadow and depth pre-pass)
+	7: Texture streaming feedback (desired mips)
 	*/
     vk::DescriptorSetLayoutBinding meshletInfoBinding{
         .binding = 0,
@@ -364,10 +413,25 @@ void VulkanRenderer::createGeometryDescriptorSetLayout()
 	indicesBinding.binding = 2;
 	verticesBinding.binding = 3;
 
-    vk::DescriptorSetLayoutBinding bindings[4] = { meshletInfoBinding, primitivesBinding, indicesBinding, verticesBinding };
+	vk::DescriptorSetLayoutBinding cullingStatsBinding = meshletInfoBinding;
+	cullingStatsBinding.binding = 4;
+	cullingStatsBinding.stageFlags = vk::ShaderStageFlagBits::eTaskEXT;
+
+	vk::DescriptorSetLayoutBinding meshInfosBinding = meshletInfoBinding;
+	meshInfosBinding.binding = 5;
+	meshInfosBinding.stageFlags = vk::ShaderStageFlagBits::eMeshEXT;
+
+	vk::DescriptorSetLayoutBinding positionsBinding = meshInfosBinding;
+	positionsBinding.binding = 6;
+
+	vk::DescriptorSetLayoutBinding textureFeedbackBinding = meshletInfoBinding;
+	textureFeedbackBinding.binding = 7;
+	textureFeedbackBinding.stageFlags = vk::ShaderStageFlagBits::eFragment;
+
+    vk::DescriptorSetLayoutBinding bindings[8] = { meshletInfoBinding, primitivesBinding, indicesBinding, verticesBinding, cullingStatsBinding, meshInfosBinding, positionsBinding, textureFeedbackBinding };
 
     vk::DescriptorSetLayoutCreateInfo layoutInfo{
-        .bindingCount = 4,
+        .bindingCount = 8,
         .pBindings = bindings,
     };
 
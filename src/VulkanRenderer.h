@@ -67,6 +67,7 @@ private:
 	std::vector<vk::Fence> m_inFlightFences;
 	std::vector<vk::Semaphore> m_imageAvailableSemaphores;
 	std::vector<vk::Semaphore> m_renderFinishedSemaphores;
+	uint64_t m_sceneUploadValue = 0; //Upload timeline value frames wait on
 
 
 	/*-------------------------------------------*/
@@ -1,6 +1,13 @@
 #include "VulkanScene.h"
+#include "TextureRegistry.h"
+#include "UploadManager.h"
 
 #include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+#include <cstring>
 
 
 VulkanScene::VulkanScene(VulkanContext* context, DirectionalLight* sun) {
@@ -9,15 +16,24 @@ VulkanScene::VulkanScene(VulkanContext* context, DirectionalLight* sun) {
 	m_sun = sun;
 	m_sun->setShadowCaster();
 	addLight(sun);
+	m_textureTable = new BindlessTextureTable();
+	m_textureStreamer = new TextureStreamer(context, m_textureTable);
 }
 
 VulkanScene::~VulkanScene()
 {
+	releaseMaterialTextures();
+	delete m_textureStreamer;
+	delete m_textureTable;
+
 	// TODO less verbose stuff
 	m_allocator->destroyBuffer(m_indexBuffer.m_Buffer, m_indexBuffer.m_Allocation);
 	m_allocator->destroyBuffer(m_vertexBuffer.m_Buffer, m_vertexBuffer.m_Allocation);
 	m_allocator->destroyBuffer(m_primitiveBuffer.m_Buffer, m_primitiveBuffer.m_Allocation);
 	m_allocator->destroyBuffer(m_meshletInfoBuffer.m_Buffer, m_meshletInfoBuffer.m_Allocation);
+	m_allocator->destroyBuffer(m_meshInfoBuffer.m_Buffer, m_meshInfoBuffer.m_Allocation);
+	m_allocator->destroyBuffer(m_positionBuffer.m_Buffer, m_positionBuffer.m_Allocation);
+	m_allocator->destroyBuffer(m_cullingStatsBuffer.m_Buffer, m_cullingStatsBuffer.m_Allocation);
 
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 		m_context->getAllocator()->destroyBuffer(m_generalUniformBuffers[i].m_Buffer, m_generalUniformBuffers[i].m_Allocation);
@@ -70,7 +86,7 @@ void VulkanScene::createGeometryDescriptorSet(vk::DescriptorSetLayout geometryDe
 	//Descriptor Pool
     {
 		vk::DescriptorPoolSize bindingPoolSize {.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 1};
-        std::array<vk::DescriptorPoolSize, 4> poolSizes{bindingPoolSize, bindingPoolSize, bindingPoolSize, bindingPoolSize};
+        std::array<vk::DescriptorPoolSize, 8> poolSizes{bindingPoolSize, bindingPoolSize, bindingPoolSize, bindingPoolSize, bindingPoolSize, bindingPoolSize, bindingPoolSize, bindingPoolSize};
       
         vk::DescriptorPoolCreateInfo poolInfo{
             .maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT),
@@ -122,7 +138,31 @@ void VulkanScene::createGeometryDescriptorSet(vk::DescriptorSetLayout geometryDe
 	vk::DescriptorBufferInfo vertexBufferInfo{
 		.buffer = m_vertexBuffer.m_Buffer,
 		.offset = 0,
-		.range = sizeof(Vertex) * m_vertexCount,
+		.range = VERTEX_BUFFER_STRIDE * m_vertexCount,
+	};
+
+	vk::DescriptorBufferInfo meshInfoBufferInfo{
+		.buffer = m_meshInfoBuffer.m_Buffer,
+		.offset = 0,
+		.range = sizeof(MeshInfo) * m_meshCount,
+	};
+
+	vk::DescriptorBufferInfo positionBufferInfo{
+		.buffer = m_positionBuffer.m_Buffer,
+		.offset = 0,
+		.range = POSITION_BUFFER_STRIDE * m_vertexCount,
+	};
+
+	vk::DescriptorBufferInfo cullingStatsBufferInfo{
+		.buffer = m_cullingStatsBuffer.m_Buffer,
+		.offset = 0,
+		.range = sizeof(MeshletCullingStats) * MAX_FRAMES_IN_FLIGHT,
+	};
+
+	vk::DescriptorBufferInfo textureFeedbackBufferInfo{
+		.buffer = m_textureStreamer->getFeedbackBuffer(),
+		.offset = 0,
+		.range = sizeof(int32_t) * MAX_TEXTURE_COUNT * MAX_FRAMES_IN_FLIGHT,
 	};
 
 	vk::WriteDescriptorSet meshletBufferDescriptorWrite{
@@ -146,7 +186,23 @@ void VulkanScene::createGeometryDescriptorSet(vk::DescriptorSetLayout geometryDe
 	vertexBufferWrite.dstBinding = 3;
 	vertexBufferWrite.pBufferInfo = &vertexBufferInfo;
 
-	std::array<vk::WriteDescriptorSet, 4> descriptorWrites{meshletBufferDescriptorWrite, primitiveBufferWrite, indexBufferWrite, vertexBufferWrite};
+	vk::WriteDescriptorSet cullingStatsBufferWrite = meshletBufferDescriptorWrite;
+	cullingStatsBufferWrite.dstBinding = 4;
+	cullingStatsBufferWrite.pBufferInfo = &cullingStatsBufferInfo;
+
+	vk::WriteDescriptorSet meshInfoBufferWrite = meshletBufferDescriptorWrite;
+	meshInfoBufferWrite.dstBinding = 5;
+	meshInfoBufferWrite.pBufferInfo = &meshInfoBufferInfo;
+
+	vk::WriteDescriptorSet positionBufferWrite = meshletBufferDescriptorWrite;
+	positionBufferWrite.dstBinding = 6;
+	positionBufferWrite.pBufferInfo = &positionBufferInfo;
+
+	vk::WriteDescriptorSet textureFeedbackBufferWrite = meshletBufferDescriptorWrite;
+	textureFeedbackBufferWrite.dstBinding = 7;
+	textureFeedbackBufferWrite.pBufferInfo = &textureFeedbackBufferInfo;
+
+	std::array<vk::WriteDescriptorSet, 8> descriptorWrites{meshletBufferDescriptorWrite, primitiveBufferWrite, indexBufferWrite, vertexBufferWrite, cullingStatsBufferWrite, meshInfoBufferWrite, positionBufferWrite, textureFeedbackBufferWrite};
 
     try {
         m_context->getDevice().updateDescriptorSets(descriptorWrites, nullptr);
@@ -175,13 +231,18 @@ static void newModel(VulkanContext* context, std::filesystem::path path, Transfo
 void VulkanScene::loadModels()
 {
 	size_t modelsCount = m_modelLoadingInfos.size();
-	std::vector<std::jthread> modelLoadingThreads;
-	modelLoadingThreads.resize(modelsCount);
-	m_models.resize(modelsCount);
-	for (uint32_t i = 0; i < modelsCount; i++)
 	{
-		modelLoadingThreads[i] = std::jthread(newModel, m_context, m_modelLoadingInfos[i].path, m_modelLoadingInfos[i].transform, &m_models, i);
+		std::vector<std::jthread> modelLoadingThreads;
+		modelLoadingThreads.resize(modelsCount);
+		m_models.resize(modelsCount);
+		for (uint32_t i = 0; i < modelsCount; i++)
+		{
+			modelLoadingThreads[i] = std::jthread(newModel, m_context, m_modelLoadingInfos[i].path, m_modelLoadingInfos[i].transform, &m_models, i);
+		}
 	}
+	//The last upload batch runs while the geometry buffers are created
+	m_context->getUploadManager()->flush();
+	std::cout << "Textures: " << TextureRegistry::getRequestCount() << " requested, " << TextureRegistry::getTextureCount() << " distinct images loaded, uploaded in " << m_context->getUploadManager()->getSubmitCount() << " batch submissions" << std::endl;
 }
 
 //Adds the entity modl to the scene
@@ -189,116 +250,101 @@ void VulkanScene::addEntity(Entity* entity) {
 	addModel(entity->getModelPtr());
 }
 
-template <typename T>
-void copyStdVectorToGPUBuffer(VulkanContext* context, vma::Allocator* allocator, const std::vector<T>& inputStdVector, vk::Buffer gpuBuffer, vk::DeviceSize size)
-{
-	assert(inputStdVector.size() * sizeof(T) == size);
-
-	VulkanBuffer stagingBuffer;
-
-	stagingBuffer = context->createBuffer(size, vk::BufferUsageFlagBits::eTransferSrc, vma::MemoryUsage::eCpuToGpu, "std::vector to GPU buffer staging buffer");
-
-	char* data = static_cast<char*>(allocator->mapMemory(stagingBuffer.m_Allocation));
-	memcpy(data, inputStdVector.data(), size);
-	allocator->unmapMemory(stagingBuffer.m_Allocation);
-	context->copyBuffer(stagingBuffer.m_Buffer, gpuBuffer, size);
-	allocator->destroyBuffer(stagingBuffer.m_Buffer, stagingBuffer.m_Allocation);
-}
-
-//Creates the index and vertex buffer
+//Creates the geometry buffers from the mapped baked models
 void VulkanScene::createGeometryBuffers()
 {
 	/* Buffers Sizes*/
 	for(auto model: m_models)
 	{
-		for(auto mesh: model->getMeshes())
-		{
-			m_meshletCount += mesh.meshlets.size();
-			m_vertexCount += mesh.vertices.size();
-
-			for(auto meshlet: mesh.meshlets)
-			{
-				m_primitiveCount += meshlet.primitiveIndices.size();
-				m_indexCount += meshlet.uniqueVertexIndices.size();
-			}
-		}
+		const SerializationTools::BakedModel& bakedModel = model->getBakedModel();
+		m_meshCount += bakedModel.meshes.size();
+		m_meshletCount += bakedModel.meshlets.size();
+		m_primitiveCount += bakedModel.triangles.size();
+		m_indexCount += bakedModel.indices.size();
+		m_vertexCount += bakedModel.vertexCount;
 	}
 
 	vk::DeviceSize meshletBufferSize = sizeof(MeshletIndexingInfo) * m_meshletCount;
 	vk::DeviceSize primitiveBufferSize = sizeof(Meshlet::Triangle) * m_primitiveCount;
 	vk::DeviceSize indexBufferSize = sizeof(uint32_t) * m_indexCount;
-	vk::DeviceSize vertexBufferSize = sizeof(Vertex) * m_vertexCount;
+	vk::DeviceSize vertexBufferSize = VERTEX_BUFFER_STRIDE * m_vertexCount;
+	vk::DeviceSize meshInfoBufferSize = sizeof(MeshInfo) * m_meshCount;
+	vk::DeviceSize positionBufferSize = POSITION_BUFFER_STRIDE * m_vertexCount;
 
 	/* Buffers Creation */
 	m_meshletInfoBuffer = m_context->createBuffer(meshletBufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer, vma::MemoryUsage::eGpuOnly, "Meshlet Info Buffer");
 	m_primitiveBuffer= m_context->createBuffer(primitiveBufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer, vma::MemoryUsage::eGpuOnly, "Primitive Buffer");
 	m_indexBuffer = m_context->createBuffer(indexBufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer, vma::MemoryUsage::eGpuOnly, "Index Buffer");
 	m_vertexBuffer = m_context->createBuffer(vertexBufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer, vma::MemoryUsage::eGpuOnly, "Vertex Buffer");
-
-	/* Filling the buffer */
-	MeshletIndexingInfo meshletInfo{};
-
-	std::vector<MeshletIndexingInfo> meshletInfos;
-	std::vector<Meshlet::Triangle> triangles;
-	std::vector<uint32_t> indices;
-	std::vector<Vertex> vertices;
-
-	uint32_t i = 0;
-	for(auto& model: m_models)
+	m_meshInfoBuffer = m_context->createBuffer(meshInfoBufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer, vma::MemoryUsage::eGpuOnly, "Mesh Info Buffer");
+	m_positionBuffer = m_context->createBuffer(positionBufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer, vma::MemoryUsage::eGpuOnly, "Position Buffer");
+	m_cullingStatsBuffer = m_context->createBuffer(sizeof(MeshletCullingStats) * MAX_FRAMES_IN_FLIGHT, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer, vma::MemoryUsage::eGpuToCpu, "Meshlet Culling Stats Buffer");
+
+	/* Filling the buffers, the baked arrays already have the buffer layouts, only the model-local offsets of the meshlets and indices are rebased */
+	//The copies are batched with the texture uploads, frames wait for them on the GPU
+	UploadManager* uploadManager = m_context->getUploadManager();
+	uint32_t firstMeshletId = 0;
+	for (auto& model : m_models)
 	{
-		for (auto& mesh: model->getMeshes())
-		{			
+		model->setFirstMeshletId(firstMeshletId);
+		firstMeshletId += static_cast<uint32_t>(model->getBakedModel().meshlets.size());
+	}
 
-			for(auto& meshlet: mesh.meshlets)
+	uploadManager->uploadBuffer(m_meshletInfoBuffer.m_Buffer, meshletBufferSize, [&](std::byte* data){
+		MeshletIndexingInfo* meshletInfos = reinterpret_cast<MeshletIndexingInfo*>(data);
+		uint32_t meshletBase = 0, meshBase = 0, indexBase = 0, primitiveBase = 0;
+		for (auto& model : m_models)
+		{
+			const SerializationTools::BakedModel& bakedModel = model->getBakedModel();
+			for (MeshletIndexingInfo meshletInfo : bakedModel.meshlets)
 			{
-				meshletInfo.boundingSphere = meshlet.meshletInfo.boundingSphere;
-				meshletInfo.primitiveOffset = triangles.size();	
-				
-				triangles.insert(triangles.end(), meshlet.primitiveIndices.begin(), meshlet.primitiveIndices.end());
-				
-				std::for_each(meshlet.uniqueVertexIndices.begin(), meshlet.uniqueVertexIndices.end(), [indices](uint32_t& index){index+=indices.size();});
-				indices.insert(indices.end(), meshlet.uniqueVertexIndices.begin(), meshlet.uniqueVertexIndices.end());
-				
-
-
-				meshletInfo.primitiveCount = meshlet.primitiveIndices.size();
-				meshletInfo.vertexCount = meshlet.uniqueVertexIndices.size();
-				
-				
-				meshletInfo.meshletId = i;
-
-				meshlet.meshletInfo = meshletInfo;
-				
-				meshletInfos.push_back(meshletInfo);
-				meshletInfo.vertexOffset += meshlet.uniqueVertexIndices.size();
-				
-
-				i++;
+				meshletInfo.vertexOffset += indexBase;
+				meshletInfo.primitiveOffset += primitiveBase;
+				meshletInfo.meshletId += meshletBase;
+				meshletInfo.meshId += meshBase;
+				*meshletInfos++ = meshletInfo;
 			}
-			
-			vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
-			
+			meshletBase += static_cast<uint32_t>(bakedModel.meshlets.size());
+			meshBase += static_cast<uint32_t>(bakedModel.meshes.size());
+			indexBase += static_cast<uint32_t>(bakedModel.indices.size());
+			primitiveBase += static_cast<uint32_t>(bakedModel.triangles.size());
 		}
-	} 
+	});
 
-	/* Sending to GPU buffers */
-	copyStdVectorToGPUBuffer<MeshletIndexingInfo>(m_context, m_allocator, meshletInfos, m_meshletInfoBuffer.m_Buffer, meshletBufferSize);
-	copyStdVectorToGPUBuffer<Meshlet::Triangle>(m_context, m_allocator, triangles, m_primitiveBuffer.m_Buffer,  primitiveBufferSize);
-	copyStdVectorToGPUBuffer<uint32_t>(m_context, m_allocator, indices, m_indexBuffer.m_Buffer,  indexBufferSize);
-	copyStdVectorToGPUBuffer<Vertex>(m_context, m_allocator, vertices, m_vertexBuffer.m_Buffer,  vertexBufferSize);
-}
+	uploadManager->uploadBuffer(m_indexBuffer.m_Buffer, indexBufferSize, [&](std::byte* data){
+		uint32_t* indices = reinterpret_cast<uint32_t*>(data);
+		uint32_t vertexBase = 0;
+		for (auto& model : m_models)
+		{
+			const SerializationTools::BakedModel& bakedModel = model->getBakedModel();
+			indices = std::transform(bakedModel.indices.begin(), bakedModel.indices.end(), indices, [vertexBase](uint32_t index){return index + vertexBase;});
+			vertexBase += bakedModel.vertexCount;
+		}
+	});
 
-//Computes the index buffer size from indices count
-const uint32_t VulkanScene::getIndexBufferSize()
-{
-	uint32_t indicesCount = 0;
-	for (const auto& model : m_models) {
-		for (const auto& texturedMesh : model->getRawMeshes()) {
-			indicesCount += texturedMesh.loadingIndices.size();
+	uploadManager->uploadBuffer(m_meshInfoBuffer.m_Buffer, meshInfoBufferSize, [&](std::byte* data){
+		MeshInfo* meshInfos = reinterpret_cast<MeshInfo*>(data);
+		for (auto& model : m_models)
+		{
+			for (const SerializationTools::BakedMesh& bakedMesh : model->getBakedModel().meshes)
+				*meshInfos++ = bakedMesh.meshInfo;
 		}
+	});
 
-	}
-	return indicesCount;
+	//Straight copies from the mapped files
+	auto copySections = [&](vk::Buffer gpuBuffer, vk::DeviceSize size, auto section){
+		uploadManager->uploadBuffer(gpuBuffer, size, [&](std::byte* data){
+			for (auto& model : m_models)
+			{
+				std::span<const std::byte> bytes = std::as_bytes(section(model->getBakedModel()));
+				memcpy(data, bytes.data(), bytes.size());
+				data += bytes.size();
+			}
+		});
+	};
+	copySections(m_primitiveBuffer.m_Buffer, primitiveBufferSize, [](const SerializationTools::BakedModel& bakedModel){ return bakedModel.triangles; });
+	copySections(m_vertexBuffer.m_Buffer, vertexBufferSize, [](const SerializationTools::BakedModel& bakedModel){ return bakedModel.vertices; });
+	copySections(m_positionBuffer.m_Buffer, positionBufferSize, [](const SerializationTools::BakedModel& bakedModel){ return bakedModel.positions; });
 }
 
 void VulkanScene::addLight(Light* light)
@@ -334,87 +380,13 @@ void VulkanScene::draw(vk::CommandBuffer commandBuffer, uint32_t currentFrame, v
 	VkDeviceSize offset = 0;
 
 	uint32_t indexOffset = 0;
+	pushConstant.frameId = currentFrame;
 	//Draws each model in a scene
 	for (auto& model : m_models) {
 		model->drawModel(commandBuffer, pipelineLayout, indexOffset, pushConstant);
 	}
 }
 
-//creates the index buffer
-void VulkanScene::createIndexBuffer() 
-{
-	uint32_t indicesCount = getIndexBufferSize();
-
-	vk::DeviceSize bufferSize = sizeof(Vertex) * indicesCount;
-
-	VulkanBuffer stagingBuffer;
-	stagingBuffer = m_context->createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc,
-		vma::MemoryUsage::eCpuToGpu, "Index Staging Buffer");
-
-	char* data = static_cast<char*>(m_allocator->mapMemory(stagingBuffer.m_Allocation));
-
-	int indexOffset = 0;
-	for (int modelIndex = 0; modelIndex < m_models.size(); modelIndex++) {
-		auto texturedMeshes = m_models[modelIndex]->getRawMeshes();
-		for (int texturedMeshIndex = 0; texturedMeshIndex < texturedMeshes.size(); texturedMeshIndex++) {
-			
-			auto& texturedMesh = texturedMeshes[texturedMeshIndex];
-			for (auto& index : texturedMesh.loadingIndices) {
-				index += indexOffset;
-			}
-			indexOffset += texturedMesh.loadingIndices.size();
-			memcpy(data, texturedMesh.loadingIndices.data(), static_cast<size_t>(texturedMesh.loadingIndices.size()*sizeof(uint32_t)));
-			data += texturedMesh.loadingIndices.size() * sizeof(uint32_t);
-		}
-		//m_models[modelIndex]->clearLoadingIndexData();
-	}
-	m_allocator->unmapMemory(stagingBuffer.m_Allocation);
-
-	m_indexBuffer = m_context->createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
-		vma::MemoryUsage::eGpuOnly, "Index Buffer");
-
-	m_context->copyBuffer(stagingBuffer.m_Buffer, m_indexBuffer.m_Buffer, bufferSize);
-
-	m_allocator->destroyBuffer(stagingBuffer.m_Buffer, stagingBuffer.m_Allocation);
-}
-
-
-//creates the vertex buffer
-void VulkanScene::createVertexBuffer() 
-{
-	size_t verticesCount = 0;
-	for (const auto& model : m_models) {
-		for (const auto& texturedMesh : model->getRawMeshes()) {
-			verticesCount += texturedMesh.loadingVertices.size();
-		}
-		
-	}
-
-	vk::DeviceSize bufferSize = sizeof(Vertex) * verticesCount;
-
-	VulkanBuffer stagingBuffer;
-	stagingBuffer = m_context->createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc,
-		vma::MemoryUsage::eCpuToGpu, "Vertex Staging Buffer");
-
-	char* data = static_cast<char*>(m_allocator->mapMemory(stagingBuffer.m_Allocation));
-
-	for (const auto& model : m_models) {
-		for (const auto& texturedMesh : model->getRawMeshes()) {
-			memcpy(data, texturedMesh.loadingVertices.data(), static_cast<size_t>(texturedMesh.loadingVertices.size() * sizeof(Vertex)));
-			data += texturedMesh.loadingVertices.size() * sizeof(Vertex);
-		}
-		//model->clearLoadingVertexData();
-	}
-	m_allocator->unmapMemory(stagingBuffer.m_Allocation);
-
-	m_vertexBuffer = m_context->createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
-		vma::MemoryUsage::eGpuOnly, "Vertex Buffer");
-
-	m_context->copyBuffer(stagingBuffer.m_Buffer, m_vertexBuffer.m_Buffer, bufferSize);
-
-	m_allocator->destroyBuffer(stagingBuffer.m_Buffer, stagingBuffer.m_Allocation);
-}
-
 void VulkanScene::createUniformBuffers()
 {
 	//General UBO
@@ -491,49 +463,92 @@ void VulkanScene::createUniformBuffers()
 	}
 }
 
-//adds the texture info to the texture image info and sets the right Id to the mesh
-static void appendImageInfo(std::vector<vk::DescriptorImageInfo>& textureImageInfo, vk::Sampler sampler, VulkanImage* image, uint32_t& id, uint32_t& textureId)
+//Returns the bindless index of the texture, shared by every material sampling the same image the same way
+uint32_t VulkanScene::acquireTexture(VulkanImage* image, vk::Sampler sampler)
 {
-	vk::DescriptorImageInfo imageInfo{
-			  .sampler = sampler,
-			  .imageView = image->m_imageView,
-			  .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
-	};
-	textureImageInfo.push_back(imageInfo);
-	id = textureId; //Attributes the texture id to the mesh
-	textureId++;
+	uint32_t textureId = m_textureTable->acquire(image, sampler);
+	m_textureStreamer->addTexture(textureId, image);
+	return textureId;
+}
+
+//The index is freed once no material samples the texture anymore
+void VulkanScene::releaseTexture(uint32_t textureId)
+{
+	if (m_textureTable->release(textureId))
+		m_textureStreamer->removeTexture(textureId);
+}
+
+//Sets the texture ids of the materials, call before the material uniform buffers are created
+void VulkanScene::acquireMaterialTextures()
+{
+	m_hasAcquiredTextures = true;
+	std::unordered_set<Material*> materials; //Materials shared by several meshes acquire their textures once
+	for (auto& model : m_models) {
+		for (auto& texturedMesh : model->getRawMeshes()) {
+			Material* material = texturedMesh.material;
+			if (material == nullptr || !materials.insert(material).second)
+				continue;
+
+			if (material->hasAlbedoTexture())
+			{
+				material->m_albedoTextureId = acquireTexture(material->getAlbedoTexture(), Material::s_baseColorSampler);
+			}
+			if (material->hasNormalTexture())
+			{
+				material->m_normalTextureId = acquireTexture(material->getNormalTexture(), Material::s_normalSampler);
+			}
+			if (material->hasMetallicRoughness())
+			{
+				material->m_metallicRoughnessTextureId = acquireTexture(material->getMetallicRoughnessTexture(), Material::s_metallicRoughnessSampler);
+			}
+			if (material->hasEmissiveTexture())
+			{
+				material->m_emissiveTextureId = acquireTexture(material->getEmissiveTexture(), Material::s_emissiveSampler);
+			}
+		}
+	}
+	std::cout << "Bindless textures: " << m_textureTable->getTextureCount() << " / " << MAX_TEXTURE_COUNT << std::endl;
 }
 
-//returns are vector of DescriptorImageInfo, containing the albedo and normal map texture information from the Models' TexturedMeshes
-[[nodiscard]] std::vector<vk::DescriptorImageInfo> VulkanScene::generateTextureImageInfo()
+//Releases what acquireMaterialTextures acquired, before the models and their materials are destroyed
+void VulkanScene::releaseMaterialTextures()
 {
-	std::vector<vk::DescriptorImageInfo> textureImageInfo;
-	uint32_t textureId = 0;
+	if (!m_hasAcquiredTextures)
+		return;
+	m_hasAcquiredTextures = false;
+
+	std::unordered_set<Material*> materials;
 	for (auto& model : m_models) {
 		for (auto& texturedMesh : model->getRawMeshes()) {
 			Material* material = texturedMesh.material;
-			if (material == nullptr)
+			if (material == nullptr || !materials.insert(material).second)
 				continue;
 
 			if (material->hasAlbedoTexture())
 			{
-				appendImageInfo(textureImageInfo, Material::s_baseColorSampler, material->getAlbedoTexture(), material->m_albedoTextureId, textureId);
+				releaseTexture(material->m_albedoTextureId);
 			}
 			if (material->hasNormalTexture())
 			{
-				appendImageInfo(textureImageInfo, Material::s_normalSampler, material->getNormalTexture(), material->m_normalTextureId, textureId);
+				releaseTexture(material->m_normalTextureId);
 			}
 			if (material->hasMetallicRoughness())
 			{
-				appendImageInfo(textureImageInfo, Material::s_metallicRoughnessSampler, material->getMetallicRoughnessTexture(), material->m_metallicRoughnessTextureId, textureId);
+				releaseTexture(material->m_metallicRoughnessTextureId);
 			}
 			if (material->hasEmissiveTexture())
 			{
-				appendImageInfo(textureImageInfo, Material::s_emissiveSampler, material->getEmissiveTexture(), material->m_emissiveTextureId, textureId);
+				releaseTexture(material->m_emissiveTextureId);
 			}
 		}
 	}
-	return textureImageInfo;
+}
+
+//Streams the textures and returns the texture array elements to write in this frame's descriptor sets (call once its fence is signaled)
+std::vector<TextureDescriptorUpdate> VulkanScene::updateTextures(uint32_t currentFrame)
+{
+	m_textureStreamer->update(currentFrame);
+	return m_textureTable->takeUpdates(currentFrame);
 }
 
 void	VulkanScene::updateGeneralUniformBuffer(uint32_t currentFrame)
@@ -691,4 +706,51 @@ void	VulkanScene::updateLightUniformBuffer(uint32_t currentFrame)
 	void* data = m_context->getAllocator()->mapMemory(m_lightUniformBuffers[currentFrame].m_Allocation);
 	memcpy(data, lightsUbo.data(), sizeof(LightUBO) * lightsUbo.size());
 	m_context->getAllocator()->unmapMemory(m_lightUniformBuffers[currentFrame].m_Allocation);
-}
\ No newline at end of file
+}
+
+//Clears this frame's culling counters before the task shaders run
+void VulkanScene::recordCullingStatsReset(vk::CommandBuffer commandBuffer, uint32_t currentFrame)
+{
+	commandBuffer.fillBuffer(m_cullingStatsBuffer.m_Buffer, sizeof(MeshletCullingStats) * currentFrame, sizeof(MeshletCullingStats), 0);
+
+	vk::MemoryBarrier2 memoryBarrier{
+		.srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+		.srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+		.dstStageMask = vk::PipelineStageFlagBits2::eTaskShaderEXT,
+		.dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+	};
+
+	vk::DependencyInfo dependencyInfo = {
+		.memoryBarrierCount = 1,
+		.pMemoryBarriers = &memoryBarrier,
+	};
+
+	commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+
+//Makes the culling counters visible to the host once the frame fence is signaled
+void VulkanScene::recordCullingStatsReadback(vk::CommandBuffer commandBuffer)
+{
+	vk::MemoryBarrier2 memoryBarrier{
+		.srcStageMask = vk::PipelineStageFlagBits2::eTaskShaderEXT,
+		.srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+		.dstStageMask = vk::PipelineStageFlagBits2::eHost,
+		.dstAccessMask = vk::AccessFlagBits2::eHostRead,
+	};
+
+	vk::DependencyInfo dependencyInfo = {
+		.memoryBarrierCount = 1,
+		.pMemoryBarriers = &memoryBarrier,
+	};
+
+	commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+
+//Reads the counters of the last frame that used this frame in flight slot (call after waiting on its fence)
+void VulkanScene::readCullingStats(uint32_t currentFrame)
+{
+	m_allocator->invalidateAllocation(m_cullingStatsBuffer.m_Allocation, 0, VK_WHOLE_SIZE);
+	char* data = static_cast<char*>(m_allocator->mapMemory(m_cullingStatsBuffer.m_Allocation));
+	memcpy(&m_cullingStats, data + sizeof(MeshletCullingStats) * currentFrame, sizeof(MeshletCullingStats));
+	m_allocator->unmapMemory(m_cullingStatsBuffer.m_Allocation);
+}
@@ -10,6 +10,8 @@
 #include "Model.h"
 #include "Drawable.h"
 #include "DirectionalLight.h"
+#include "BindlessTextureTable.h"
+#include "TextureStreamer.h"
 #include <future>
 #include <thread>
 
@@ -18,6 +20,9 @@ class VulkanScene : Drawable
 {
 public :
 	VulkanBuffer m_meshletInfoBuffer, m_primitiveBuffer, m_indexBuffer, m_vertexBuffer;
+	VulkanBuffer m_meshInfoBuffer;
+	VulkanBuffer m_positionBuffer; //Positions only, for the shadow and depth pre-pass pipelines
+	VulkanBuffer m_cullingStatsBuffer; //One MeshletCullingStats slot per frame in flight, written by the task shaders
 	std::vector<Model*> m_models; //TODO private after drawScene refactoring ??
 	std::vector<Light*> m_lights;
 
@@ -31,11 +36,15 @@ public :
 private:
 	VulkanContext* m_context;
 
-	uint32_t m_meshletCount = 0, m_primitiveCount = 0, m_indexCount = 0, m_vertexCount = 0;
+	uint32_t m_meshCount = 0, m_meshletCount = 0, m_primitiveCount = 0, m_indexCount = 0, m_vertexCount = 0;
 	vma::Allocator* m_allocator;
 	DirectionalLight* m_sun;
 	std::vector<ModelLoadingInfo> m_modelLoadingInfos;
 	std::array<CascadeUniformObject, MAX_FRAMES_IN_FLIGHT> m_cascadeUbos;
+	MeshletCullingStats m_cullingStats;
+	BindlessTextureTable* m_textureTable;
+	TextureStreamer* m_textureStreamer;
+	bool m_hasAcquiredTextures = false; //The materials hold references to the texture table
 
 	Camera* m_camera;
 
@@ -51,7 +60,6 @@ public:
 	void loadModels();
 	void addEntity(Entity* entity);
 	void createGeometryBuffers();
-	[[nodiscard]]	const uint32_t getIndexBufferSize();
 	void addLight(Light* light);
 	[[nodiscard]]	std::vector<Light*> getLights();
 	void updateLights();
@@ -60,6 +68,12 @@ public:
 	void	createUniformBuffers();
 	void	updateUniformBuffers(uint32_t m_currentFrame);
 	void	setCamera(Camera *camera);
+	void	recordCullingStatsReset(vk::CommandBuffer commandBuffer, uint32_t currentFrame);
+	void	recordCullingStatsReadback(vk::CommandBuffer commandBuffer);
+	void	readCullingStats(uint32_t currentFrame);
+	[[nodiscard]]	const MeshletCullingStats& getCullingStats() { return m_cullingStats; };
+	[[nodiscard]]	TextureStreamer* getTextureStreamer() { return m_textureStreamer; };
+	[[nodiscard]]	BindlessTextureTable* getTextureTable() { return m_textureTable; };
 
 	[[nodiscard]]	const VulkanBuffer getGeneralUniformBuffer(uint32_t currentFrame) { return m_generalUniformBuffers[currentFrame]; };
 	[[nodiscard]] const VulkanBuffer getLightUniformBuffer(uint32_t currentFrame) {
@@ -71,10 +85,12 @@ public:
 	[[nodiscard]] const VulkanBuffer getMaterialUniformBuffer(uint32_t currentFrame, uint32_t materialId) {
 		return m_materialUniformBuffers[currentFrame][materialId]; // Not sure it's the material id here
 	};
-	[[nodiscard]]	std::vector<vk::DescriptorImageInfo> generateTextureImageInfo();
+	[[nodiscard]]	uint32_t acquireTexture(VulkanImage* image, vk::Sampler sampler);
+	void	releaseTexture(uint32_t textureId);
+	void	acquireMaterialTextures();
+	void	releaseMaterialTextures();
+	[[nodiscard]]	std::vector<TextureDescriptorUpdate> updateTextures(uint32_t currentFrame);
 private:
-	void createVertexBuffer();
-	void createIndexBuffer();
 	void updateGeneralUniformBuffer(uint32_t currentFrame);
 	void updateLightUniformBuffer(uint32_t currentFrame);
 	void updateShadowCascadeUniformBuffer(uint32_t currentFrame);
@@ -40,7 +40,7 @@ int main(int argc, char *argv[]) {
     /* Helmet */
     Transform helmetTransform;
     helmetTransform.translate = glm::vec3(0.f, 1.12f, -0.5f);
-    helmetTransform.rotate = glm::vec3(90.f, 0.f, -90.f);
+    helmetTransform.rotate = glm::vec3(0.f, 90.f, 0.f); //The node rotation of the glTF is applied by the import
     helmetTransform.scale = glm::vec3(0.15f, 0.15f, 0.15f);
 
   
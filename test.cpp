@@ -0,0 +1,27 @@
+#include "CompressionTools.h"
+#include <random>
+#include <cstring>
+#include <cstdio>
+int main(){
+  std::mt19937 rng(1);
+  int fails=0;
+  for(int trial=0;trial<400;trial++){
+    uint32_t lane = (uint32_t[]){1,2,4}[trial%3];
+    uint32_t elem = lane * (1 + rng()%12);
+    size_t count = rng()% (trial<200? 50 : 200000);
+    std::vector<uint8_t> data(count*elem);
+    int mode = trial%4;
+    for(size_t i=0;i<data.size();i++){
+      if(mode==0) data[i]=rng();
+      else if(mode==1) data[i]=(i/elem)*3 + (i%elem);
+      else if(mode==2) data[i]= (rng()%7==0)? rng(): 0;
+      else data[i]= (i%97)<5 ? rng() : data[i? i-1:0];
+    }
+    std::vector<std::byte> enc;
+    CompressionTools::encode(data.data(), data.size(), elem, lane, enc);
+    std::vector<std::byte> dec(data.size());
+    CompressionTools::decode(enc.data(), enc.size(), dec.data(), dec.size(), 1);
+    if(memcmp(dec.data(), data.data(), data.size())) { fails++; printf("fail trial %d lane %u elem %u count %zu\n",trial,lane,elem,count);}
+  }
+  printf("fails %d\n",fails);
+}
@@ -0,0 +1,240 @@
+/*  pyrrha-bake
+    Goal: Baking the meshlets of the renderer assets offline, without a window or a Vulkan device
+    Author: Pyrrha Tocquet
+    Date: 17/10/2026
+
+    Run from the renderer working directory, outputs go to BAKED_ASSETS_PATH exactly like the runtime fallback bake
+*/
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "Defs.h"
+#include "GltfTools.h"
+#include "GeometryTools.h"
+#include "SerializationTools.h"
+#include "CompressionTools.h"
+#include "TextureTools.h"
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+static void printUsage()
+{
+    std::cout << "Usage: pyrrha-bake [-j <parallel assets>] [--force] [--benchmark] <asset.gltf|asset.glb>..." << std::endl;
+}
+
+//Same steps as Model::loadModel when the asset is not baked, the textures are compressed to KTX2 files next to the baked model
+static GeometryTools::BakeStatistics bakeAsset(const std::filesystem::path& path, uint32_t threadCount, TextureTools::TextureBakeStatistics& outTextureStatistics)
+{
+    GltfTools::GltfAsset gltfAsset;
+    GltfTools::loadGltfData(path, gltfAsset, false);
+
+    std::vector<GltfTools::MeshGeometry> geometries;
+    SerializationTools::ModelDescription description;
+    GltfTools::importGeometry(gltfAsset, geometries, description.instances);
+    for (const auto& geometry : geometries)
+    {
+        description.meshMaterials.push_back(geometry.materialIndex);
+    }
+
+    description.sourceFiles = GltfTools::listSourceFiles(path, gltfAsset);
+    GltfTools::importMaterials(path, gltfAsset, description.materials);
+    outTextureStatistics = TextureTools::bakeMaterialTextures(path, description.materials, description.sourceFiles);
+
+    std::vector<GeometryTools::MeshletBakeInput> bakeInputs;
+    bakeInputs.reserve(geometries.size());
+    for (const auto& geometry : geometries)
+    {
+        bakeInputs.push_back({ geometry.indices.data(), static_cast<uint32_t>(geometry.indices.size()), &geometry.vertices });
+    }
+
+    return SerializationTools::bakeModel(path, bakeInputs, description, {}, threadCount);
+}
+
+//glTF accessor decoding and triangle adjacency throughput, then compression ratio and decode throughput of each encoded section, with one thread and with every hardware thread
+static void benchmarkAsset(const std::filesystem::path& path)
+{
+    {
+        GltfTools::GltfAsset gltfAsset;
+        GltfTools::loadGltfData(path, gltfAsset, false);
+
+        //Best of a few runs, the first one also pays for the page faults of the output arrays
+        GltfTools::ImportStatistics bestStatistics{};
+        bestStatistics.decodeSeconds = std::numeric_limits<float>::max();
+        for (uint32_t r = 0; r < 5; r++)
+        {
+            std::vector<GltfTools::MeshGeometry> geometries;
+            std::vector<SerializationTools::BakedInstance> instances;
+            GltfTools::ImportStatistics statistics = GltfTools::importGeometry(gltfAsset, geometries, instances);
+            if (statistics.decodeSeconds < bestStatistics.decodeSeconds)
+                bestStatistics = statistics;
+        }
+        std::cout << "Benchmark: " << path << std::endl;
+        std::cout << "  accessors: " << bestStatistics.decodedBytes << " bytes decoded in " << bestStatistics.decodeSeconds * 1000.f << "ms (" << bestStatistics.decodedBytes / 1e6 / bestStatistics.decodeSeconds << " MB/s)" << std::endl;
+
+        //Triangle adjacency of every mesh, the first step of each meshlet bake
+        std::vector<GltfTools::MeshGeometry> geometries;
+        std::vector<SerializationTools::BakedInstance> instances;
+        GltfTools::importGeometry(gltfAsset, geometries, instances);
+        std::vector<std::vector<uint32_t>> adjacencies(geometries.size());
+        size_t triangleCount = 0;
+        for (size_t i = 0; i < geometries.size(); i++)
+        {
+            adjacencies[i].resize(geometries[i].indices.size());
+            triangleCount += geometries[i].indices.size() / 3;
+        }
+
+        double bestSeconds = std::numeric_limits<double>::max();
+        for (uint32_t r = 0; r < 5; r++)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < geometries.size(); i++)
+            {
+                const GltfTools::MeshGeometry& geometry = geometries[i];
+                GeometryTools::buildAdjacencyList(geometry.indices.data(), static_cast<uint32_t>(geometry.indices.size()), geometry.vertices, static_cast<uint32_t>(geometry.vertices.size()), adjacencies[i].data());
+            }
+            bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+        }
+        std::cout << "  adjacency: " << triangleCount << " triangles in " << bestSeconds * 1000.0 << "ms (" << triangleCount / 1e6 / bestSeconds << " Mtri/s)" << std::endl;
+    }
+
+    const SerializationTools::BakedModel model = SerializationTools::mapBakedModel(path, false);
+    const char* sectionNames[SerializationTools::BakedSectionCount] = { "sources", "meshes", "materials", "instances", "meshlets", "triangles", "indices", "vertices", "positions" };
+    const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    const uint32_t repeatCount = 8;
+
+    uint64_t totalSize = 0;
+    uint64_t totalStoredSize = 0;
+    for (uint32_t i = 0; i < SerializationTools::BakedSectionCount; i++)
+    {
+        const SerializationTools::BakedSection& section = model.header.sections[i];
+        totalSize += section.size;
+        totalStoredSize += section.storedSize;
+        if (section.encoding != SerializationTools::BakedCodecEncoding)
+        {
+            std::cout << "  " << sectionNames[i] << ": " << section.size << " bytes, raw" << std::endl;
+            continue;
+        }
+
+        const std::byte* encoded = model.file->data() + section.offset;
+        std::vector<std::byte> decoded(section.size);
+        std::vector<std::byte> reference(section.size);
+        CompressionTools::decode(encoded, section.storedSize, reference.data(), reference.size(), 1);
+
+        auto measure = [&](uint32_t threadCount) {
+            auto start = std::chrono::high_resolution_clock::now();
+            for (uint32_t r = 0; r < repeatCount; r++)
+            {
+                CompressionTools::decode(encoded, section.storedSize, decoded.data(), decoded.size(), threadCount);
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+            if (decoded != reference)
+                throw std::runtime_error("Decoded section mismatch");
+            return static_cast<double>(section.size) * repeatCount / seconds / 1e9;
+        };
+        double singleThreadSpeed = measure(1);
+        double allThreadsSpeed = measure(hardwareThreads);
+
+        std::cout << "  " << sectionNames[i] << ": " << section.size << " -> " << section.storedSize << " bytes (" << static_cast<double>(section.size) / section.storedSize << "x), decoded at "
+            << singleThreadSpeed << " GB/s on 1 thread, " << allThreadsSpeed << " GB/s on " << hardwareThreads << std::endl;
+    }
+    std::cout << "  total: " << totalSize << " -> " << totalStoredSize << " bytes (" << static_cast<double>(totalSize) / totalStoredSize << "x)" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t parallelAssets = 0;
+    bool force = false;
+    bool benchmark = false;
+    std::vector<std::filesystem::path> assets;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc)
+        {
+            parallelAssets = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (arg == "--force")
+        {
+            force = true;
+        }
+        else if (arg == "--benchmark")
+        {
+            benchmark = true;
+        }
+        else if (arg == "-h" || arg == "--help")
+        {
+            printUsage();
+            return 0;
+        }
+        else if (arg.starts_with("-"))
+        {
+            printUsage();
+            return 1;
+        }
+        else
+        {
+            assets.emplace_back(arg);
+        }
+    }
+
+    if (assets.empty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    //Assets are baked in parallel, the hardware threads left are given to the meshes of each asset
+    const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    if (parallelAssets == 0)
+        parallelAssets = std::min<uint32_t>(static_cast<uint32_t>(assets.size()), hardwareThreads);
+    const uint32_t threadsPerAsset = std::max(1u, hardwareThreads / parallelAssets);
+
+    std::mutex printMutex;
+    std::atomic<uint32_t> failedCount = 0;
+    auto bakeStart = std::chrono::high_resolution_clock::now();
+
+    GeometryTools::runParallel(static_cast<uint32_t>(assets.size()), parallelAssets, [&](uint32_t i) {
+        const std::filesystem::path& path = assets[i];
+        try {
+            //Stale bakes still provide the meshes whose geometry did not change, --force starts from scratch
+            if (force)
+                std::filesystem::remove(SerializationTools::bakedModelPath(path));
+            else if (SerializationTools::isModelBaked(path))
+            {
+                std::lock_guard lock(printMutex);
+                std::cout << "Up to date: " << path << std::endl;
+                return;
+            }
+
+            TextureTools::TextureBakeStatistics textureStatistics;
+            GeometryTools::BakeStatistics statistics = bakeAsset(path, threadsPerAsset, textureStatistics);
+
+            std::lock_guard lock(printMutex);
+            std::cout << "Baked Model: " << path << " (" << statistics.triangleCount << " triangles in " << statistics.seconds << "s, " << statistics.meshletCount << " meshlets, " << statistics.lodMeshletCount << " with LODs, " << statistics.reusedMeshCount << " meshes reused)" << std::endl;
+            std::cout << "  textures: " << textureStatistics.textureCount << " compressed (" << textureStatistics.reusedCount << " reused, " << textureStatistics.failedCount << " left uncompressed), " << textureStatistics.uncompressedSize / 1024 << " -> " << textureStatistics.compressedSize / 1024 << " KiB in " << textureStatistics.seconds << "s" << std::endl;
+        }
+        catch (const std::exception& e)
+        {
+            failedCount++;
+            std::lock_guard lock(printMutex);
+            std::cerr << "Failed to bake " << path << ": " << e.what() << std::endl;
+        }
+    });
+
+    float bakeTime = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - bakeStart).count();
+    std::cout << assets.size() - failedCount << "/" << assets.size() << " assets ready in " << bakeTime << "s" << std::endl;
+
+    //Run after every bake so the measures are not disturbed by other assets
+    if (benchmark && failedCount == 0)
+    {
+        for (const auto& path : assets)
+        {
+            benchmarkAsset(path);
+        }
+    }
+
+    return failedCount == 0 ? 0 : 1;
+}